@@ -0,0 +1,88 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "bench/vector.cpp"
+#include "bench/matrix.cpp"
+#include "bench/expression.cpp"
+#include "bench/determinant.cpp"
+#include "bench/inverse.cpp"
+#include "bench/gemm.cpp"
+#include "bench/parallel.cpp"
+#include "bench/transform.cpp"
+#include "bench/quaternion.cpp"
+#include "bench/fast_math.cpp"
+#include "bench/sparse.cpp"
+#include "bench/half.cpp"
+#include "bench/skinning.cpp"
+#include "bench/mapped_file.cpp"
+#include "bench/text.cpp"
+
+// Instruction sets the library was built with
+const char *bench_simd() {
+#if defined(LMEL_AVX2)
+    return "avx2";
+#elif defined(LMEL_AVX)
+    return "avx";
+#elif defined(LMEL_SSE2)
+    return "sse2";
+#else
+    return "none";
+#endif
+}
+
+// lmel_bench [--filter text] [--json file] [--quick]
+int main(int argc, char **argv) {
+    const char *json = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) {
+            bench_config().filter = argv[++i];
+        } else if (!std::strcmp(argv[i], "--json") && i + 1 < argc) {
+            json = argv[++i];
+        } else if (!std::strcmp(argv[i], "--quick")) {
+            bench_config().warm_up_ms = 2;
+            bench_config().samples = 21;
+            bench_config().max_ms = 200;
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--filter text] [--json file] [--quick]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << "Run benchmarks:\n";
+    bench_vector();
+    bench_matrix();
+    bench_expression();
+    bench_determinant();
+    bench_inverse();
+    bench_gemm();
+    bench_parallel();
+    bench_transform();
+    bench_quaternion();
+    bench_fast_math();
+    bench_sparse();
+    bench_half();
+    bench_skinning();
+    bench_mapped_file();
+    bench_text();
+
+    if (json) {
+        std::ofstream out(json);
+
+        write_bench_json(out, {
+                {"compiler", __VERSION__},
+                {"simd", bench_simd()},
+                {"pool_threads", std::to_string(lmel::shared_thread_pool().size())},
+                {"filter", bench_config().filter}
+        });
+
+        if (!out) {
+            std::cerr << "can't write " << json << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Keep value alive so the measured code is not optimized away
+template<typename T>
+inline void do_not_optimize(const T &val) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(val) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &val;
+#endif
+}
+
+// Timing budget of every benchmark, in milliseconds. Slow functions take fewer samples:
+// sampling stops after max_ms once min_samples are taken
+struct bench_settings {
+    double warm_up_ms = 20;
+    double sample_ms = 0.5;
+    double max_ms = 1000;
+    size_t samples = 101;
+    size_t min_samples = 5;
+    std::string filter;
+};
+
+inline bench_settings &bench_config() {
+    static bench_settings settings;
+    return settings;
+}
+
+// Times are per operation, bytes are per call of the measured function
+struct bench_result {
+    std::string name;
+    size_t ops;
+    double bytes;
+    size_t reps;
+    size_t samples;
+    double median_ns;
+    double p99_ns;
+    double min_ns;
+};
+
+inline std::vector<bench_result> &bench_results() {
+    static std::vector<bench_result> results;
+    return results;
+}
+
+// Warm up, then time samples of reps calls each. f performs ops operations per call
+// and touches bytes of memory. Prints the result and returns median time per operation.
+// Benchmarks whose name does not contain the configured filter return 0 without running
+template<typename F>
+double bench(const std::string &name, F &&f, size_t ops = 1, double bytes = 0) {
+    using clock = std::chrono::steady_clock;
+
+    const bench_settings &config = bench_config();
+
+    if (name.find(config.filter) == std::string::npos)
+        return 0;
+
+    // Warm-up also finds how many calls fill one sample
+    size_t reps = 1;
+    double ns = 0;
+    auto warm_up_end = clock::now() + std::chrono::duration<double, std::milli>(config.warm_up_ms);
+
+    for (;;) {
+        auto start = clock::now();
+
+        for (size_t i = 0; i < reps; ++i)
+            f();
+
+        auto end = clock::now();
+        ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+        if (ns < config.sample_ms * 1e6)
+            reps *= 2;
+        else if (end >= warm_up_end)
+            break;
+    }
+
+    std::vector<double> samples;
+    auto sampling_end = clock::now() + std::chrono::duration<double, std::milli>(config.max_ms);
+
+    while (samples.size() < config.samples && (samples.size() < config.min_samples || clock::now() < sampling_end)) {
+        auto start = clock::now();
+
+        for (size_t i = 0; i < reps; ++i)
+            f();
+
+        samples.push_back(std::chrono::duration<double, std::nano>(clock::now() - start).count() / double(reps * ops));
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    bench_result r;
+    r.name = name;
+    r.ops = ops;
+    r.bytes = bytes;
+    r.reps = reps;
+    r.samples = samples.size();
+    r.median_ns = samples[samples.size() / 2];
+    r.p99_ns = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    r.min_ns = samples.front();
+
+    std::cout << name << ": " << r.median_ns << " ns/op (p99 " << r.p99_ns << ")";
+
+    if (bytes > 0)
+        std::cout << ", " << bytes / (r.median_ns * double(ops)) << " GB/s";
+
+    std::cout << "\n";
+
+    bench_results().push_back(r);
+
+    return r.median_ns;
+}
+
+inline std::string bench_json_string(const std::string &s) {
+    std::string result = "\"";
+
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            result += '\\';
+
+        result += c;
+    }
+
+    return result + "\"";
+}
+
+// All results as one JSON document; context holds extra "key": value pairs of the run
+inline void write_bench_json(std::ostream &out, const std::vector<std::pair<std::string, std::string>> &context) {
+    out << "{\n";
+
+    for (const auto &c : context)
+        out << "  " << bench_json_string(c.first) << ": " << bench_json_string(c.second) << ",\n";
+
+    out << "  \"benchmarks\": [";
+
+    const std::vector<bench_result> &results = bench_results();
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const bench_result &r = results[i];
+        char numbers[256];
+
+        std::snprintf(numbers, sizeof(numbers),
+                      "\"ops\": %zu, \"reps\": %zu, \"samples\": %zu, \"median_ns\": %.6g, \"p99_ns\": %.6g, \"min_ns\": %.6g, "
+                      "\"bytes\": %.6g, \"gb_per_s\": %.6g",
+                      r.ops, r.reps, r.samples, r.median_ns, r.p99_ns, r.min_ns, r.bytes,
+                      r.bytes > 0 ? r.bytes / (r.median_ns * double(r.ops)) : 0.0);
+
+        out << (i ? ",\n" : "\n") << "    {\"name\": " << bench_json_string(r.name) << ", " << numbers << "}";
+    }
+
+    out << "\n  ]\n}\n";
+}
@@ -0,0 +1,63 @@
+#include <string>
+#include "../lmel/determinant.h"
+#include "bench.h"
+
+// Previous implementation: Laplace expansion along the first row
+template<typename T, size_t N>
+T laplace_determinant(const lmel::square_matrix<T, N> &m) {
+    if constexpr (N == 1) {
+        return m(0, 0);
+    } else if constexpr (N == 2) {
+        return m(0, 0) * m(1, 1) - m(1, 0) * m(0, 1);
+    } else {
+        T det = 0;
+
+        for (size_t i = 0; i < N; ++i)
+            det += (i % 2 == 0 ? 1 : -1) * m(0, i) * laplace_determinant(m.minor(0, i));
+
+        return det;
+    }
+}
+
+template<typename T, size_t N>
+void bench_determinant_size(const char *type, bool laplace) {
+    using namespace lmel;
+
+    square_matrix<T, N> m(T(0));
+
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j)
+            m(i, j) = T((i == j ? N : 0) + double((i * 7 + j * 3) % 5) / 5);
+
+    std::string name = std::string("determinant<") + type + ", " + std::to_string(N) + ">";
+
+    bench(name + " lu", [&] {
+        do_not_optimize(m);
+        do_not_optimize(determinant(m));
+    });
+
+    if (laplace)
+        bench(name + " laplace", [&] {
+            do_not_optimize(m);
+            do_not_optimize(laplace_determinant(m));
+        });
+}
+
+template<typename T>
+void bench_determinant_type(const char *type) {
+    bench_determinant_size<T, 1>(type, false);
+    bench_determinant_size<T, 2>(type, false);
+    bench_determinant_size<T, 3>(type, true);
+    bench_determinant_size<T, 4>(type, true);
+    bench_determinant_size<T, 5>(type, true);
+}
+
+void bench_determinant() {
+    bench_determinant_type<int>("int");
+    bench_determinant_type<float>("float");
+    bench_determinant_type<double>("double");
+    bench_determinant_size<double, 6>("double", true);
+    bench_determinant_size<double, 8>("double", true);
+    bench_determinant_size<double, 16>("double", false);
+    bench_determinant_size<double, 32>("double", false);
+}
@@ -0,0 +1,57 @@
+#include <string>
+#include "../lmel/expression.h"
+#include "../lmel/dynamic_vector.h"
+#include "bench.h"
+
+template<size_t N>
+void bench_expression_size() {
+    using namespace lmel;
+
+    static vector<float, N> a(1.0f), b(2.0f), c(3.0f), r(0.0f);
+    float s = 1.5f;
+
+    std::string size = std::to_string(N);
+    const double bytes = 4.0 * N * sizeof(float);
+
+    // a * s + b - c: three passes and three temporaries
+    bench("vector<float, " + size + "> eager a*s+b-c", [&] {
+        r = a * s + b - c;
+        do_not_optimize(r);
+    }, 1, bytes);
+
+    // Same expression in one fused pass
+    bench("vector<float, " + size + "> lazy a*s+b-c", [&] {
+        assign(r, lazy(a) * s + b - c);
+        do_not_optimize(r);
+    }, 1, bytes);
+}
+
+void bench_expression_dynamic(size_t n) {
+    using namespace lmel;
+
+    float_dynamic_vector a(n, 1.0f), b(n, 2.0f), c(n, 3.0f), r(n);
+    float s = 1.5f;
+
+    std::string size = std::to_string(n);
+    const double bytes = 4.0 * n * sizeof(float);
+
+    bench("dynamic_vector<float>(" + size + ") eager a*s+b-c", [&] {
+        r = a * s + b - c;
+        do_not_optimize(r);
+    }, 1, bytes);
+
+    bench("dynamic_vector<float>(" + size + ") lazy a*s+b-c", [&] {
+        assign(r, lazy(a) * s + b - c);
+        do_not_optimize(r);
+    }, 1, bytes);
+}
+
+void bench_expression() {
+    bench_expression_size<4>();
+    bench_expression_size<64>();
+    bench_expression_size<1024>();
+    bench_expression_size<16384>();
+    bench_expression_size<262144>();
+    bench_expression_dynamic(1 << 20);
+    bench_expression_dynamic(1 << 24);
+}
@@ -0,0 +1,40 @@
+#include <vector>
+#include "../lmel/fast_math.h"
+#include "../lmel/vector_batch.h"
+#include "bench.h"
+
+template<typename Math>
+void bench_fast_math_policy(const char *policy) {
+    using namespace lmel;
+
+    const size_t n = 4096;
+    std::vector<float> in(n), s(n), c(n);
+
+    for (size_t i = 0; i < n; ++i)
+        in[i] = float(i) * 0.001f;
+
+    std::vector<float_vector3d> vs(n, float_vector3d{1, 2, 3});
+    float_vector3d_batch batch(vs.data(), n);
+
+    bench(std::string(policy) + " sincos x4096", [&] {
+        Math::sincos(in.data(), s.data(), c.data(), n);
+        do_not_optimize(s);
+        do_not_optimize(c);
+    });
+
+    bench(std::string(policy) + " float_vector3d normalize x4096", [&] {
+        for (size_t i = 0; i < n; ++i)
+            vs[i].normalize(Math());
+        do_not_optimize(vs);
+    });
+
+    bench(std::string(policy) + " float_vector3d_batch normalize x4096", [&] {
+        batch.normalize(Math());
+        do_not_optimize(batch);
+    });
+}
+
+void bench_fast_math() {
+    bench_fast_math_policy<lmel::precise_math>("precise_math");
+    bench_fast_math_policy<lmel::fast_math>("fast_math");
+}
@@ -0,0 +1,46 @@
+#include <string>
+#include "../lmel/dynamic_matrix.h"
+#include "bench.h"
+
+// Previous implementation: triple loop walking B down its columns
+template<typename T>
+void naive_multiply(const lmel::dynamic_matrix<T> &a, const lmel::dynamic_matrix<T> &b, lmel::dynamic_matrix<T> &c) {
+    for (size_t i = 0; i < a.rows(); ++i)
+        for (size_t j = 0; j < b.cols(); ++j)
+            for (size_t k = 0; k < a.cols(); ++k)
+                c(i, j) += a(i, k) * b(k, j);
+}
+
+template<typename T>
+void bench_gemm_size(const char *type, size_t n, bool naive) {
+    using namespace lmel;
+
+    dynamic_matrix<T> a(n, n, T(1.5)), b(n, n, T(0.5)), c(n, n);
+    std::string name = std::string("dynamic_matrix<") + type + "> " + std::to_string(n) + "x" + std::to_string(n);
+    double flops = 2.0 * n * n * n;
+
+    double ns = bench(name + " gemm", [&] {
+        c = a * b;
+        do_not_optimize(c);
+    });
+    if (ns > 0)
+        std::cout << "    " << flops / ns << " GFLOP/s\n";
+
+    if (naive) {
+        ns = bench(name + " naive", [&] {
+            naive_multiply(a, b, c);
+            do_not_optimize(c);
+        });
+        if (ns > 0)
+            std::cout << "    " << flops / ns << " GFLOP/s\n";
+    }
+}
+
+void bench_gemm() {
+    bench_gemm_size<double>("double", 64, true);
+    bench_gemm_size<double>("double", 256, true);
+    bench_gemm_size<double>("double", 512, true);
+    bench_gemm_size<double>("double", 1024, false);
+    bench_gemm_size<float>("float", 256, true);
+    bench_gemm_size<float>("float", 1024, false);
+}
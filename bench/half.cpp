@@ -0,0 +1,74 @@
+#include <string>
+#include <vector>
+#include "../lmel/half.h"
+#include "../lmel/vector_batch.h"
+#include "../lmel/fast_math.h"
+#include "bench.h"
+
+// Same batch work on float and on 16-bit storage; bytes are those read and written
+template<typename T>
+void bench_half_type(const char *type) {
+    using namespace lmel;
+
+    const size_t n = 1 << 16;
+    std::vector<float> f(n), back(n);
+    std::vector<T> h(n);
+
+    for (size_t i = 0; i < n; ++i)
+        f[i] = float(i % 1000) * 0.37f - 150;
+
+    bench(std::string(type) + " convert from float x65536", [&] {
+        convert(f.data(), h.data(), n);
+        do_not_optimize(h);
+    }, 1, double(n) * (sizeof(float) + sizeof(T)));
+
+    bench(std::string(type) + " convert to float x65536", [&] {
+        convert(h.data(), back.data(), n);
+        do_not_optimize(back);
+    }, 1, double(n) * (sizeof(float) + sizeof(T)));
+
+    vector_batch<T, 3> batch(n, T(1.0f)), other(n, T(0.5f));
+    aligned_vector<T> out(n);
+
+    bench(std::string("vector_batch<") + type + ", 3> dot x65536", [&] {
+        batch.dot(other, out.data());
+        do_not_optimize(out);
+    }, 1, double(n) * 7 * sizeof(T));
+
+    bench(std::string("vector_batch<") + type + ", 3> normalize x65536", [&] {
+        batch.normalize();
+        do_not_optimize(batch);
+    }, 1, double(n) * 6 * sizeof(T));
+
+    bench(std::string("vector_batch<") + type + ", 3> normalize fast_math x65536", [&] {
+        batch.normalize(fast_math());
+        do_not_optimize(batch);
+    }, 1, double(n) * 6 * sizeof(T));
+}
+
+void bench_half() {
+    bench_half_type<lmel::half>("half");
+    bench_half_type<lmel::bfloat16>("bfloat16");
+
+    // Baseline: the same batches in float
+    using namespace lmel;
+
+    const size_t n = 1 << 16;
+    float_vector3d_batch batch(n, 1.0f), other(n, 0.5f);
+    aligned_vector<float> out(n);
+
+    bench("vector_batch<float, 3> dot x65536", [&] {
+        batch.dot(other, out.data());
+        do_not_optimize(out);
+    }, 1, double(n) * 7 * sizeof(float));
+
+    bench("vector_batch<float, 3> normalize x65536", [&] {
+        batch.normalize();
+        do_not_optimize(batch);
+    }, 1, double(n) * 6 * sizeof(float));
+
+    bench("vector_batch<float, 3> normalize fast_math x65536", [&] {
+        batch.normalize(fast_math());
+        do_not_optimize(batch);
+    }, 1, double(n) * 6 * sizeof(float));
+}
@@ -0,0 +1,72 @@
+#include <string>
+#include "../lmel/inverse.h"
+#include "../lmel/determinant.h"
+#include "bench.h"
+
+// Previous approach: adjugate from cofactors, every one a determinant of a minor
+template<typename T, size_t N>
+lmel::square_matrix<T, N> cofactor_inverse(const lmel::square_matrix<T, N> &m) {
+    lmel::square_matrix<T, N> result(T(0));
+    T det = 0;
+
+    for (size_t j = 0; j < N; ++j)
+        det += m(0, j) * lmel::cofactor(m, 0, j);
+
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j)
+            result(j, i) = lmel::cofactor(m, i, j) / det;
+
+    return result;
+}
+
+template<typename T, size_t N>
+void bench_inverse_size(const char *type) {
+    using namespace lmel;
+
+    square_matrix<T, N> m(T(0));
+
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j)
+            m(i, j) = T((i == j ? N : 0) + double((i * 7 + j * 3) % 5) / 5);
+
+    std::string name = std::string("inverse<") + type + ", " + std::to_string(N) + ">";
+
+    bench(name, [&] {
+        do_not_optimize(m);
+        do_not_optimize(inverse(m));
+    });
+
+    if constexpr (N == 4) {
+        bench(name + " closed form", [&] {
+            T a[N][N];
+            do_not_optimize(m);
+            do_not_optimize(detail::inverse<T, N>(m, a));
+            do_not_optimize(a);
+        });
+
+        bench(name + " rigid", [&] {
+            do_not_optimize(m);
+            do_not_optimize(rigid_inverse(m));
+        });
+    }
+
+    if constexpr (N > 1)
+        bench(name + " cofactors", [&] {
+            do_not_optimize(m);
+            do_not_optimize(cofactor_inverse(m));
+        });
+}
+
+template<typename T>
+void bench_inverse_type(const char *type) {
+    bench_inverse_size<T, 2>(type);
+    bench_inverse_size<T, 3>(type);
+    bench_inverse_size<T, 4>(type);
+    bench_inverse_size<T, 5>(type);
+}
+
+void bench_inverse() {
+    bench_inverse_type<float>("float");
+    bench_inverse_type<double>("double");
+    bench_inverse_size<double, 8>("double");
+}
@@ -0,0 +1,84 @@
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include "../lmel/mapped_file.h"
+#include "bench.h"
+
+// Loading 2^20 points from disk: parsed text, one bulk read and a mapping used in place.
+// Times are per point and include opening the file; the file stays in the page cache
+void bench_mapped_file() {
+    using namespace lmel;
+
+    const size_t n = 1 << 20;
+    const std::string names[3] = {"load 1048576 points text", "load 1048576 points deserialize",
+                                  "load 1048576 points mapped_file"};
+
+    // Writing the files takes a while, skip it when no benchmark here runs
+    if (std::none_of(names, names + 3, [](const std::string &name) {
+        return name.find(bench_config().filter) != std::string::npos;
+    }))
+        return;
+
+    const std::string dir = std::filesystem::temp_directory_path().string();
+    const std::string text = dir + "/lmel_bench_points.txt";
+    const std::string binary = dir + "/lmel_bench_points.bin";
+    const std::string mapped = dir + "/lmel_bench_points.lmea";
+
+    std::vector<float_vector3d> points(n);
+
+    for (size_t i = 0; i < n; ++i)
+        points[i] = float_vector3d{float(i % 1000) * 0.25f, float(i % 7), -float(i % 13)};
+
+    {
+        std::ofstream out(text);
+
+        for (const float_vector3d &p : points)
+            out << p(0) << ' ' << p(1) << ' ' << p(2) << '\n';
+
+        std::ofstream bin(binary, std::ios::binary);
+        serialize(bin, points);
+
+        mapped_writer<float_vector3d> w(mapped.c_str());
+        w.append(points);
+    }
+
+    const double bytes = double(n) * sizeof(float_vector3d);
+
+    bench(names[0], [&] {
+        std::ifstream in(text);
+        std::vector<float_vector3d> v;
+        v.reserve(n);
+
+        float x, y, z;
+
+        while (in >> x >> y >> z)
+            v.push_back(float_vector3d{x, y, z});
+
+        do_not_optimize(v);
+    }, n, bytes);
+
+    bench(names[1], [&] {
+        std::ifstream in(binary, std::ios::binary);
+        std::vector<float_vector3d> v;
+        deserialize(in, v);
+        do_not_optimize(v);
+    }, n, bytes);
+
+    // Reading every point once, which pages the mapping in
+    bench(names[2], [&] {
+        mapped_file f(mapped.c_str());
+        float sum = 0;
+
+        for (const float_vector3d &p : f.elements<float_vector3d>())
+            sum += p(0);
+
+        do_not_optimize(sum);
+    }, n, bytes);
+
+    std::filesystem::remove(text);
+    std::filesystem::remove(binary);
+    std::filesystem::remove(mapped);
+}
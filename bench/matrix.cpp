@@ -0,0 +1,129 @@
+#include <string>
+#include <vector>
+#include "../lmel/square_matrix.h"
+#include "bench.h"
+
+template<typename T, size_t N, size_t M>
+void fill_bench_matrix(lmel::matrix<T, N, M> &m, size_t seed) {
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < M; ++j)
+            m(i, j) = T((seed + i * 3 + j) % 5 + 1);
+}
+
+// Operations over arrays of square matrices, so every call runs count operations
+template<typename T, size_t N>
+void bench_square_matrix_size(const char *type) {
+    using namespace lmel;
+
+    const size_t count = N <= 8 ? 256 : 4;
+    std::vector<square_matrix<T, N>> a(count), b(count), r(count);
+    std::vector<vector<T, N>> v(count), rv(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        fill_bench_matrix(a[i], i);
+        fill_bench_matrix(b[i], i + 2);
+
+        for (size_t j = 0; j < N; ++j)
+            v[i](j) = T((i + j) % 3 + 1);
+    }
+
+    const std::string name = std::string("square_matrix<") + type + ", " + std::to_string(N) + "> ";
+    const double bytes = double(count * sizeof(square_matrix<T, N>));
+    const double vec_bytes = double(count * sizeof(vector<T, N>));
+
+    bench(name + "add", [&] {
+        for (size_t i = 0; i < count; ++i)
+            r[i] = a[i] + b[i];
+        do_not_optimize(r);
+    }, count, 3 * bytes);
+
+    bench(name + "scale", [&] {
+        for (size_t i = 0; i < count; ++i)
+            r[i] = a[i] * T(3);
+        do_not_optimize(r);
+    }, count, 2 * bytes);
+
+    bench(name + "product", [&] {
+        for (size_t i = 0; i < count; ++i)
+            r[i] = a[i] * b[i];
+        do_not_optimize(r);
+    }, count, 3 * bytes);
+
+    bench(name + "vector product", [&] {
+        for (size_t i = 0; i < count; ++i)
+            rv[i] = a[i] * v[i];
+        do_not_optimize(rv);
+    }, count, bytes + 2 * vec_bytes);
+
+    bench(name + "transpose", [&] {
+        for (size_t i = 0; i < count; ++i)
+            r[i] = a[i].get_transpose();
+        do_not_optimize(r);
+    }, count, 2 * bytes);
+
+    bench(name + "compare", [&] {
+        size_t equal = 0;
+        for (size_t i = 0; i < count; ++i)
+            equal += a[i] == b[i];
+        do_not_optimize(equal);
+    }, count, 2 * bytes);
+}
+
+// Rectangular product N x M by M x K
+template<typename T, size_t N, size_t M, size_t K>
+void bench_matrix_size(const char *type) {
+    using namespace lmel;
+
+    const size_t count = 256;
+    std::vector<matrix<T, N, M>> a(count), s(count);
+    std::vector<matrix<T, M, K>> b(count);
+    std::vector<matrix<T, N, K>> r(count);
+    std::vector<vector<T, M>> v(count, vector<T, M>(T(1)));
+    std::vector<vector<T, N>> rv(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        fill_bench_matrix(a[i], i);
+        fill_bench_matrix(b[i], i + 1);
+    }
+
+    const std::string name = std::string("matrix<") + type + ", " + std::to_string(N) + ", " +
+                             std::to_string(M) + "> ";
+
+    bench(name + "product " + std::to_string(M) + "x" + std::to_string(K), [&] {
+        for (size_t i = 0; i < count; ++i)
+            r[i] = a[i] * b[i];
+        do_not_optimize(r);
+    }, count, double(count * (sizeof(a[0]) + sizeof(b[0]) + sizeof(r[0]))));
+
+    bench(name + "vector product", [&] {
+        for (size_t i = 0; i < count; ++i)
+            rv[i] = a[i] * v[i];
+        do_not_optimize(rv);
+    }, count, double(count * (sizeof(a[0]) + sizeof(v[0]) + sizeof(rv[0]))));
+
+    bench(name + "add", [&] {
+        for (size_t i = 0; i < count; ++i)
+            s[i] = a[i] + a[i];
+        do_not_optimize(s);
+    }, count, double(count * 2 * sizeof(a[0])));
+}
+
+template<typename T>
+void bench_matrix_type(const char *type) {
+    bench_square_matrix_size<T, 1>(type);
+    bench_square_matrix_size<T, 2>(type);
+    bench_square_matrix_size<T, 3>(type);
+    bench_square_matrix_size<T, 4>(type);
+    bench_square_matrix_size<T, 5>(type);
+    bench_square_matrix_size<T, 8>(type);
+    bench_square_matrix_size<T, 32>(type);
+    bench_matrix_size<T, 2, 3, 4>(type);
+    bench_matrix_size<T, 3, 4, 3>(type);
+    bench_matrix_size<T, 4, 5, 2>(type);
+}
+
+void bench_matrix() {
+    bench_matrix_type<int>("int");
+    bench_matrix_type<float>("float");
+    bench_matrix_type<double>("double");
+}
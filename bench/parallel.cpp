@@ -0,0 +1,25 @@
+#include <string>
+#include "../lmel/parallel.h"
+#include "bench.h"
+
+void bench_parallel_size(size_t n) {
+    using namespace lmel;
+
+    dynamic_matrix<double> a(n, n, 1.5), b(n, n, 0.5), c;
+    std::string name = "multiply<double> " + std::to_string(n) + "x" + std::to_string(n) +
+                       " threads " + std::to_string(shared_thread_pool().size());
+    double flops = 2.0 * n * n * n;
+
+    double ns = bench(name, [&] {
+        c = multiply(a, b);
+        do_not_optimize(c);
+    });
+    if (ns > 0)
+        std::cout << "    " << flops / ns << " GFLOP/s\n";
+}
+
+void bench_parallel() {
+    bench_parallel_size(512);
+    bench_parallel_size(1024);
+    bench_parallel_size(2048);
+}
@@ -0,0 +1,50 @@
+#include <vector>
+#include "../lmel/quaternion.h"
+#include "bench.h"
+
+template<typename T>
+void bench_quaternion_type(const char *type) {
+    using namespace lmel;
+
+    const size_t n = 1024;
+    quaternion<T> q(vector<T, 3>{0, T(0.6), T(0.8)}, T(0.5));
+    std::vector<vector<T, 3>> in(n, vector<T, 3>{1, 2, 3}), out(n);
+    std::vector<quaternion<T>> qs(n, q);
+
+    const std::string name = std::string("quaternion<") + type + "> ";
+    const double bytes = double(n * sizeof(vector<T, 3>));
+
+    bench(name + "rotate via matrix", [&] {
+        for (size_t i = 0; i < n; ++i)
+            out[i] = q.get_rotation_matrix3d() * in[i];
+        do_not_optimize(out);
+    }, n, 2 * bytes);
+
+    bench(name + "rotate", [&] {
+        for (size_t i = 0; i < n; ++i)
+            out[i] = q.rotate(in[i]);
+        do_not_optimize(out);
+    }, n, 2 * bytes);
+
+    bench(name + "product", [&] {
+        for (size_t i = 0; i < n; ++i)
+            qs[i] = qs[i] * q;
+        do_not_optimize(qs);
+    }, n, double(2 * n * sizeof(quaternion<T>)));
+
+    bench(name + "rotation matrix", [&] {
+        for (size_t i = 0; i < n; ++i)
+            do_not_optimize(qs[i].get_rotation_matrix3d());
+    }, n, double(n * sizeof(quaternion<T>)));
+
+    bench(name + "inverse", [&] {
+        for (size_t i = 0; i < n; ++i)
+            do_not_optimize(qs[i].get_inverse());
+    }, n, double(n * sizeof(quaternion<T>)));
+}
+
+// Integer quaternions do not describe rotations, only float and double are measured
+void bench_quaternion() {
+    bench_quaternion_type<float>("float");
+    bench_quaternion_type<double>("double");
+}
@@ -0,0 +1,60 @@
+#include <string>
+#include <vector>
+#include "../lmel/skinning.h"
+#include "bench.h"
+
+// Four influences per vertex from a palette of 64 bones
+void bench_skinning_size(size_t n) {
+    using namespace lmel;
+
+    const size_t bones = 64;
+    std::vector<float_matrix4d> matrices;
+    std::vector<float_dual_quaternion> duals;
+
+    for (size_t b = 0; b < bones; ++b) {
+        const quaternion<float> q(float_vector3d{0, 0.6f, 0.8f}, 0.1f * float(b));
+        const float_vector3d t{float(b), 1, -2};
+
+        matrices.push_back(float_affine3(q, t).to_matrix4d());
+        duals.push_back(float_dual_quaternion(q, t));
+    }
+
+    std::vector<float_vector3d> in(n, float_vector3d{1, 2, 3}), out(n);
+    std::vector<uint16_t> index(n * 4);
+    std::vector<float> weight(n * 4, 0.25f);
+
+    for (size_t i = 0; i < n * 4; ++i)
+        index[i] = uint16_t((i * 37 + i / 4) % bones);
+
+    const std::string name = "skinning " + std::to_string(n);
+    const double bytes = n * (2 * sizeof(float_vector3d) + 4 * (sizeof(uint16_t) + sizeof(float)));
+
+    // Straightforward approach: blend the matrices, then transform the point
+    bench(name + " blended matrices", [&] {
+        for (size_t i = 0; i < n; ++i) {
+            float_matrix4d m = matrices[index[i * 4]] * weight[i * 4];
+
+            for (size_t k = 1; k < 4; ++k)
+                m += matrices[index[i * 4 + k]] * weight[i * 4 + k];
+
+            const float_vector4d p = m * float_vector4d{in[i](0), in[i](1), in[i](2), 1};
+            out[i] = float_vector3d{p(0), p(1), p(2)};
+        }
+        do_not_optimize(out);
+    }, n, bytes);
+
+    bench(name + " skin_linear", [&] {
+        skin_linear<4>(matrices.data(), in.data(), index.data(), weight.data(), out.data(), n);
+        do_not_optimize(out);
+    }, n, bytes);
+
+    bench(name + " skin_dual_quaternion", [&] {
+        skin_dual_quaternion<4>(duals.data(), in.data(), index.data(), weight.data(), out.data(), n);
+        do_not_optimize(out);
+    }, n, bytes);
+}
+
+void bench_skinning() {
+    bench_skinning_size(1 << 14);
+    bench_skinning_size(1 << 18);
+}
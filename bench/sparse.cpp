@@ -0,0 +1,48 @@
+#include <string>
+#include "../lmel/sparse_matrix.h"
+#include "bench.h"
+
+// Previous approach: matrix-vector product on the dense matrix
+template<typename T>
+void bench_sparse_size(const char *type, size_t n, size_t per_row) {
+    using namespace lmel;
+
+    sparse_builder<T> builder(n, n);
+    builder.reserve(n * per_row);
+
+    for (size_t i = 0; i < n; ++i)
+        for (size_t k = 0; k < per_row; ++k)
+            builder.add(i, (i * 31 + k * 977) % n, T(1) + T(k % 3));
+
+    sparse_matrix<T> a(builder);
+    dynamic_vector<T> x(n, T(0.5)), y(n);
+
+    std::string name = std::string("sparse_matrix<") + type + "> " + std::to_string(n) + "x" +
+                       std::to_string(n) + " nnz " + std::to_string(a.nonzeros());
+    double bytes = double(a.nonzeros()) * (sizeof(T) * 2 + sizeof(uint32_t)) + double(n) * sizeof(size_t);
+
+    bench(name + " spmv", [&] {
+        multiply<T>(a, x, y);
+        do_not_optimize(y);
+    }, 1, bytes);
+
+    bench(name + " transpose spmv", [&] {
+        transpose_multiply<T>(a, x, y);
+        do_not_optimize(y);
+    }, 1, bytes);
+
+    if (n <= 2048) {
+        dynamic_matrix<T> d = a.to_dynamic_matrix();
+
+        bench(name + " dense", [&] {
+            y = d * x;
+            do_not_optimize(y);
+        });
+    }
+}
+
+void bench_sparse() {
+    bench_sparse_size<double>("double", 2048, 16);
+    bench_sparse_size<double>("double", 100000, 32);
+    bench_sparse_size<float>("float", 100000, 32);
+}
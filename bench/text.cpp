@@ -0,0 +1,62 @@
+#include <string>
+#include <vector>
+#include <sstream>
+#include "../lmel/text.h"
+#include "bench.h"
+
+// Text dumps of 2^18 points: iostream operators against from_chars/to_chars, per point
+void bench_text() {
+    using namespace lmel;
+
+    const size_t n = 1 << 18;
+    std::vector<float_vector3d> points(n);
+
+    for (size_t i = 0; i < n; ++i)
+        points[i] = float_vector3d{float(i % 1000) * 0.25f, float(i % 7) / 3, -float(i % 13)};
+
+    std::ostringstream dump;
+    write_text(dump, points);
+
+    const std::string text = dump.str();
+    const double bytes = double(text.size());
+
+    bench("text 262144 points parse istream", [&] {
+        std::istringstream in(text);
+        std::vector<float_vector3d> v;
+        v.reserve(n);
+
+        float x, y, z;
+
+        while (in >> x >> y >> z)
+            v.push_back(float_vector3d{x, y, z});
+
+        do_not_optimize(v);
+    }, n, bytes);
+
+    bench("text 262144 points parse_text", [&] {
+        std::vector<float_vector3d> v;
+        parse_text(text, v);
+        do_not_optimize(v);
+    }, n, bytes);
+
+    bench("text 262144 points parse_text batch", [&] {
+        float_vector3d_batch batch;
+        parse_text(text, batch);
+        do_not_optimize(batch);
+    }, n, bytes);
+
+    bench("text 262144 points write ostream", [&] {
+        std::ostringstream out;
+
+        for (const float_vector3d &p : points)
+            out << p(0) << ' ' << p(1) << ' ' << p(2) << '\n';
+
+        do_not_optimize(out);
+    }, n, bytes);
+
+    bench("text 262144 points write_text", [&] {
+        std::ostringstream out;
+        write_text(out, points);
+        do_not_optimize(out);
+    }, n, bytes);
+}
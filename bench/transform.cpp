@@ -0,0 +1,88 @@
+#include <string>
+#include <vector>
+#include "../lmel/transform.h"
+#include "../lmel/affine.h"
+#include "bench.h"
+
+void bench_transform_size(size_t n) {
+    using namespace lmel;
+
+    float_matrix4d m = make_id_matrix<float, 4>();
+    m(0, 3) = 1;
+    m(1, 3) = 2;
+    m(2, 3) = 3;
+
+    std::vector<float_vector3d> in(n, float_vector3d{1, 2, 3}), out(n);
+    float_vector3d_batch batch(in.data(), n), batch_out;
+    std::string name = "float_matrix4d points " + std::to_string(n);
+    const double bytes = 2.0 * n * sizeof(float_vector3d);
+
+    bench(name + " operator*", [&] {
+        for (size_t i = 0; i < n; ++i) {
+            float_vector4d p = m * float_vector4d{in[i](0), in[i](1), in[i](2), 1};
+            out[i] = float_vector3d{p(0), p(1), p(2)};
+        }
+        do_not_optimize(out);
+    }, n, bytes);
+
+    bench(name + " transform_points", [&] {
+        transform_points(m, in.data(), out.data(), n);
+        do_not_optimize(out);
+    }, n, bytes);
+
+    bench(name + " transform_points batch", [&] {
+        transform_points(m, batch, batch_out);
+        do_not_optimize(batch_out);
+    }, n, bytes);
+}
+
+// Composition and inversion of affine transforms, as affine3 and as full 4x4 matrices
+template<typename T>
+void bench_affine_type(const char *type) {
+    using namespace lmel;
+
+    const affine3<T> a(quaternion<T>(vector<T, 3>{0, 0.6, 0.8}, T(0.3)), vector<T, 3>{1, 2, 3});
+    const affine3<T> b(quaternion<T>(vector<T, 3>{0.6, 0.8, 0}, T(1.1)), vector<T, 3>{-2, 0, 5});
+    const square_matrix<T, 4> ma = a.to_matrix4d(), mb = b.to_matrix4d();
+    const vector<T, 3> p{1, 2, 3};
+
+    const std::string name = std::string("affine3<") + type + ">";
+    const std::string matrix_name = std::string("square_matrix<") + type + ", 4>";
+
+    bench(name + " operator*", [&] {
+        do_not_optimize(a);
+        do_not_optimize(a * b);
+    });
+
+    bench(matrix_name + " operator*", [&] {
+        do_not_optimize(ma);
+        do_not_optimize(ma * mb);
+    });
+
+    bench(name + " rigid_inverse", [&] {
+        do_not_optimize(a);
+        do_not_optimize(rigid_inverse(a));
+    });
+
+    bench(name + " inverse", [&] {
+        do_not_optimize(a);
+        do_not_optimize(inverse(a));
+    });
+
+    bench(matrix_name + " inverse", [&] {
+        do_not_optimize(ma);
+        do_not_optimize(inverse(ma));
+    });
+
+    bench(name + " transform_point", [&] {
+        do_not_optimize(a);
+        do_not_optimize(a.transform_point(p));
+    });
+}
+
+void bench_transform() {
+    bench_transform_size(1024);
+    bench_transform_size(1 << 20);
+    bench_affine_type<float>("float");
+    bench_affine_type<double>("double");
+}
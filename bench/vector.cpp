@@ -0,0 +1,94 @@
+#include <string>
+#include <vector>
+#include "../lmel/vector.h"
+#include "bench.h"
+
+// Element-wise operations over arrays of vectors, so every call runs count operations
+template<typename T, size_t N>
+void bench_vector_size(const char *type) {
+    using namespace lmel;
+
+    const size_t count = N <= 64 ? 1024 : 16;
+    std::vector<vector<T, N>> a(count), b(count), r(count);
+
+    for (size_t i = 0; i < count; ++i)
+        for (size_t j = 0; j < N; ++j) {
+            a[i](j) = T((i + j) % 7 + 1);
+            b[i](j) = T((i * 3 + j) % 5 + 1);
+        }
+
+    const std::string name = std::string("vector<") + type + ", " + std::to_string(N) + "> ";
+    const double bytes = double(count * sizeof(vector<T, N>));
+
+    bench(name + "add", [&] {
+        for (size_t i = 0; i < count; ++i)
+            r[i] = a[i] + b[i];
+        do_not_optimize(r);
+    }, count, 3 * bytes);
+
+    bench(name + "scale", [&] {
+        for (size_t i = 0; i < count; ++i)
+            r[i] = a[i] * T(3);
+        do_not_optimize(r);
+    }, count, 2 * bytes);
+
+    bench(name + "add assign", [&] {
+        for (size_t i = 0; i < count; ++i)
+            r[i] += a[i];
+        do_not_optimize(r);
+    }, count, 3 * bytes);
+
+    bench(name + "dot", [&] {
+        T sum = 0;
+        for (size_t i = 0; i < count; ++i)
+            sum += a[i] * b[i];
+        do_not_optimize(sum);
+    }, count, 2 * bytes);
+
+    bench(name + "compare", [&] {
+        size_t equal = 0;
+        for (size_t i = 0; i < count; ++i)
+            equal += a[i] == b[i];
+        do_not_optimize(equal);
+    }, count, 2 * bytes);
+
+    if constexpr (N == 3)
+        bench(name + "cross", [&] {
+            for (size_t i = 0; i < count; ++i)
+                r[i] = cross(a[i], b[i]);
+            do_not_optimize(r);
+        }, count, 3 * bytes);
+
+    if constexpr (std::is_floating_point<T>::value) {
+        bench(name + "length", [&] {
+            double sum = 0;
+            for (size_t i = 0; i < count; ++i)
+                sum += a[i].length();
+            do_not_optimize(sum);
+        }, count, bytes);
+
+        bench(name + "normalize", [&] {
+            r = a;
+            for (size_t i = 0; i < count; ++i)
+                r[i].normalize();
+            do_not_optimize(r);
+        }, count, 3 * bytes);
+    }
+}
+
+template<typename T>
+void bench_vector_type(const char *type) {
+    bench_vector_size<T, 1>(type);
+    bench_vector_size<T, 2>(type);
+    bench_vector_size<T, 3>(type);
+    bench_vector_size<T, 4>(type);
+    bench_vector_size<T, 5>(type);
+    bench_vector_size<T, 16>(type);
+    bench_vector_size<T, 1024>(type);
+}
+
+void bench_vector() {
+    bench_vector_type<int>("int");
+    bench_vector_type<float>("float");
+    bench_vector_type<double>("double");
+}
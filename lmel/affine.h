@@ -0,0 +1,272 @@
+#pragma once
+
+#include <type_traits>
+#include <cstddef>
+#include <cassert>
+#include "simd.h"
+#include "vector.h"
+#include "matrix.h"
+#include "square_matrix.h"
+#include "quaternion.h"
+#include "inverse.h"
+#include "transform.h"
+#include "counters.h"
+
+namespace lmel {
+    // Affine transform of 3d space: the upper 3 rows [A | t] of a 4x4 matrix whose last
+    // row is (0, 0, 0, 1). A is the linear part (rotation, scale, shear), t the translation.
+    // Products skip the constant row: 36 multiply-adds instead of 64 for 4x4 matrices
+    template<
+            typename T,
+            typename = typename std::enable_if<std::is_floating_point<T>::value, T>::type
+    >
+    class affine3 {
+    public:
+        typedef T value_type;
+        typedef matrix<T, 3, 4> matrix_type;
+
+    private:
+        matrix_type data;
+
+    public:
+        // Identity transform
+        constexpr affine3() {
+            for (size_t i = 0; i < 3; ++i)
+                data(i, i) = 1;
+        }
+
+        // Constructor from the 3x4 matrix [A | t]
+        constexpr explicit affine3(const matrix_type &m)
+                : data(m) {}
+
+        // Constructor from linear part and translation
+        constexpr affine3(const square_matrix<T, 3> &linear, const vector<T, 3> &translation = vector<T, 3>(0)) {
+            for (size_t i = 0; i < 3; ++i) {
+                for (size_t j = 0; j < 3; ++j)
+                    data(i, j) = linear(i, j);
+
+                data(i, 3) = translation(i);
+            }
+        }
+
+        // Constructor from rotation and translation
+        constexpr affine3(const quaternion<T> &rotation, const vector<T, 3> &translation)
+                : affine3(rotation.get_rotation_matrix3d(), translation) {}
+
+        // Constructor from 4x4 matrix, which must have a last row of (0, 0, 0, 1)
+        template<typename S, typename L>
+        constexpr explicit affine3(const square_matrix<T, 4, S, L> &m) {
+            assert(m(3, 0) == 0 && m(3, 1) == 0 && m(3, 2) == 0 && m(3, 3) == 1);
+
+            for (size_t i = 0; i < 3; ++i)
+                for (size_t j = 0; j < 4; ++j)
+                    data(i, j) = m(i, j);
+        }
+
+        // Full 4x4 matrix, the conversion back and forth is exact
+        constexpr square_matrix<T, 4> to_matrix4d() const {
+            square_matrix<T, 4> result(0);
+
+            for (size_t i = 0; i < 3; ++i)
+                for (size_t j = 0; j < 4; ++j)
+                    result(i, j) = data(i, j);
+
+            result(3, 3) = 1;
+
+            return result;
+        }
+
+        constexpr const matrix_type &get_matrix() const {
+            return data;
+        }
+
+        constexpr square_matrix<T, 3> get_linear() const {
+            square_matrix<T, 3> result(0);
+
+            for (size_t i = 0; i < 3; ++i)
+                for (size_t j = 0; j < 3; ++j)
+                    result(i, j) = data(i, j);
+
+            return result;
+        }
+
+        constexpr vector<T, 3> get_translation() const {
+            return data.get_col(3);
+        }
+
+        constexpr void set_translation(const vector<T, 3> &val) {
+            data.set_col(3, val);
+        }
+
+        // Composition: applies val first and then this transform.
+        // A = A1 A2, t = A1 t2 + t1
+        constexpr affine3 operator*(const affine3 &val) const {
+            LMEL_COUNT(matrix_product, 63, 3 * 12 * sizeof(T), 1);
+
+            affine3 result;
+
+#ifdef LMEL_SSE2
+            if constexpr (std::is_same<T, float>::value && matrix_type::stride == 4) {
+                if (!LMEL_CONSTANT_EVALUATED()) {
+                    // Row i of the result is a(i, 0) b0 + a(i, 1) b1 + a(i, 2) b2 + (0, 0, 0, a(i, 3))
+                    const __m128 b0 = _mm_loadu_ps(&val.data(0, 0));
+                    const __m128 b1 = _mm_loadu_ps(&val.data(1, 0));
+                    const __m128 b2 = _mm_loadu_ps(&val.data(2, 0));
+
+                    for (size_t i = 0; i < 3; ++i) {
+                        const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(data(i, 0)), b0),
+                                                               _mm_mul_ps(_mm_set1_ps(data(i, 1)), b1)),
+                                                    _mm_mul_ps(_mm_set1_ps(data(i, 2)), b2));
+
+                        _mm_storeu_ps(&result.data(i, 0), _mm_add_ps(r, _mm_setr_ps(0, 0, 0, data(i, 3))));
+                    }
+
+                    return result;
+                }
+            }
+#endif
+            for (size_t i = 0; i < 3; ++i) {
+                for (size_t j = 0; j < 4; ++j)
+                    result.data(i, j) = data(i, 0) * val.data(0, j) + data(i, 1) * val.data(1, j) +
+                                        data(i, 2) * val.data(2, j);
+
+                result.data(i, 3) += data(i, 3);
+            }
+
+            return result;
+        }
+
+        constexpr affine3 &operator*=(const affine3 &val) {
+            *this = *this * val;
+            return *this;
+        }
+
+        // Point (w = 1): A p + t
+        constexpr vector<T, 3> transform_point(const vector<T, 3> &p) const {
+            LMEL_COUNT(matrix_vector, 18, 15 * sizeof(T), 1);
+
+            return vector<T, 3>{
+                    data(0, 0) * p(0) + data(0, 1) * p(1) + data(0, 2) * p(2) + data(0, 3),
+                    data(1, 0) * p(0) + data(1, 1) * p(1) + data(1, 2) * p(2) + data(1, 3),
+                    data(2, 0) * p(0) + data(2, 1) * p(1) + data(2, 2) * p(2) + data(2, 3)
+            };
+        }
+
+        // Direction (w = 0): A d, the translation is ignored
+        constexpr vector<T, 3> transform_direction(const vector<T, 3> &d) const {
+            LMEL_COUNT(matrix_vector, 15, 15 * sizeof(T), 1);
+
+            return vector<T, 3>{
+                    data(0, 0) * d(0) + data(0, 1) * d(1) + data(0, 2) * d(2),
+                    data(1, 0) * d(0) + data(1, 1) * d(1) + data(1, 2) * d(2),
+                    data(2, 0) * d(0) + data(2, 1) * d(1) + data(2, 2) * d(2)
+            };
+        }
+
+        // Compare operations:
+
+        constexpr bool operator==(const affine3 &val) const {
+            return data == val.data;
+        }
+
+        constexpr bool operator!=(const affine3 &val) const {
+            return data != val.data;
+        }
+
+        // get/set selected element of [A | t]:
+
+        constexpr T &operator()(size_t row, size_t col) {
+            return data(row, col);
+        }
+
+        constexpr const T &operator()(size_t row, size_t col) const {
+            return data(row, col);
+        }
+    };
+
+    using float_affine3 = affine3<float>;
+    using double_affine3 = affine3<double>;
+
+    // Inverse of a general affine transform into out: inverse(A) and -inverse(A) t.
+    // Returns false and leaves out unchanged when A is singular
+    template<typename T>
+    constexpr bool try_inverse(const affine3<T> &a, affine3<T> &out) {
+        LMEL_COUNT(inverse, 42 + 15, 24 * sizeof(T), 0);
+
+        // The closed form reads only the first three columns of a
+        T b[3][3] {};
+
+        if (!detail::inverse<T, 3>(a, b))
+            return false;
+
+        T t[3] {};
+
+        for (size_t i = 0; i < 3; ++i)
+            t[i] = -(b[i][0] * a(0, 3) + b[i][1] * a(1, 3) + b[i][2] * a(2, 3));
+
+        for (size_t i = 0; i < 3; ++i) {
+            for (size_t j = 0; j < 3; ++j)
+                out(i, j) = b[i][j];
+
+            out(i, 3) = t[i];
+        }
+
+        return true;
+    }
+
+    template<typename T>
+    constexpr affine3<T> inverse(const affine3<T> &a) {
+        affine3<T> result;
+
+        if (!try_inverse(a, result))
+            assert(!"Singular transform!");
+
+        return result;
+    }
+
+    // Inverse of a rigid transform (A orthonormal): transpose(A) and -transpose(A) t.
+    // A is not checked
+    template<typename T>
+    constexpr affine3<T> rigid_inverse(const affine3<T> &a) {
+        LMEL_COUNT(inverse, 18, 24 * sizeof(T), 1);
+
+        affine3<T> result;
+
+        for (size_t i = 0; i < 3; ++i) {
+            for (size_t j = 0; j < 3; ++j)
+                result(i, j) = a(j, i);
+
+            result(i, 3) = -(a(0, i) * a(0, 3) + a(1, i) * a(1, 3) + a(2, i) * a(2, 3));
+        }
+
+        return result;
+    }
+
+    // Transform count points or directions by an affine transform, see transform.h
+    template<typename T>
+    void transform_points(const affine3<T> &a, const vector<T, 3> *in, vector<T, 3> *out, size_t count,
+                          thread_pool &pool = shared_thread_pool()) {
+        transform_points(a.to_matrix4d(), in, out, count, false, pool);
+    }
+
+    template<typename T>
+    void transform_directions(const affine3<T> &a, const vector<T, 3> *in, vector<T, 3> *out, size_t count,
+                              thread_pool &pool = shared_thread_pool()) {
+        transform_directions(a.to_matrix4d(), in, out, count, pool);
+    }
+
+    template<typename T>
+    void transform_points(const affine3<T> &a, const vector_batch<T, 3> &in, vector_batch<T, 3> &out,
+                          thread_pool &pool = shared_thread_pool()) {
+        transform_points(a.to_matrix4d(), in, out, false, pool);
+    }
+
+    template<typename T>
+    void transform_directions(const affine3<T> &a, const vector_batch<T, 3> &in, vector_batch<T, 3> &out,
+                              thread_pool &pool = shared_thread_pool()) {
+        transform_directions(a.to_matrix4d(), in, out, pool);
+    }
+
+    static_assert(std::is_trivially_copyable<float_affine3>::value && std::is_standard_layout<float_affine3>::value,
+                  "affine3 must be trivially copyable");
+}
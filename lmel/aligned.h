@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace lmel {
+    // Alignment of heap storage: one cache line, also wide enough for any SIMD register
+    static const size_t default_alignment = 64;
+
+    // Allocator returning memory aligned to A bytes
+    template<typename T, size_t A = default_alignment>
+    class aligned_allocator {
+    public:
+        typedef T value_type;
+
+        static const size_t alignment = A;
+
+        template<typename O>
+        struct rebind {
+            typedef aligned_allocator<O, A> other;
+        };
+
+        aligned_allocator() noexcept = default;
+
+        // Template copy constructor (for other types)
+        template<typename O>
+        aligned_allocator(const aligned_allocator<O, A> &) noexcept {}
+
+        T *allocate(size_t n) {
+            return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(A)));
+        }
+
+        void deallocate(T *p, size_t) noexcept {
+            ::operator delete(p, std::align_val_t(A));
+        }
+
+        template<typename O>
+        bool operator==(const aligned_allocator<O, A> &) const noexcept {
+            return true;
+        }
+
+        template<typename O>
+        bool operator!=(const aligned_allocator<O, A> &) const noexcept {
+            return false;
+        }
+    };
+
+    template<typename T>
+    using aligned_vector = std::vector<T, aligned_allocator<T>>;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include "simd.h"
+
+// Operation counters. Define LMEL_COUNTERS to make the library count arithmetic operations,
+// bytes read and written and temporaries created, per operation kind and per thread.
+// Without it the LMEL_COUNT hooks expand to nothing and snapshots stay zero.
+// Operations evaluated in constant expressions are never counted
+
+#ifdef LMEL_COUNTERS
+#define LMEL_COUNT(op, flops, bytes, temporaries) \
+    ::lmel::detail::count(::lmel::counter_op::op, 1, (flops), (bytes), (temporaries))
+#define LMEL_COUNT_TEMPORARY(op, bytes) \
+    ::lmel::detail::count(::lmel::counter_op::op, 0, 0, (bytes), 1)
+#else
+#define LMEL_COUNT(op, flops, bytes, temporaries) ((void) 0)
+#define LMEL_COUNT_TEMPORARY(op, bytes) ((void) 0)
+#endif
+
+namespace lmel {
+#ifdef LMEL_COUNTERS
+    static constexpr bool counters_enabled = true;
+#else
+    static constexpr bool counters_enabled = false;
+#endif
+
+    enum class counter_op : unsigned {
+        vector,             // element-wise vector operations
+        dot,                // dot and cross products
+        length,             // length and normalize
+        matrix,             // element-wise matrix operations
+        matrix_product,     // fixed-size matrix products below the gemm threshold
+        matrix_vector,      // matrix-vector products
+        transpose,
+        determinant,
+        inverse,            // matrix inverses
+        quaternion,
+        expression,         // lazy expressions written to a destination
+        dynamic,            // element-wise dynamic_vector and dynamic_matrix operations
+        gemm,               // blocked matrix products of any size
+        sparse,             // sparse matrix products
+        count
+    };
+
+    inline const char *counter_op_name(counter_op op) {
+        static const char *const names[] = {
+                "vector", "dot", "length", "matrix", "matrix_product", "matrix_vector", "transpose",
+                "determinant", "inverse", "quaternion", "expression", "dynamic", "gemm", "sparse"
+        };
+
+        return op < counter_op::count ? names[static_cast<unsigned>(op)] : "";
+    }
+
+    // Counts of one operation kind; flops are multiply and add operations
+    struct op_counters {
+        uint64_t operations = 0;
+        uint64_t flops = 0;
+        uint64_t bytes = 0;
+        uint64_t temporaries = 0;
+
+        op_counters &operator+=(const op_counters &c) {
+            operations += c.operations;
+            flops += c.flops;
+            bytes += c.bytes;
+            temporaries += c.temporaries;
+            return *this;
+        }
+
+        op_counters operator-(const op_counters &c) const {
+            op_counters result;
+            result.operations = operations - c.operations;
+            result.flops = flops - c.flops;
+            result.bytes = bytes - c.bytes;
+            result.temporaries = temporaries - c.temporaries;
+            return result;
+        }
+    };
+
+    // Counters of all operation kinds. Snapshots subtract, so work between two
+    // snapshots is (after - before)
+    struct counters {
+        op_counters ops[static_cast<size_t>(counter_op::count)];
+
+        op_counters &operator[](counter_op op) {
+            return ops[static_cast<size_t>(op)];
+        }
+
+        const op_counters &operator[](counter_op op) const {
+            return ops[static_cast<size_t>(op)];
+        }
+
+        op_counters total() const {
+            op_counters result;
+
+            for (const op_counters &c : ops)
+                result += c;
+
+            return result;
+        }
+
+        counters operator-(const counters &c) const {
+            counters result;
+
+            for (size_t i = 0; i < static_cast<size_t>(counter_op::count); ++i)
+                result.ops[i] = ops[i] - c.ops[i];
+
+            return result;
+        }
+    };
+
+    namespace detail {
+        inline thread_local counters thread_counters;
+
+        constexpr void count(counter_op op, uint64_t operations, uint64_t flops, uint64_t bytes,
+                             uint64_t temporaries) {
+            if (!LMEL_CONSTANT_EVALUATED()) {
+                op_counters &c = thread_counters[op];
+                c.operations += operations;
+                c.flops += flops;
+                c.bytes += bytes;
+                c.temporaries += temporaries;
+            }
+        }
+    }
+
+    // Counters of the calling thread
+    inline counters counters_snapshot() {
+        return detail::thread_counters;
+    }
+
+    inline void reset_counters() {
+        detail::thread_counters = counters();
+    }
+
+    // One line per operation kind that was used, then the total
+    inline void report_counters(std::ostream &out, const counters &c) {
+        auto line = [&out](const char *name, const op_counters &v) {
+            out << name << ": " << v.operations << " ops, " << v.flops << " flops, "
+                << v.bytes << " bytes, " << v.temporaries << " temporaries\n";
+        };
+
+        for (size_t i = 0; i < static_cast<size_t>(counter_op::count); ++i)
+            if (c.ops[i].operations || c.ops[i].temporaries)
+                line(counter_op_name(static_cast<counter_op>(i)), c.ops[i]);
+
+        line("total", c.total());
+    }
+}
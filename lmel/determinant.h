@@ -1,25 +1,147 @@
 #pragma once
 
+#include <type_traits>
 #include "square_matrix.h"
+#include "view.h"
+#include "counters.h"
+#include "half.h"
 
 namespace lmel {
-    template<typename T, size_t N>
-    T determinant(const square_matrix<T, N> &m) {
-        T det = 0;
+    namespace detail {
+        // The functions below take any N x N matrix or view with elements m(i, j) of type T
 
-        for (size_t i = 0; i < N; ++i)
-            det += (i % 2 == 0 ? 1 : -1) * m.data[0][i] * determinant(m.minor(0, i));
+        // Determinant by LU decomposition with partial pivoting, O(N^3)
+        template<typename T, size_t N, typename M>
+        constexpr T lu_determinant(const M &m) {
+            T a[N][N] {};
 
-        return det;
+            for (size_t i = 0; i < N; ++i)
+                for (size_t j = 0; j < N; ++j)
+                    a[i][j] = m(i, j);
+
+            T det = 1;
+
+            for (size_t k = 0; k < N; ++k) {
+                // Pivot: row with the largest absolute value in column k
+                size_t p = k;
+                T max = a[k][k] < 0 ? -a[k][k] : a[k][k];
+
+                for (size_t i = k + 1; i < N; ++i) {
+                    T v = a[i][k] < 0 ? -a[i][k] : a[i][k];
+
+                    if (v > max) {
+                        max = v;
+                        p = i;
+                    }
+                }
+
+                if (max == 0)
+                    return 0;
+
+                if (p != k) {
+                    for (size_t j = k; j < N; ++j) {
+                        T tmp = a[k][j];
+                        a[k][j] = a[p][j];
+                        a[p][j] = tmp;
+                    }
+
+                    det = -det;
+                }
+
+                det *= a[k][k];
+
+                for (size_t i = k + 1; i < N; ++i) {
+                    T f = a[i][k] / a[k][k];
+
+                    for (size_t j = k + 1; j < N; ++j)
+                        a[i][j] -= f * a[k][j];
+                }
+            }
+
+            return det;
+        }
+
+        // Fraction-free elimination (Bareiss) for integral types, exact and O(N^3)
+        template<typename T, size_t N, typename M>
+        constexpr T bareiss_determinant(const M &m) {
+            long long a[N][N] {};
+
+            for (size_t i = 0; i < N; ++i)
+                for (size_t j = 0; j < N; ++j)
+                    a[i][j] = m(i, j);
+
+            long long sign = 1;
+            long long prev = 1;
+
+            for (size_t k = 0; k + 1 < N; ++k) {
+                if (a[k][k] == 0) {
+                    size_t p = k + 1;
+
+                    while (p < N && a[p][k] == 0)
+                        ++p;
+
+                    if (p == N)
+                        return 0;
+
+                    for (size_t j = k; j < N; ++j) {
+                        long long tmp = a[k][j];
+                        a[k][j] = a[p][j];
+                        a[p][j] = tmp;
+                    }
+
+                    sign = -sign;
+                }
+
+                for (size_t i = k + 1; i < N; ++i)
+                    for (size_t j = k + 1; j < N; ++j)
+                        a[i][j] = (a[i][j] * a[k][k] - a[i][k] * a[k][j]) / prev;
+
+                prev = a[k][k];
+            }
+
+            return static_cast<T>(sign * a[N - 1][N - 1]);
+        }
+
+        // Closed form up to 3x3, elimination for larger matrices. 16-bit scalars are
+        // computed and returned in float
+        template<typename T, size_t N, typename M>
+        constexpr accumulate_t<T> determinant(const M &m) {
+            LMEL_COUNT(determinant, N < 3 ? 3 * (N - 1) : N == 3 ? 14 : 2 * N * N * N / 3, N * N * sizeof(T), 0);
+
+            if constexpr (N == 1) {
+                return m(0, 0);
+            } else if constexpr (N == 2) {
+                return m(0, 0) * m(1, 1) - m(1, 0) * m(0, 1);
+            } else if constexpr (N == 3) {
+                return m(0, 0) * (m(1, 1) * m(2, 2) - m(2, 1) * m(1, 2))
+                       - m(0, 1) * (m(1, 0) * m(2, 2) - m(2, 0) * m(1, 2))
+                       + m(0, 2) * (m(1, 0) * m(2, 1) - m(2, 0) * m(1, 1));
+            } else if constexpr (std::is_integral<T>::value) {
+                return bareiss_determinant<T, N>(m);
+            } else {
+                return lu_determinant<accumulate_t<T>, N>(m);
+            }
+        }
     }
 
-    template<typename T>
-    T determinant(const square_matrix<T, 2> &m) {
-        return m.data[0][0] * m.data[1][1] - m.data[1][0] * m.data[0][1];
+    template<typename T, size_t N, typename S, typename L>
+    constexpr accumulate_t<T> determinant(const square_matrix<T, N, S, L> &m) {
+        return detail::determinant<T, N>(m);
     }
 
-    template<typename T>
-    T determinant(const square_matrix<T, 1> &m) {
-        return m.data[0][0];
+    // Determinant of a square block or minor, read through the view
+    template<typename Matrix, size_t N, bool Skip>
+    constexpr auto determinant(const sub_view<Matrix, N, N, Skip> &m) {
+        return detail::determinant<typename sub_view<Matrix, N, N, Skip>::value_type, N>(m);
+    }
+
+    // Signed minor: (-1)^(row + col) times the determinant of minor_view(row, col)
+    template<typename T, size_t N, typename S, typename L>
+    constexpr accumulate_t<T> cofactor(const square_matrix<T, N, S, L> &m, size_t row, size_t col) {
+        static_assert(N > 1, "a 1x1 matrix has no minors");
+
+        const accumulate_t<T> d = determinant(m.minor_view(row, col));
+
+        return (row + col) % 2 ? -d : d;
     }
 }
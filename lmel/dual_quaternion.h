@@ -0,0 +1,138 @@
+#pragma once
+
+#include <type_traits>
+#include <limits>
+#include <cassert>
+#include <math.h>
+#include "vector.h"
+#include "quaternion.h"
+#include "affine.h"
+#include "counters.h"
+
+namespace lmel {
+    // Rigid transform as a dual quaternion real + eps dual: real is the rotation,
+    // dual = 0.5 * (t, 0) * real for the translation t. Unit dual quaternions blend
+    // without the scaling artifacts of blended matrices, see skin_dual_quaternion()
+    template<
+            typename T,
+            typename = typename std::enable_if<std::is_floating_point<T>::value, T>::type
+    >
+    class dual_quaternion {
+    public:
+        typedef T value_type;
+
+        quaternion<T> real;
+        quaternion<T> dual;
+
+        // Identity transform
+        constexpr dual_quaternion()
+                : real(0, 0, 0, 1), dual(0, 0, 0, 0) {}
+
+        constexpr dual_quaternion(const quaternion<T> &real, const quaternion<T> &dual)
+                : real(real), dual(dual) {}
+
+        // Constructor from rotation (unit quaternion) and translation
+        constexpr dual_quaternion(const quaternion<T> &rotation, const vector<T, 3> &translation)
+                : real(rotation),
+                  dual(quaternion<T>(translation(0) / 2, translation(1) / 2, translation(2) / 2, 0) * rotation) {}
+
+        constexpr quaternion<T> get_rotation() const {
+            return real;
+        }
+
+        // t = 2 * dual * conjugate(real), for unit dual quaternions
+        constexpr vector<T, 3> get_translation() const {
+            const quaternion<T> t = dual * real.get_conjugate();
+
+            return vector<T, 3>{2 * t.x, 2 * t.y, 2 * t.z};
+        }
+
+        constexpr affine3<T> get_affine() const {
+            return affine3<T>(real, get_translation());
+        }
+
+        constexpr square_matrix<T, 4> get_matrix4d() const {
+            return get_affine().to_matrix4d();
+        }
+
+        // Inverse of a unit dual quaternion
+        constexpr dual_quaternion get_conjugate() const {
+            return dual_quaternion(real.get_conjugate(), dual.get_conjugate());
+        }
+
+        // Scale to unit length and make dual orthogonal to real, as needed after blending
+        bool normalize() {
+            LMEL_COUNT(quaternion, 28, 16 * sizeof(T), 0);
+
+            const T sq = real.x * real.x + real.y * real.y + real.z * real.z + real.w * real.w;
+
+            if (sq <= std::numeric_limits<T>::min())
+                return false;
+
+            const T inv = 1 / sqrt(sq);
+            const T d = (real.x * dual.x + real.y * dual.y + real.z * dual.z + real.w * dual.w) / sq;
+
+            dual = quaternion<T>((dual.x - real.x * d) * inv, (dual.y - real.y * d) * inv,
+                                 (dual.z - real.z * d) * inv, (dual.w - real.w * d) * inv);
+            real = quaternion<T>(real.x * inv, real.y * inv, real.z * inv, real.w * inv);
+
+            return true;
+        }
+
+        // Default math operations:
+
+        // Composition, applies val first and then this transform
+        constexpr dual_quaternion operator*(const dual_quaternion &val) const {
+            const quaternion<T> a = real * val.dual;
+            const quaternion<T> b = dual * val.real;
+
+            return dual_quaternion(real * val.real, quaternion<T>(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w));
+        }
+
+        constexpr dual_quaternion &operator*=(const dual_quaternion &val) {
+            *this = *this * val;
+            return *this;
+        }
+
+        // Weighted sums, as used for blending
+        constexpr dual_quaternion operator+(const dual_quaternion &val) const {
+            return dual_quaternion(
+                    quaternion<T>(real.x + val.real.x, real.y + val.real.y, real.z + val.real.z, real.w + val.real.w),
+                    quaternion<T>(dual.x + val.dual.x, dual.y + val.dual.y, dual.z + val.dual.z, dual.w + val.dual.w));
+        }
+
+        constexpr dual_quaternion operator*(T val) const {
+            return dual_quaternion(quaternion<T>(real.x * val, real.y * val, real.z * val, real.w * val),
+                                   quaternion<T>(dual.x * val, dual.y * val, dual.z * val, dual.w * val));
+        }
+
+        // Point (unit dual quaternion): rotate, then translate
+        constexpr vector<T, 3> transform_point(const vector<T, 3> &p) const {
+            const vector<T, 3> r = real.rotate(p);
+            const vector<T, 3> t = get_translation();
+
+            return vector<T, 3>{r(0) + t(0), r(1) + t(1), r(2) + t(2)};
+        }
+
+        // Direction: rotation only
+        constexpr vector<T, 3> transform_direction(const vector<T, 3> &d) const {
+            return real.rotate(d);
+        }
+
+        // Compare operations:
+
+        constexpr bool operator==(const dual_quaternion &val) const {
+            return real == val.real && dual == val.dual;
+        }
+
+        constexpr bool operator!=(const dual_quaternion &val) const {
+            return real != val.real || dual != val.dual;
+        }
+    };
+
+    using float_dual_quaternion = dual_quaternion<float>;
+    using double_dual_quaternion = dual_quaternion<double>;
+
+    static_assert(std::is_trivially_copyable<float_dual_quaternion>::value &&
+                  std::is_standard_layout<float_dual_quaternion>::value, "dual_quaternion must be trivially copyable");
+}
@@ -0,0 +1,407 @@
+#pragma once
+
+#include <type_traits>
+#include <initializer_list>
+#include <utility>
+#include <cassert>
+#include "aligned.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "square_matrix.h"
+#include "dynamic_vector.h"
+#include "counters.h"
+
+namespace lmel {
+    // Matrix with size chosen at runtime, elements are kept row by row in aligned heap storage
+    template<
+            typename T,
+            typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+    >
+    class dynamic_matrix {
+    private:
+        aligned_vector<T> data;
+        size_t n_rows;
+        size_t n_cols;
+
+    public:
+        typedef T value_type;
+
+        // Constructor with size and init value
+        explicit dynamic_matrix(size_t rows = 0, size_t cols = 0, T init = 0)
+                : data(rows * cols, init), n_rows(rows), n_cols(cols) {}
+
+        // Initializer list constructor
+        dynamic_matrix(size_t rows, size_t cols, std::initializer_list<T> il)
+                : data(il), n_rows(rows), n_cols(cols) {
+            assert(il.size() == rows * cols);
+        }
+
+        // Constructor from fixed-size matrix
+        template<typename O, size_t N, size_t M, typename S, typename L>
+        explicit dynamic_matrix(const matrix<O, N, M, S, L> &ref)
+                : data(N * M), n_rows(N), n_cols(M) {
+            for (size_t i = 0; i < N; ++i)
+                for (size_t j = 0; j < M; ++j)
+                    (*this)(i, j) = ref(i, j);
+        }
+
+        // Template copy constructor (for other types)
+        template<typename O>
+        explicit dynamic_matrix(const dynamic_matrix<O> &ref)
+                : data(ref.rows() * ref.cols()), n_rows(ref.rows()), n_cols(ref.cols()) {
+            for (size_t i = 0; i < n_rows; ++i)
+                for (size_t j = 0; j < n_cols; ++j)
+                    (*this)(i, j) = ref(i, j);
+        }
+
+        dynamic_matrix(const dynamic_matrix &) = default;
+
+        dynamic_matrix(dynamic_matrix &&ref) noexcept
+                : data(std::move(ref.data)), n_rows(ref.n_rows), n_cols(ref.n_cols) {
+            ref.n_rows = ref.n_cols = 0;
+        }
+
+        dynamic_matrix &operator=(const dynamic_matrix &) = default;
+
+        dynamic_matrix &operator=(dynamic_matrix &&val) noexcept {
+            data = std::move(val.data);
+            n_rows = val.n_rows;
+            n_cols = val.n_cols;
+            val.n_rows = val.n_cols = 0;
+
+            return *this;
+        }
+
+        // Conversion to fixed-size matrix, sizes must match
+        template<size_t N, size_t M>
+        matrix<T, N, M> to_matrix() const {
+            assert(n_rows == N && n_cols == M);
+
+            matrix<T, N, M> result(0);
+
+            for (size_t i = 0; i < N; ++i)
+                for (size_t j = 0; j < M; ++j)
+                    result(i, j) = (*this)(i, j);
+
+            return result;
+        }
+
+        template<size_t N>
+        square_matrix<T, N> to_square_matrix() const {
+            return to_matrix<N, N>();
+        }
+
+        size_t rows() const {
+            return n_rows;
+        }
+
+        size_t cols() const {
+            return n_cols;
+        }
+
+        // Pointer to the first element of a row
+        T *row_data(size_t row) {
+            assert(row < n_rows);
+            return data.data() + row * n_cols;
+        }
+
+        const T *row_data(size_t row) const {
+            assert(row < n_rows);
+            return data.data() + row * n_cols;
+        }
+
+        dynamic_vector<T> get_row(const size_t row) const {
+            assert(row < n_rows);
+
+            dynamic_vector<T> result(n_cols);
+            const T *in = row_data(row);
+
+            for (size_t j = 0; j < n_cols; ++j)
+                result(j) = in[j];
+
+            return result;
+        }
+
+        dynamic_vector<T> get_col(const size_t col) const {
+            assert(col < n_cols);
+
+            dynamic_vector<T> result(n_rows);
+
+            for (size_t i = 0; i < n_rows; ++i)
+                result(i) = (*this)(i, col);
+
+            return result;
+        }
+
+        void set_row(size_t row_num, const dynamic_vector<T> &row) {
+            assert(row_num < n_rows && row.size() == n_cols);
+
+            T *out = row_data(row_num);
+
+            for (size_t j = 0; j < n_cols; ++j)
+                out[j] = row(j);
+        }
+
+        void set_col(size_t col_num, const dynamic_vector<T> &col) {
+            assert(col_num < n_cols && col.size() == n_rows);
+
+            for (size_t i = 0; i < n_rows; ++i)
+                (*this)(i, col_num) = col(i);
+        }
+
+        void swap_rows(size_t a, size_t b) {
+            T *ra = row_data(a);
+            T *rb = row_data(b);
+
+            for (size_t j = 0; j < n_cols; ++j)
+                std::swap(ra[j], rb[j]);
+        }
+
+        void swap_cols(size_t a, size_t b) {
+            for (size_t i = 0; i < n_rows; ++i)
+                std::swap((*this)(i, a), (*this)(i, b));
+        }
+
+        // Default math operations:
+
+        dynamic_matrix operator+(const dynamic_matrix &val) const {
+            LMEL_COUNT_TEMPORARY(dynamic, 2 * data.size() * sizeof(T));
+
+            dynamic_matrix result = *this;
+            result += val;
+            return result;
+        }
+
+        dynamic_matrix operator-(const dynamic_matrix &val) const {
+            LMEL_COUNT_TEMPORARY(dynamic, 2 * data.size() * sizeof(T));
+
+            dynamic_matrix result = *this;
+            result -= val;
+            return result;
+        }
+
+        dynamic_matrix operator*(const dynamic_matrix &val) const {
+            assert(n_cols == val.n_rows);
+
+            dynamic_matrix result(n_rows, val.n_cols);
+
+            if (n_rows * n_cols * val.n_cols >= gemm_threshold) {
+                gemm(n_rows, n_cols, val.n_cols,
+                     data.data(), n_cols, 1,
+                     val.data.data(), val.n_cols, 1,
+                     result.data.data(), val.n_cols, 1);
+
+                return result;
+            }
+
+            LMEL_COUNT(matrix_product, 2 * n_rows * n_cols * val.n_cols,
+                       (data.size() + val.data.size() + 2 * result.data.size()) * sizeof(T), 1);
+
+            for (size_t i = 0; i < n_rows; ++i) {
+                T *out = result.row_data(i);
+
+                for (size_t j = 0; j < n_cols; ++j) {
+                    const T a = (*this)(i, j);
+                    const T *b = val.row_data(j);
+
+                    for (size_t k = 0; k < val.n_cols; ++k)
+                        out[k] += a * b[k];
+                }
+            }
+
+            return result;
+        }
+
+        dynamic_matrix &operator+=(const dynamic_matrix &val) {
+            LMEL_COUNT(dynamic, data.size(), 3 * data.size() * sizeof(T), 0);
+
+            assert(n_rows == val.n_rows && n_cols == val.n_cols);
+
+            T *a = data.data();
+            const T *b = val.data.data();
+
+            for (size_t i = 0, n = data.size(); i < n; ++i)
+                a[i] += b[i];
+
+            return *this;
+        }
+
+        dynamic_matrix &operator-=(const dynamic_matrix &val) {
+            LMEL_COUNT(dynamic, data.size(), 3 * data.size() * sizeof(T), 0);
+
+            assert(n_rows == val.n_rows && n_cols == val.n_cols);
+
+            T *a = data.data();
+            const T *b = val.data.data();
+
+            for (size_t i = 0, n = data.size(); i < n; ++i)
+                a[i] -= b[i];
+
+            return *this;
+        }
+
+        dynamic_matrix &operator*=(const dynamic_matrix &val) {
+            *this = *this * val;
+            return *this;
+        }
+
+        dynamic_matrix operator+(T val) const {
+            LMEL_COUNT_TEMPORARY(dynamic, 2 * data.size() * sizeof(T));
+
+            dynamic_matrix result = *this;
+            result += val;
+            return result;
+        }
+
+        dynamic_matrix operator-(T val) const {
+            LMEL_COUNT_TEMPORARY(dynamic, 2 * data.size() * sizeof(T));
+
+            dynamic_matrix result = *this;
+            result -= val;
+            return result;
+        }
+
+        dynamic_matrix operator*(T val) const {
+            LMEL_COUNT_TEMPORARY(dynamic, 2 * data.size() * sizeof(T));
+
+            dynamic_matrix result = *this;
+            result *= val;
+            return result;
+        }
+
+        dynamic_matrix operator/(T val) const {
+            LMEL_COUNT_TEMPORARY(dynamic, 2 * data.size() * sizeof(T));
+
+            dynamic_matrix result = *this;
+            result /= val;
+            return result;
+        }
+
+        dynamic_matrix &operator+=(T val) {
+            LMEL_COUNT(dynamic, data.size(), 2 * data.size() * sizeof(T), 0);
+
+            for (T &v : data)
+                v += val;
+
+            return *this;
+        }
+
+        dynamic_matrix &operator-=(T val) {
+            LMEL_COUNT(dynamic, data.size(), 2 * data.size() * sizeof(T), 0);
+
+            for (T &v : data)
+                v -= val;
+
+            return *this;
+        }
+
+        dynamic_matrix &operator*=(T val) {
+            LMEL_COUNT(dynamic, data.size(), 2 * data.size() * sizeof(T), 0);
+
+            for (T &v : data)
+                v *= val;
+
+            return *this;
+        }
+
+        dynamic_matrix &operator/=(T val) {
+            LMEL_COUNT(dynamic, data.size(), 2 * data.size() * sizeof(T), 0);
+
+            for (T &v : data)
+                v /= val;
+
+            return *this;
+        }
+
+        // Vector product:
+        dynamic_vector<T> operator*(const dynamic_vector<T> &vec) const {
+            LMEL_COUNT(matrix_vector, 2 * data.size(), (data.size() + n_cols + n_rows) * sizeof(T), 1);
+
+            assert(n_cols == vec.size());
+
+            dynamic_vector<T> result(n_rows);
+            const T *v = vec.begin();
+
+            for (size_t i = 0; i < n_rows; ++i) {
+                const T *in = row_data(i);
+                T sum = 0;
+
+                for (size_t j = 0; j < n_cols; ++j)
+                    sum += in[j] * v[j];
+
+                result(i) = sum;
+            }
+
+            return result;
+        }
+
+        // Compare operations:
+
+        bool operator==(const dynamic_matrix &m) const {
+            return n_rows == m.n_rows && n_cols == m.n_cols && data == m.data;
+        }
+
+        bool operator!=(const dynamic_matrix &m) const {
+            return !(*this == m);
+        }
+
+        dynamic_matrix get_transpose() const {
+            LMEL_COUNT(transpose, 0, 2 * data.size() * sizeof(T), 1);
+
+            dynamic_matrix result(n_cols, n_rows);
+
+            for (size_t i = 0; i < n_rows; ++i)
+                for (size_t j = 0; j < n_cols; ++j)
+                    result(j, i) = (*this)(i, j);
+
+            return result;
+        }
+
+        // get/set selected element:
+
+        T &operator()(size_t row, size_t col) {
+            assert(row < n_rows && col < n_cols);
+            return data[row * n_cols + col];
+        }
+
+        const T &operator()(size_t row, size_t col) const {
+            assert(row < n_rows && col < n_cols);
+            return data[row * n_cols + col];
+        }
+    };
+
+    template<typename T>
+    dynamic_matrix<T> make_dynamic_id_matrix(size_t size) {
+        dynamic_matrix<T> result(size, size);
+
+        for (size_t i = 0; i < size; ++i)
+            result(i, i) = 1;
+
+        return result;
+    }
+
+    // Result object for lazy expressions (see expression.h)
+    template<typename T>
+    dynamic_matrix<T> make_expression_result(const dynamic_matrix<T> &shape) {
+        return dynamic_matrix<T>(shape.rows(), shape.cols());
+    }
+
+    template<typename T, typename E>
+    void assign_expression(dynamic_matrix<T> &dst, const E &e) {
+        assert(dst.rows() == e.shape().rows() && dst.cols() == e.shape().cols());
+
+        LMEL_COUNT(expression, E::operations * dst.rows() * dst.cols(),
+                   (E::operands + 1) * dst.rows() * dst.cols() * sizeof(T), 0);
+
+        for (size_t i = 0; i < dst.rows(); ++i) {
+            T *out = dst.row_data(i);
+
+            for (size_t j = 0; j < dst.cols(); ++j)
+                out[j] = e(i, j);
+        }
+    }
+
+    using int_dynamic_matrix = dynamic_matrix<int>;
+    using float_dynamic_matrix = dynamic_matrix<float>;
+    using double_dynamic_matrix = dynamic_matrix<double>;
+}
@@ -0,0 +1,449 @@
+#pragma once
+
+#include <type_traits>
+#include <cstddef>
+#include <cassert>
+#include <limits>
+#include <math.h>
+#include "dynamic_vector.h"
+#include "dynamic_matrix.h"
+#include "parallel.h"
+#include "counters.h"
+
+namespace lmel {
+    // Non-owning vectors and matrices with runtime sizes and strides, see ref.h for
+    // the fixed-size versions. Copying a ref copies the pointer, assigning to a ref
+    // writes into the referenced memory. T may be const for read-only refs.
+
+    template<typename T>
+    class dynamic_vector_ref {
+    public:
+        typedef typename std::remove_const<T>::type value_type;
+
+    private:
+        T *ptr;
+        size_t n;
+        ptrdiff_t step;
+
+    public:
+        dynamic_vector_ref(T *data, size_t size, ptrdiff_t stride = 1)
+                : ptr(data), n(size), step(stride) {}
+
+        // Ref to the elements of a dynamic_vector
+        dynamic_vector_ref(dynamic_vector<value_type> &vec)
+                : ptr(vec.begin()), n(vec.size()), step(1) {}
+
+        template<typename U = T, typename = typename std::enable_if<std::is_const<U>::value>::type>
+        dynamic_vector_ref(const dynamic_vector<value_type> &vec)
+                : ptr(vec.begin()), n(vec.size()), step(1) {}
+
+        // Read-only ref from writable one
+        template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+        dynamic_vector_ref(const dynamic_vector_ref<U> &ref)
+                : ptr(ref.data()), n(ref.size()), step(ref.stride()) {}
+
+        dynamic_vector_ref(const dynamic_vector_ref &) = default;
+
+        // Copies elements, sizes must match
+        template<typename U>
+        dynamic_vector_ref &operator=(const dynamic_vector_ref<U> &val) {
+            assert(n == val.size());
+
+            for (size_t i = 0; i < n; ++i)
+                (*this)(i) = val(i);
+
+            return *this;
+        }
+
+        dynamic_vector_ref &operator=(const dynamic_vector_ref &val) {
+            return operator=<T>(val);
+        }
+
+        dynamic_vector_ref &operator=(const dynamic_vector<value_type> &val) {
+            return *this = dynamic_vector_ref<const value_type>(val);
+        }
+
+        dynamic_vector<value_type> to_dynamic_vector() const {
+            dynamic_vector<value_type> result(n);
+
+            for (size_t i = 0; i < n; ++i)
+                result(i) = (*this)(i);
+
+            return result;
+        }
+
+        T *data() const {
+            return ptr;
+        }
+
+        size_t size() const {
+            return n;
+        }
+
+        ptrdiff_t stride() const {
+            return step;
+        }
+
+        // Vector length
+        double length() const {
+            value_type sum = *this * *this;
+
+            return sqrt(sum);
+        }
+
+        // Normalize vector in place
+        bool normalize() {
+            double len = length();
+
+            if (len <= std::numeric_limits<double>::epsilon())
+                return false;
+
+            for (size_t i = 0; i < n; ++i)
+                (*this)(i) /= len;
+
+            return true;
+        }
+
+        // Dot product
+        value_type operator*(const dynamic_vector_ref<const value_type> &val) const {
+            assert(n == val.size());
+
+            value_type prod = 0;
+
+            for (size_t i = 0; i < n; ++i)
+                prod += (*this)(i) * val(i);
+
+            return prod;
+        }
+
+        // In-place operations on the referenced memory:
+
+        dynamic_vector_ref &operator+=(const dynamic_vector_ref<const value_type> &val) {
+            assert(n == val.size());
+
+            for (size_t i = 0; i < n; ++i)
+                (*this)(i) += val(i);
+
+            return *this;
+        }
+
+        dynamic_vector_ref &operator-=(const dynamic_vector_ref<const value_type> &val) {
+            assert(n == val.size());
+
+            for (size_t i = 0; i < n; ++i)
+                (*this)(i) -= val(i);
+
+            return *this;
+        }
+
+        dynamic_vector_ref &operator+=(value_type val) {
+            for (size_t i = 0; i < n; ++i)
+                (*this)(i) += val;
+
+            return *this;
+        }
+
+        dynamic_vector_ref &operator-=(value_type val) {
+            for (size_t i = 0; i < n; ++i)
+                (*this)(i) -= val;
+
+            return *this;
+        }
+
+        dynamic_vector_ref &operator*=(value_type val) {
+            for (size_t i = 0; i < n; ++i)
+                (*this)(i) *= val;
+
+            return *this;
+        }
+
+        dynamic_vector_ref &operator/=(value_type val) {
+            for (size_t i = 0; i < n; ++i)
+                (*this)(i) /= val;
+
+            return *this;
+        }
+
+        // Compare operations:
+
+        bool operator==(const dynamic_vector_ref<const value_type> &val) const {
+            if (n != val.size())
+                return false;
+
+            for (size_t i = 0; i < n; ++i)
+                if ((*this)(i) != val(i))
+                    return false;
+
+            return true;
+        }
+
+        bool operator!=(const dynamic_vector_ref<const value_type> &val) const {
+            return !(*this == val);
+        }
+
+        // get/set selected element:
+
+        T &operator()(size_t i) const {
+            assert(i < n);
+            return ptr[static_cast<ptrdiff_t>(i) * step];
+        }
+    };
+
+    // Element (i, j) is data[i * row_step + j * col_step], so row-major, column-major,
+    // sub-blocks and transposed matrices are all described by their strides
+    template<typename T>
+    class dynamic_matrix_ref {
+    public:
+        typedef typename std::remove_const<T>::type value_type;
+
+    private:
+        T *ptr;
+        size_t n_rows;
+        size_t n_cols;
+        ptrdiff_t r_step;
+        ptrdiff_t c_step;
+
+    public:
+        // Row-major with row_step elements between rows when col_step is 1
+        dynamic_matrix_ref(T *data, size_t rows, size_t cols, ptrdiff_t row_step, ptrdiff_t col_step = 1)
+                : ptr(data), n_rows(rows), n_cols(cols), r_step(row_step), c_step(col_step) {}
+
+        // Ref to the elements of a dynamic_matrix
+        dynamic_matrix_ref(dynamic_matrix<value_type> &m)
+                : ptr(m.rows() ? m.row_data(0) : nullptr), n_rows(m.rows()), n_cols(m.cols()),
+                  r_step(m.cols()), c_step(1) {}
+
+        template<typename U = T, typename = typename std::enable_if<std::is_const<U>::value>::type>
+        dynamic_matrix_ref(const dynamic_matrix<value_type> &m)
+                : ptr(m.rows() ? m.row_data(0) : nullptr), n_rows(m.rows()), n_cols(m.cols()),
+                  r_step(m.cols()), c_step(1) {}
+
+        // Ref to the elements of a fixed-size matrix
+        template<size_t N, size_t M, typename S, typename L>
+        dynamic_matrix_ref(matrix<value_type, N, M, S, L> &m)
+                : ptr(&m(0, 0)), n_rows(N), n_cols(M),
+                  r_step(matrix<value_type, N, M, S, L>::row_step), c_step(matrix<value_type, N, M, S, L>::col_step) {}
+
+        template<size_t N, size_t M, typename S, typename L,
+                 typename U = T, typename = typename std::enable_if<std::is_const<U>::value>::type>
+        dynamic_matrix_ref(const matrix<value_type, N, M, S, L> &m)
+                : ptr(&m(0, 0)), n_rows(N), n_cols(M),
+                  r_step(matrix<value_type, N, M, S, L>::row_step), c_step(matrix<value_type, N, M, S, L>::col_step) {}
+
+        // Read-only ref from writable one
+        template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+        dynamic_matrix_ref(const dynamic_matrix_ref<U> &ref)
+                : ptr(ref.data()), n_rows(ref.rows()), n_cols(ref.cols()),
+                  r_step(ref.row_step()), c_step(ref.col_step()) {}
+
+        dynamic_matrix_ref(const dynamic_matrix_ref &) = default;
+
+        // Copies elements, sizes must match
+        template<typename U>
+        dynamic_matrix_ref &operator=(const dynamic_matrix_ref<U> &val) {
+            assert(n_rows == val.rows() && n_cols == val.cols());
+
+            for_each([&](size_t i, size_t j, T &v) { v = val(i, j); });
+
+            return *this;
+        }
+
+        dynamic_matrix_ref &operator=(const dynamic_matrix_ref &val) {
+            return operator=<T>(val);
+        }
+
+        dynamic_matrix_ref &operator=(const dynamic_matrix<value_type> &val) {
+            return *this = dynamic_matrix_ref<const value_type>(val);
+        }
+
+        dynamic_matrix<value_type> to_dynamic_matrix() const {
+            dynamic_matrix<value_type> result(n_rows, n_cols);
+
+            for (size_t i = 0; i < n_rows; ++i)
+                for (size_t j = 0; j < n_cols; ++j)
+                    result(i, j) = (*this)(i, j);
+
+            return result;
+        }
+
+        T *data() const {
+            return ptr;
+        }
+
+        size_t rows() const {
+            return n_rows;
+        }
+
+        size_t cols() const {
+            return n_cols;
+        }
+
+        ptrdiff_t row_step() const {
+            return r_step;
+        }
+
+        ptrdiff_t col_step() const {
+            return c_step;
+        }
+
+        // Call f(i, j, element) for every element, the inner loop takes the smaller step
+        template<typename F>
+        void for_each(F &&f) const {
+            if (c_step <= r_step) {
+                for (size_t i = 0; i < n_rows; ++i)
+                    for (size_t j = 0; j < n_cols; ++j)
+                        f(i, j, (*this)(i, j));
+            } else {
+                for (size_t j = 0; j < n_cols; ++j)
+                    for (size_t i = 0; i < n_rows; ++i)
+                        f(i, j, (*this)(i, j));
+            }
+        }
+
+        // Refs to parts of the same memory:
+
+        dynamic_vector_ref<T> row(size_t i) const {
+            assert(i < n_rows);
+            return dynamic_vector_ref<T>(ptr + static_cast<ptrdiff_t>(i) * r_step, n_cols, c_step);
+        }
+
+        dynamic_vector_ref<T> col(size_t j) const {
+            assert(j < n_cols);
+            return dynamic_vector_ref<T>(ptr + static_cast<ptrdiff_t>(j) * c_step, n_rows, r_step);
+        }
+
+        dynamic_matrix_ref block(size_t i, size_t j, size_t rows, size_t cols) const {
+            assert(i + rows <= n_rows && j + cols <= n_cols);
+            return dynamic_matrix_ref(ptr + static_cast<ptrdiff_t>(i) * r_step + static_cast<ptrdiff_t>(j) * c_step,
+                                      rows, cols, r_step, c_step);
+        }
+
+        // Same memory read as the transposed matrix
+        dynamic_matrix_ref transposed() const {
+            return dynamic_matrix_ref(ptr, n_cols, n_rows, c_step, r_step);
+        }
+
+        // Vector product
+        dynamic_vector<value_type> operator*(const dynamic_vector_ref<const value_type> &vec) const {
+            assert(n_cols == vec.size());
+
+            dynamic_vector<value_type> result(n_rows);
+
+            for (size_t i = 0; i < n_rows; ++i)
+                result(i) = row(i) * vec;
+
+            return result;
+        }
+
+        // In-place operations on the referenced memory:
+
+        dynamic_matrix_ref &operator+=(const dynamic_matrix_ref<const value_type> &val) {
+            assert(n_rows == val.rows() && n_cols == val.cols());
+
+            for_each([&](size_t i, size_t j, T &v) { v += val(i, j); });
+
+            return *this;
+        }
+
+        dynamic_matrix_ref &operator-=(const dynamic_matrix_ref<const value_type> &val) {
+            assert(n_rows == val.rows() && n_cols == val.cols());
+
+            for_each([&](size_t i, size_t j, T &v) { v -= val(i, j); });
+
+            return *this;
+        }
+
+        dynamic_matrix_ref &operator+=(value_type val) {
+            for_each([=](size_t, size_t, T &v) { v += val; });
+            return *this;
+        }
+
+        dynamic_matrix_ref &operator-=(value_type val) {
+            for_each([=](size_t, size_t, T &v) { v -= val; });
+            return *this;
+        }
+
+        dynamic_matrix_ref &operator*=(value_type val) {
+            for_each([=](size_t, size_t, T &v) { v *= val; });
+            return *this;
+        }
+
+        dynamic_matrix_ref &operator/=(value_type val) {
+            for_each([=](size_t, size_t, T &v) { v /= val; });
+            return *this;
+        }
+
+        // Compare operations:
+
+        bool operator==(const dynamic_matrix_ref<const value_type> &m) const {
+            if (n_rows != m.rows() || n_cols != m.cols())
+                return false;
+
+            for (size_t i = 0; i < n_rows; ++i)
+                for (size_t j = 0; j < n_cols; ++j)
+                    if ((*this)(i, j) != m(i, j))
+                        return false;
+
+            return true;
+        }
+
+        bool operator!=(const dynamic_matrix_ref<const value_type> &m) const {
+            return !(*this == m);
+        }
+
+        // get/set selected element:
+
+        T &operator()(size_t row, size_t col) const {
+            assert(row < n_rows && col < n_cols);
+            return ptr[static_cast<ptrdiff_t>(row) * r_step + static_cast<ptrdiff_t>(col) * c_step];
+        }
+    };
+
+    // C = A * B written into the memory of c, which must not overlap a or b.
+    // Goes through parallel_gemm() with the strides of the refs, so large products run on the pool
+    template<typename T>
+    void multiply(const dynamic_matrix_ref<const T> &a, const dynamic_matrix_ref<const T> &b,
+                  const dynamic_matrix_ref<T> &c, thread_pool &pool = shared_thread_pool()) {
+        assert(a.cols() == b.rows() && c.rows() == a.rows() && c.cols() == b.cols());
+
+        dynamic_matrix_ref<T> out = c;
+        out.for_each([](size_t, size_t, T &v) { v = 0; });
+
+        if (a.rows() * a.cols() * b.cols() >= gemm_threshold) {
+            parallel_gemm(a.rows(), a.cols(), b.cols(),
+                          a.data(), a.row_step(), a.col_step(),
+                          b.data(), b.row_step(), b.col_step(),
+                          c.data(), c.row_step(), c.col_step(),
+                          pool);
+
+            return;
+        }
+
+        for (size_t i = 0; i < a.rows(); ++i)
+            for (size_t j = 0; j < a.cols(); ++j) {
+                const T v = a(i, j);
+
+                for (size_t k = 0; k < b.cols(); ++k)
+                    c(i, k) += v * b(j, k);
+            }
+    }
+
+    // Destinations of lazy expressions (see expression.h)
+    template<typename T, typename E>
+    void assign_expression(const dynamic_vector_ref<T> &dst, const E &e) {
+        LMEL_COUNT(expression, E::operations * dst.size(), (E::operands + 1) * dst.size() * sizeof(T), 0);
+
+        for (size_t i = 0; i < dst.size(); ++i)
+            dst(i) = e(i);
+    }
+
+    template<typename T, typename E>
+    void assign_expression(const dynamic_matrix_ref<T> &dst, const E &e) {
+        LMEL_COUNT(expression, E::operations * dst.rows() * dst.cols(),
+                   (E::operands + 1) * dst.rows() * dst.cols() * sizeof(T), 0);
+
+        for (size_t i = 0; i < dst.rows(); ++i)
+            for (size_t j = 0; j < dst.cols(); ++j)
+                dst(i, j) = e(i, j);
+    }
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <type_traits>
+#include <initializer_list>
+#include <limits>
+#include <cassert>
+#include <math.h>
+#include "aligned.h"
+#include "vector.h"
+#include "counters.h"
+
+namespace lmel {
+    // Vector with size chosen at runtime, elements are kept in aligned heap storage
+    template<
+            typename T,
+            typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+    >
+    class dynamic_vector {
+    private:
+        aligned_vector<T> data;
+
+    public:
+        typedef T value_type;
+
+        // Constructor with size and init value
+        explicit dynamic_vector(size_t size = 0, T init = 0)
+                : data(size, init) {}
+
+        // Initializer list constructor
+        dynamic_vector(std::initializer_list<T> il)
+                : data(il) {}
+
+        // Constructor from fixed-size vector
+        template<typename O, size_t N, typename S>
+        explicit dynamic_vector(const vector<O, N, S> &ref)
+                : data(N) {
+            for (size_t i = 0; i < N; ++i)
+                data[i] = ref(i);
+        }
+
+        // Template copy constructor (for other types)
+        template<typename O>
+        explicit dynamic_vector(const dynamic_vector<O> &ref)
+                : data(ref.size()) {
+            for (size_t i = 0; i < size(); ++i)
+                data[i] = ref(i);
+        }
+
+        dynamic_vector(const dynamic_vector &) = default;
+        dynamic_vector(dynamic_vector &&) noexcept = default;
+        dynamic_vector &operator=(const dynamic_vector &) = default;
+        dynamic_vector &operator=(dynamic_vector &&) noexcept = default;
+
+        // Conversion to fixed-size vector, sizes must match
+        template<size_t N>
+        vector<T, N> to_vector() const {
+            assert(size() == N);
+
+            vector<T, N> result(0);
+
+            for (size_t i = 0; i < N; ++i)
+                result(i) = data[i];
+
+            return result;
+        }
+
+        size_t size() const {
+            return data.size();
+        }
+
+        void resize(size_t size, T init = 0) {
+            data.resize(size, init);
+        }
+
+        T *begin() {
+            return data.data();
+        }
+
+        T *end() {
+            return data.data() + data.size();
+        }
+
+        const T *begin() const {
+            return data.data();
+        }
+
+        const T *end() const {
+            return data.data() + data.size();
+        }
+
+        // Vector length
+        double length() const {
+            LMEL_COUNT(length, 1, 0, 0);
+
+            T sum = *this * *this;
+
+            return sqrt(sum);
+        }
+
+        // Normalize vector
+        bool normalize() {
+            LMEL_COUNT(length, data.size(), 2 * data.size() * sizeof(T), 0);
+
+            double len = length();
+
+            if (len <= std::numeric_limits<double>::epsilon())
+                return false;
+
+            for (T &v : data)
+                v /= len;
+
+            return true;
+        }
+
+        // Default math operations:
+
+        dynamic_vector operator+(const dynamic_vector &val) const {
+            LMEL_COUNT_TEMPORARY(dynamic, 2 * data.size() * sizeof(T));
+
+            dynamic_vector result = *this;
+            result += val;
+            return result;
+        }
+
+        dynamic_vector operator-(const dynamic_vector &val) const {
+            LMEL_COUNT_TEMPORARY(dynamic, 2 * data.size() * sizeof(T));
+
+            dynamic_vector result = *this;
+            result -= val;
+            return result;
+        }
+
+        T operator*(const dynamic_vector &val) const {
+            LMEL_COUNT(dot, 2 * data.size(), 2 * data.size() * sizeof(T), 0);
+
+            assert(size() == val.size());
+
+            const T *a = data.data();
+            const T *b = val.data.data();
+            T prod = 0;
+
+            for (size_t i = 0, n = size(); i < n; ++i)
+                prod += a[i] * b[i];
+
+            return prod;
+        }
+
+        dynamic_vector &operator+=(const dynamic_vector &val) {
+            LMEL_COUNT(dynamic, data.size(), 3 * data.size() * sizeof(T), 0);
+
+            assert(size() == val.size());
+
+            T *a = data.data();
+            const T *b = val.data.data();
+
+            for (size_t i = 0, n = size(); i < n; ++i)
+                a[i] += b[i];
+
+            return *this;
+        }
+
+        dynamic_vector &operator-=(const dynamic_vector &val) {
+            LMEL_COUNT(dynamic, data.size(), 3 * data.size() * sizeof(T), 0);
+
+            assert(size() == val.size());
+
+            T *a = data.data();
+            const T *b = val.data.data();
+
+            for (size_t i = 0, n = size(); i < n; ++i)
+                a[i] -= b[i];
+
+            return *this;
+        }
+
+        dynamic_vector operator+(T val) const {
+            LMEL_COUNT_TEMPORARY(dynamic, 2 * data.size() * sizeof(T));
+
+            dynamic_vector result = *this;
+            result += val;
+            return result;
+        }
+
+        dynamic_vector operator-(T val) const {
+            LMEL_COUNT_TEMPORARY(dynamic, 2 * data.size() * sizeof(T));
+
+            dynamic_vector result = *this;
+            result -= val;
+            return result;
+        }
+
+        dynamic_vector operator*(T val) const {
+            LMEL_COUNT_TEMPORARY(dynamic, 2 * data.size() * sizeof(T));
+
+            dynamic_vector result = *this;
+            result *= val;
+            return result;
+        }
+
+        dynamic_vector operator/(T val) const {
+            LMEL_COUNT_TEMPORARY(dynamic, 2 * data.size() * sizeof(T));
+
+            dynamic_vector result = *this;
+            result /= val;
+            return result;
+        }
+
+        dynamic_vector &operator+=(T val) {
+            LMEL_COUNT(dynamic, data.size(), 2 * data.size() * sizeof(T), 0);
+
+            for (T &v : data)
+                v += val;
+
+            return *this;
+        }
+
+        dynamic_vector &operator-=(T val) {
+            LMEL_COUNT(dynamic, data.size(), 2 * data.size() * sizeof(T), 0);
+
+            for (T &v : data)
+                v -= val;
+
+            return *this;
+        }
+
+        dynamic_vector &operator*=(T val) {
+            LMEL_COUNT(dynamic, data.size(), 2 * data.size() * sizeof(T), 0);
+
+            for (T &v : data)
+                v *= val;
+
+            return *this;
+        }
+
+        dynamic_vector &operator/=(T val) {
+            LMEL_COUNT(dynamic, data.size(), 2 * data.size() * sizeof(T), 0);
+
+            for (T &v : data)
+                v /= val;
+
+            return *this;
+        }
+
+        // Compare operations:
+
+        bool operator==(const dynamic_vector &v) const {
+            return data == v.data;
+        }
+
+        bool operator!=(const dynamic_vector &v) const {
+            return data != v.data;
+        }
+
+        // get/set selected element:
+
+        T &operator()(size_t i) {
+            assert(i < size());
+            return data[i];
+        }
+
+        const T &operator()(size_t i) const {
+            assert(i < size());
+            return data[i];
+        }
+    };
+
+    // Result object for lazy expressions (see expression.h)
+    template<typename T>
+    dynamic_vector<T> make_expression_result(const dynamic_vector<T> &shape) {
+        return dynamic_vector<T>(shape.size());
+    }
+
+    template<typename T, typename E>
+    void assign_expression(dynamic_vector<T> &dst, const E &e) {
+        assert(dst.size() == e.shape().size());
+
+        LMEL_COUNT(expression, E::operations * dst.size(), (E::operands + 1) * dst.size() * sizeof(T), 0);
+
+        T *out = dst.begin();
+
+        for (size_t i = 0, n = dst.size(); i < n; ++i)
+            out[i] = e(i);
+    }
+
+    using int_dynamic_vector = dynamic_vector<int>;
+    using float_dynamic_vector = dynamic_vector<float>;
+    using double_dynamic_vector = dynamic_vector<double>;
+}
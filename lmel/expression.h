@@ -0,0 +1,316 @@
+#pragma once
+
+#include <type_traits>
+#include "vector.h"
+#include "matrix.h"
+#include "counters.h"
+
+namespace lmel {
+    // Lazy element-wise expressions (opt-in).
+    //
+    // lazy(x) wraps a vector or matrix, arithmetic on the wrapped value builds an
+    // expression tree instead of a temporary, and the whole chain is computed in
+    // one loop when the expression is converted to the result type:
+    //
+    //     float_vector4d r = lazy(a) * s + b - c;
+    //
+    // Operands are held by reference, so an expression must not outlive them.
+
+    template<typename E>
+    struct expression {
+        constexpr const E &self() const {
+            return static_cast<const E &>(*this);
+        }
+    };
+
+    template<typename E>
+    struct is_expression : std::is_base_of<expression<E>, E> {};
+
+    // Hooks for types usable as expression results, found by argument-dependent
+    // lookup so that other containers can add their own overloads:
+
+    // Result object for expression of given shape, contents are overwritten
+    template<typename V>
+    constexpr V make_expression_result(const V &) {
+        return V(0);
+    }
+
+    // Copy expression elements into destination
+    template<typename T, size_t N, typename S, typename E>
+    constexpr void assign_expression(vector<T, N, S> &dst, const E &e) {
+        LMEL_COUNT(expression, E::operations * N, (E::operands + 1) * N * sizeof(T), 0);
+
+        for (size_t i = 0; i < N; ++i)
+            dst(i) = e(i);
+    }
+
+    template<typename T, size_t N, size_t M, typename S, typename L, typename E>
+    constexpr void assign_expression(matrix<T, N, M, S, L> &dst, const E &e) {
+        LMEL_COUNT(expression, E::operations * N * M, (E::operands + 1) * N * M * sizeof(T), 0);
+
+        for (size_t i = 0; i < N; ++i)
+            for (size_t j = 0; j < M; ++j)
+                dst(i, j) = e(i, j);
+    }
+
+    // Leaf node: reference to vector or matrix
+    template<typename V>
+    class terminal : public expression<terminal<V>> {
+    private:
+        const V &ref;
+
+    public:
+        typedef V value_type;
+
+        // Element-wise operations and operands read per element, for the operation counters
+        static constexpr size_t operations = 0;
+        static constexpr size_t operands = 1;
+
+        constexpr explicit terminal(const V &ref)
+                : ref(ref) {}
+
+        constexpr const V &shape() const {
+            return ref;
+        }
+
+        template<typename... I>
+        constexpr auto operator()(I... i) const {
+            return ref(i...);
+        }
+
+        constexpr value_type eval() const {
+            return ref;
+        }
+
+        constexpr operator value_type() const {
+            return ref;
+        }
+    };
+
+    // Inner node: element-wise operation on two operands
+    template<typename L, typename R, typename Op>
+    class binary_expression : public expression<binary_expression<L, R, Op>> {
+    private:
+        L left;
+        R right;
+
+    public:
+        typedef typename L::value_type value_type;
+
+        static constexpr size_t operations = L::operations + R::operations + 1;
+        static constexpr size_t operands = L::operands + R::operands;
+
+        constexpr binary_expression(const L &left, const R &right)
+                : left(left), right(right) {}
+
+        constexpr const value_type &shape() const {
+            return left.shape();
+        }
+
+        template<typename... I>
+        constexpr auto operator()(I... i) const {
+            return Op::apply(left(i...), right(i...));
+        }
+
+        constexpr value_type eval() const {
+            value_type result = make_expression_result(shape());
+            assign_expression(result, *this);
+            return result;
+        }
+
+        constexpr operator value_type() const {
+            return eval();
+        }
+    };
+
+    // Inner node: element-wise operation with scalar
+    template<typename L, typename S, typename Op>
+    class scalar_expression : public expression<scalar_expression<L, S, Op>> {
+    private:
+        L left;
+        S right;
+
+    public:
+        typedef typename L::value_type value_type;
+
+        static constexpr size_t operations = L::operations + 1;
+        static constexpr size_t operands = L::operands;
+
+        constexpr scalar_expression(const L &left, S right)
+                : left(left), right(right) {}
+
+        constexpr const value_type &shape() const {
+            return left.shape();
+        }
+
+        template<typename... I>
+        constexpr auto operator()(I... i) const {
+            return Op::apply(left(i...), right);
+        }
+
+        constexpr value_type eval() const {
+            value_type result = make_expression_result(shape());
+            assign_expression(result, *this);
+            return result;
+        }
+
+        constexpr operator value_type() const {
+            return eval();
+        }
+    };
+
+    namespace op {
+        struct add {
+            template<typename A, typename B>
+            static constexpr auto apply(A a, B b) { return a + b; }
+        };
+
+        struct sub {
+            template<typename A, typename B>
+            static constexpr auto apply(A a, B b) { return a - b; }
+        };
+
+        struct mul {
+            template<typename A, typename B>
+            static constexpr auto apply(A a, B b) { return a * b; }
+        };
+
+        struct div {
+            template<typename A, typename B>
+            static constexpr auto apply(A a, B b) { return a / b; }
+        };
+
+        // b - a, for scalar on the left side
+        struct rsub {
+            template<typename A, typename B>
+            static constexpr auto apply(A a, B b) { return b - a; }
+        };
+    }
+
+    template<typename V>
+    constexpr terminal<V> lazy(const V &val) {
+        return terminal<V>(val);
+    }
+
+    namespace detail {
+        // Expressions are stored by value, vectors and matrices become terminals
+        template<typename V, bool = is_expression<V>::value>
+        struct operand {
+            typedef V type;
+
+            static constexpr const V &wrap(const V &val) { return val; }
+        };
+
+        template<typename V>
+        struct operand<V, false> {
+            typedef terminal<V> type;
+
+            static constexpr terminal<V> wrap(const V &val) { return terminal<V>(val); }
+        };
+
+        // At least one side must be an expression, none may be a scalar
+        template<typename A, typename B>
+        using enable_binary = typename std::enable_if<
+                (is_expression<A>::value || is_expression<B>::value) &&
+                !std::is_arithmetic<A>::value && !std::is_arithmetic<B>::value
+        >::type;
+
+        template<typename E, typename S>
+        using enable_scalar = typename std::enable_if<
+                is_expression<E>::value && std::is_arithmetic<S>::value
+        >::type;
+
+        // Compile-time shape of an expression result, 0 when the size is only known at run time
+        struct extent {
+            size_t rows;
+            size_t cols;
+        };
+
+        template<typename T, size_t N, typename S>
+        constexpr extent static_extent(const vector<T, N, S> *) { return {N, 1}; }
+
+        template<typename T, size_t N, size_t M, typename S, typename L>
+        constexpr extent static_extent(const matrix<T, N, M, S, L> *) { return {N, M}; }
+
+        constexpr extent static_extent(const void *) { return {0, 0}; }
+
+        template<typename A, typename B>
+        constexpr bool same_extent() {
+            constexpr extent a = static_extent(static_cast<const typename A::value_type *>(nullptr));
+            constexpr extent b = static_extent(static_cast<const typename B::value_type *>(nullptr));
+
+            return a.rows == 0 || b.rows == 0 || (a.rows == b.rows && a.cols == b.cols);
+        }
+
+        template<typename Op, typename A, typename B>
+        constexpr binary_expression<typename operand<A>::type, typename operand<B>::type, Op>
+        make_binary(const A &a, const B &b) {
+            typedef typename operand<A>::type left;
+            typedef typename operand<B>::type right;
+
+            static_assert(std::is_same<typename left::value_type::value_type,
+                                  typename right::value_type::value_type>::value,
+                          "Operands of an expression must have the same element type");
+            static_assert(same_extent<left, right>(), "Operands of an expression must have the same shape");
+
+            return {operand<A>::wrap(a), operand<B>::wrap(b)};
+        }
+    }
+
+    template<typename A, typename B, typename = detail::enable_binary<A, B>>
+    constexpr auto operator+(const A &a, const B &b) {
+        return detail::make_binary<op::add>(a, b);
+    }
+
+    template<typename A, typename B, typename = detail::enable_binary<A, B>>
+    constexpr auto operator-(const A &a, const B &b) {
+        return detail::make_binary<op::sub>(a, b);
+    }
+
+    template<typename E, typename S, typename = detail::enable_scalar<E, S>>
+    constexpr scalar_expression<E, S, op::add> operator+(const E &e, S s) {
+        return {e, s};
+    }
+
+    template<typename E, typename S, typename = detail::enable_scalar<E, S>>
+    constexpr scalar_expression<E, S, op::add> operator+(S s, const E &e) {
+        return {e, s};
+    }
+
+    template<typename E, typename S, typename = detail::enable_scalar<E, S>>
+    constexpr scalar_expression<E, S, op::sub> operator-(const E &e, S s) {
+        return {e, s};
+    }
+
+    template<typename E, typename S, typename = detail::enable_scalar<E, S>>
+    constexpr scalar_expression<E, S, op::rsub> operator-(S s, const E &e) {
+        return {e, s};
+    }
+
+    template<typename E, typename S, typename = detail::enable_scalar<E, S>>
+    constexpr scalar_expression<E, S, op::mul> operator*(const E &e, S s) {
+        return {e, s};
+    }
+
+    template<typename E, typename S, typename = detail::enable_scalar<E, S>>
+    constexpr scalar_expression<E, S, op::mul> operator*(S s, const E &e) {
+        return {e, s};
+    }
+
+    template<typename E, typename S, typename = detail::enable_scalar<E, S>>
+    constexpr scalar_expression<E, S, op::div> operator/(const E &e, S s) {
+        return {e, s};
+    }
+
+    template<typename E, typename = typename std::enable_if<is_expression<E>::value>::type>
+    constexpr scalar_expression<E, int, op::rsub> operator-(const E &e) {
+        return {e, 0};
+    }
+
+    // Compute expression into existing object without a temporary
+    template<typename V, typename E, typename = typename std::enable_if<is_expression<E>::value>::type>
+    constexpr V &assign(V &dst, const E &e) {
+        assign_expression(dst, e);
+        return dst;
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <math.h>
+#include "simd.h"
+
+namespace lmel {
+    // Math policies for functions that take one as a tag argument,
+    // e.g. v.normalize(fast_math()) or make_quaternion<float>(axis, angle, fast_math()).
+    // Every policy has scalar and batch versions of rsqrt and sincos.
+
+    // Standard library functions, correctly rounded as far as libm is
+    struct precise_math {
+        template<typename T>
+        static T rsqrt(T x) {
+            return 1 / sqrt(x);
+        }
+
+        template<typename T>
+        static void sincos(T x, T &s, T &c) {
+            s = sin(x);
+            c = cos(x);
+        }
+
+        template<typename T>
+        static void rsqrt(const T *in, T *out, size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = rsqrt(in[i]);
+        }
+
+        template<typename T>
+        static void sincos(const T *in, T *s, T *c, size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                sincos(in[i], s[i], c[i]);
+        }
+    };
+
+    // Approximations for rendering, not for simulation. Error bounds (checked in test/fast_math.cpp):
+    //
+    //  rsqrt(float)   relative error below 5e-7 for positive normal x (hardware estimate and
+    //                 one Newton step); double has no fast path and returns 1 / sqrt(x)
+    //  sincos(x)      absolute error below 1e-7 for float and 1e-8 for double, for |x| <= 8192;
+    //                 larger arguments are not supported. Range reduction to [-pi/4, pi/4]
+    //                 and minimax polynomials of degree 7 (sin) and 8 (cos)
+    struct fast_math {
+        static float rsqrt(float x) {
+#ifdef LMEL_SSE2
+            const float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+
+            return y * (1.5f - 0.5f * x * y * y);
+#else
+            return 1 / sqrtf(x);
+#endif
+        }
+
+        static double rsqrt(double x) {
+            return 1 / sqrt(x);
+        }
+
+        template<typename T>
+        static void sincos(T x, T &s, T &c) {
+            static_assert(std::is_floating_point<T>::value, "sincos needs a floating point type");
+
+            // pi / 4 split in three parts, so that j * pi / 4 is subtracted exactly
+            const T dp1 = T(0.78515625);
+            const T dp2 = T(2.4187564849853515625e-4);
+            const T dp3 = T(3.77489497744594108e-8);
+
+            const bool negative = x < 0;
+            const T a = negative ? -x : x;
+
+            // Even octant number j, x - j * pi / 4 is in [-pi/4, pi/4]
+            int32_t j = static_cast<int32_t>(a * T(1.27323954473516));
+            j = (j + 1) & ~1;
+
+            const T y = static_cast<T>(j);
+            const T r = ((a - y * dp1) - y * dp2) - y * dp3;
+            const T z = r * r;
+
+            const T ps = ((T(-1.9515295891e-4) * z + T(8.3321608736e-3)) * z - T(1.6666654611e-1)) * z * r + r;
+            const T pc = ((T(2.443315711809948e-5) * z - T(1.388731625493765e-3)) * z + T(4.166664568298827e-2)) * z * z
+                         - T(0.5) * z + 1;
+
+            // Quadrant q = j / 2: sin, cos = (S, C), (C, -S), (-S, -C), (-C, S)
+            const bool swap = (j & 2) != 0;
+            const bool sin_negative = ((j & 4) != 0) != negative;
+            const bool cos_negative = ((j & 2) != 0) != ((j & 4) != 0);
+
+            const T sv = swap ? pc : ps;
+            const T cv = swap ? ps : pc;
+
+            s = sin_negative ? -sv : sv;
+            c = cos_negative ? -cv : cv;
+        }
+
+        static void rsqrt(const float *in, float *out, size_t count) {
+            size_t i = 0;
+
+#ifdef LMEL_SSE2
+            const __m128 half = _mm_set1_ps(0.5f);
+            const __m128 three_halves = _mm_set1_ps(1.5f);
+
+            for (const size_t end = count & ~size_t(3); i < end; i += 4) {
+                const __m128 x = _mm_loadu_ps(in + i);
+                const __m128 y = _mm_rsqrt_ps(x);
+                const __m128 t = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(half, x), y), y);
+
+                _mm_storeu_ps(out + i, _mm_mul_ps(y, _mm_sub_ps(three_halves, t)));
+            }
+#endif
+            for (; i < count; ++i)
+                out[i] = rsqrt(in[i]);
+        }
+
+        static void rsqrt(const double *in, double *out, size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = rsqrt(in[i]);
+        }
+
+        // Branch-free scalar code, the compiler vectorizes the loop
+        template<typename T>
+        static void sincos(const T *in, T *s, T *c, size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                sincos(in[i], s[i], c[i]);
+        }
+    };
+}
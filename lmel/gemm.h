@@ -0,0 +1,308 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <new>
+#include "simd.h"
+#include "counters.h"
+
+#if defined(LMEL_AVX)
+#include <immintrin.h>
+#endif
+
+namespace lmel {
+    // Products with at least this many multiply-adds (N * M * K) go through gemm()
+    static const size_t gemm_threshold = 32 * 32 * 32;
+
+    namespace detail {
+        // Aligned scratch memory for packed panels
+        template<typename T>
+        class gemm_buffer {
+        private:
+            T *ptr;
+
+        public:
+            explicit gemm_buffer(size_t size)
+                    : ptr(static_cast<T *>(::operator new(size * sizeof(T), std::align_val_t(64)))) {}
+
+            gemm_buffer(const gemm_buffer &) = delete;
+            gemm_buffer &operator=(const gemm_buffer &) = delete;
+
+            ~gemm_buffer() {
+                ::operator delete(ptr, std::align_val_t(64));
+            }
+
+            T *data() {
+                return ptr;
+            }
+        };
+
+        // Register tile MR x NR computed by the micro-kernel and cache block sizes:
+        // an MC x KC block of A stays in L2, a KC x NR panel of B in L1.
+        template<typename T>
+        struct gemm_config {
+            static constexpr size_t mr = 4;
+            static constexpr size_t nr = 4;
+            static constexpr size_t mc = 128;
+            static constexpr size_t kc = 256;
+            static constexpr size_t nc = 4096;
+        };
+
+        // Generic micro-kernel: C(mr x nr tile) += packed A panel * packed B panel.
+        // Accumulators start from C, so every element is summed in index order.
+        template<typename T>
+        struct gemm_kernel {
+            typedef gemm_config<T> config;
+
+            static void run(size_t kc, const T *pa, const T *pb, T *c, ptrdiff_t rs, ptrdiff_t cs, size_t m, size_t n) {
+                const size_t mr = config::mr;
+                const size_t nr = config::nr;
+
+                T acc[mr][nr] = {};
+
+                for (size_t i = 0; i < m; ++i)
+                    for (size_t j = 0; j < n; ++j)
+                        acc[i][j] = c[i * rs + j * cs];
+
+                for (size_t p = 0; p < kc; ++p, pa += mr, pb += nr)
+                    for (size_t i = 0; i < mr; ++i)
+                        for (size_t j = 0; j < nr; ++j)
+                            acc[i][j] += pa[i] * pb[j];
+
+                for (size_t i = 0; i < m; ++i)
+                    for (size_t j = 0; j < n; ++j)
+                        c[i * rs + j * cs] = acc[i][j];
+            }
+        };
+
+#ifdef LMEL_AVX
+        template<>
+        struct gemm_config<double> {
+            static constexpr size_t mr = 6;
+            static constexpr size_t nr = 8;
+            static constexpr size_t mc = 96;
+            static constexpr size_t kc = 256;
+            static constexpr size_t nc = 4096;
+        };
+
+        template<>
+        struct gemm_config<float> {
+            static constexpr size_t mr = 6;
+            static constexpr size_t nr = 16;
+            static constexpr size_t mc = 96;
+            static constexpr size_t kc = 256;
+            static constexpr size_t nc = 4096;
+        };
+
+#ifdef __FMA__
+#define LMEL_GEMM_FMADD_PD(a, b, c) _mm256_fmadd_pd(a, b, c)
+#define LMEL_GEMM_FMADD_PS(a, b, c) _mm256_fmadd_ps(a, b, c)
+#else
+#define LMEL_GEMM_FMADD_PD(a, b, c) _mm256_add_pd(_mm256_mul_pd(a, b), c)
+#define LMEL_GEMM_FMADD_PS(a, b, c) _mm256_add_ps(_mm256_mul_ps(a, b), c)
+#endif
+
+// One row of the register tile: broadcast A(i) and update both accumulators of the row
+#define LMEL_GEMM_ROW(i) \
+        a = LMEL_GEMM_BROADCAST(pa + i); \
+        c##i##0 = LMEL_GEMM_FMADD(a, b0, c##i##0); \
+        c##i##1 = LMEL_GEMM_FMADD(a, b1, c##i##1);
+
+        // 6 x 8 tile: twelve ymm accumulators, two loads of B and six broadcasts of A per step
+        template<>
+        struct gemm_kernel<double> {
+            static void run(size_t kc, const double *pa, const double *pb, double *c, ptrdiff_t rs, ptrdiff_t cs, size_t m, size_t n) {
+#define LMEL_GEMM_BROADCAST _mm256_broadcast_sd
+#define LMEL_GEMM_FMADD LMEL_GEMM_FMADD_PD
+                alignas(32) double t[6][8] = {};
+
+                for (size_t i = 0; i < m; ++i)
+                    for (size_t j = 0; j < n; ++j)
+                        t[i][j] = c[i * rs + j * cs];
+
+                __m256d c00 = _mm256_load_pd(t[0]), c01 = _mm256_load_pd(t[0] + 4);
+                __m256d c10 = _mm256_load_pd(t[1]), c11 = _mm256_load_pd(t[1] + 4);
+                __m256d c20 = _mm256_load_pd(t[2]), c21 = _mm256_load_pd(t[2] + 4);
+                __m256d c30 = _mm256_load_pd(t[3]), c31 = _mm256_load_pd(t[3] + 4);
+                __m256d c40 = _mm256_load_pd(t[4]), c41 = _mm256_load_pd(t[4] + 4);
+                __m256d c50 = _mm256_load_pd(t[5]), c51 = _mm256_load_pd(t[5] + 4);
+
+                for (size_t p = 0; p < kc; ++p, pa += 6, pb += 8) {
+                    __m256d b0 = _mm256_load_pd(pb);
+                    __m256d b1 = _mm256_load_pd(pb + 4);
+                    __m256d a;
+
+                    LMEL_GEMM_ROW(0)
+                    LMEL_GEMM_ROW(1)
+                    LMEL_GEMM_ROW(2)
+                    LMEL_GEMM_ROW(3)
+                    LMEL_GEMM_ROW(4)
+                    LMEL_GEMM_ROW(5)
+                }
+
+                _mm256_store_pd(t[0], c00), _mm256_store_pd(t[0] + 4, c01);
+                _mm256_store_pd(t[1], c10), _mm256_store_pd(t[1] + 4, c11);
+                _mm256_store_pd(t[2], c20), _mm256_store_pd(t[2] + 4, c21);
+                _mm256_store_pd(t[3], c30), _mm256_store_pd(t[3] + 4, c31);
+                _mm256_store_pd(t[4], c40), _mm256_store_pd(t[4] + 4, c41);
+                _mm256_store_pd(t[5], c50), _mm256_store_pd(t[5] + 4, c51);
+
+                for (size_t i = 0; i < m; ++i)
+                    for (size_t j = 0; j < n; ++j)
+                        c[i * rs + j * cs] = t[i][j];
+#undef LMEL_GEMM_BROADCAST
+#undef LMEL_GEMM_FMADD
+            }
+        };
+
+        // 6 x 16 tile, same shape as the double kernel with 8 floats per register
+        template<>
+        struct gemm_kernel<float> {
+            static void run(size_t kc, const float *pa, const float *pb, float *c, ptrdiff_t rs, ptrdiff_t cs, size_t m, size_t n) {
+#define LMEL_GEMM_BROADCAST _mm256_broadcast_ss
+#define LMEL_GEMM_FMADD LMEL_GEMM_FMADD_PS
+                alignas(32) float t[6][16] = {};
+
+                for (size_t i = 0; i < m; ++i)
+                    for (size_t j = 0; j < n; ++j)
+                        t[i][j] = c[i * rs + j * cs];
+
+                __m256 c00 = _mm256_load_ps(t[0]), c01 = _mm256_load_ps(t[0] + 8);
+                __m256 c10 = _mm256_load_ps(t[1]), c11 = _mm256_load_ps(t[1] + 8);
+                __m256 c20 = _mm256_load_ps(t[2]), c21 = _mm256_load_ps(t[2] + 8);
+                __m256 c30 = _mm256_load_ps(t[3]), c31 = _mm256_load_ps(t[3] + 8);
+                __m256 c40 = _mm256_load_ps(t[4]), c41 = _mm256_load_ps(t[4] + 8);
+                __m256 c50 = _mm256_load_ps(t[5]), c51 = _mm256_load_ps(t[5] + 8);
+
+                for (size_t p = 0; p < kc; ++p, pa += 6, pb += 16) {
+                    __m256 b0 = _mm256_load_ps(pb);
+                    __m256 b1 = _mm256_load_ps(pb + 8);
+                    __m256 a;
+
+                    LMEL_GEMM_ROW(0)
+                    LMEL_GEMM_ROW(1)
+                    LMEL_GEMM_ROW(2)
+                    LMEL_GEMM_ROW(3)
+                    LMEL_GEMM_ROW(4)
+                    LMEL_GEMM_ROW(5)
+                }
+
+                _mm256_store_ps(t[0], c00), _mm256_store_ps(t[0] + 8, c01);
+                _mm256_store_ps(t[1], c10), _mm256_store_ps(t[1] + 8, c11);
+                _mm256_store_ps(t[2], c20), _mm256_store_ps(t[2] + 8, c21);
+                _mm256_store_ps(t[3], c30), _mm256_store_ps(t[3] + 8, c31);
+                _mm256_store_ps(t[4], c40), _mm256_store_ps(t[4] + 8, c41);
+                _mm256_store_ps(t[5], c50), _mm256_store_ps(t[5] + 8, c51);
+
+                for (size_t i = 0; i < m; ++i)
+                    for (size_t j = 0; j < n; ++j)
+                        c[i * rs + j * cs] = t[i][j];
+#undef LMEL_GEMM_BROADCAST
+#undef LMEL_GEMM_FMADD
+            }
+        };
+
+#undef LMEL_GEMM_ROW
+#undef LMEL_GEMM_FMADD_PD
+#undef LMEL_GEMM_FMADD_PS
+#endif
+
+        // Copy m x k block of A into row panels of MR, each stored column by column.
+        // Rows past the end of A are zero
+        template<typename T>
+        void gemm_pack_a(size_t m, size_t k, const T *a, ptrdiff_t rs, ptrdiff_t cs, T *out) {
+            const size_t mr = gemm_config<T>::mr;
+
+            for (size_t i0 = 0; i0 < m; i0 += mr) {
+                const size_t rows = std::min(mr, m - i0);
+
+                for (size_t p = 0; p < k; ++p) {
+                    for (size_t i = 0; i < rows; ++i)
+                        out[i] = a[(i0 + i) * rs + p * cs];
+
+                    for (size_t i = rows; i < mr; ++i)
+                        out[i] = 0;
+
+                    out += mr;
+                }
+            }
+        }
+
+        // Copy k x n block of B into column panels of NR, each stored row by row.
+        // Columns past the end of B are zero
+        template<typename T>
+        void gemm_pack_b(size_t k, size_t n, const T *b, ptrdiff_t rs, ptrdiff_t cs, T *out) {
+            const size_t nr = gemm_config<T>::nr;
+
+            for (size_t j0 = 0; j0 < n; j0 += nr) {
+                const size_t cols = std::min(nr, n - j0);
+
+                for (size_t p = 0; p < k; ++p) {
+                    for (size_t j = 0; j < cols; ++j)
+                        out[j] = b[p * rs + (j0 + j) * cs];
+
+                    for (size_t j = cols; j < nr; ++j)
+                        out[j] = 0;
+
+                    out += nr;
+                }
+            }
+        }
+    }
+
+    namespace detail {
+        // gemm() without the operation counters, for callers that count the whole product once
+        template<typename T>
+        void gemm_blocks(size_t n, size_t m, size_t k,
+                         const T *a, ptrdiff_t a_rs, ptrdiff_t a_cs,
+                         const T *b, ptrdiff_t b_rs, ptrdiff_t b_cs,
+                         T *c, ptrdiff_t c_rs, ptrdiff_t c_cs) {
+            typedef gemm_config<T> config;
+
+            const size_t mr = config::mr;
+            const size_t nr = config::nr;
+
+            gemm_buffer<T> pack_a(config::mc * config::kc);
+            gemm_buffer<T> pack_b(config::kc * ((std::min(config::nc, k) + nr - 1) / nr * nr));
+
+            for (size_t jc = 0; jc < k; jc += config::nc) {
+                const size_t nc = std::min(config::nc, k - jc);
+
+                for (size_t pc = 0; pc < m; pc += config::kc) {
+                    const size_t kc = std::min(config::kc, m - pc);
+
+                    gemm_pack_b(kc, nc, b + pc * b_rs + jc * b_cs, b_rs, b_cs, pack_b.data());
+
+                    for (size_t ic = 0; ic < n; ic += config::mc) {
+                        const size_t mc = std::min(config::mc, n - ic);
+
+                        gemm_pack_a(mc, kc, a + ic * a_rs + pc * a_cs, a_rs, a_cs, pack_a.data());
+
+                        for (size_t jr = 0; jr < nc; jr += nr)
+                            for (size_t ir = 0; ir < mc; ir += mr)
+                                gemm_kernel<T>::run(
+                                        kc,
+                                        pack_a.data() + ir * kc,
+                                        pack_b.data() + jr * kc,
+                                        c + (ic + ir) * c_rs + (jc + jr) * c_cs, c_rs, c_cs,
+                                        std::min(mr, mc - ir), std::min(nr, nc - jr)
+                                );
+                    }
+                }
+            }
+        }
+    }
+
+    // General matrix product C += A * B with A of size n x m, B of size m x k and C of size n x k.
+    // Every operand is given by pointer to its first element, row stride and column stride,
+    // so row- and column-major storage and sub-blocks are all accepted.
+    template<typename T>
+    void gemm(size_t n, size_t m, size_t k,
+              const T *a, ptrdiff_t a_rs, ptrdiff_t a_cs,
+              const T *b, ptrdiff_t b_rs, ptrdiff_t b_cs,
+              T *c, ptrdiff_t c_rs, ptrdiff_t c_cs) {
+        LMEL_COUNT(gemm, 2 * n * m * k, (n * m + m * k + 2 * n * k) * sizeof(T), 0);
+
+        detail::gemm_blocks(n, m, k, a, a_rs, a_cs, b, b_rs, b_cs, c, c_rs, c_cs);
+    }
+}
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "simd.h"
+
+#if defined(LMEL_AVX) && defined(__F16C__)
+#define LMEL_F16C 1
+#endif
+
+namespace lmel {
+    // 16-bit storage scalars. Arithmetic converts to float, so every operation is
+    // computed in fp32 and only rounded when the result is stored back into T.
+    //
+    //     half: IEEE binary16, 11-bit precision, range +-65504
+    //     bfloat16: upper half of a float, 8-bit precision, float range
+    //
+    // Conversions from float round to nearest even.
+
+    namespace detail {
+        inline uint32_t float_bits(float f) {
+            uint32_t u;
+            std::memcpy(&u, &f, sizeof(u));
+            return u;
+        }
+
+        inline float bits_float(uint32_t u) {
+            float f;
+            std::memcpy(&f, &u, sizeof(f));
+            return f;
+        }
+
+        inline uint16_t float_to_half_bits(float f) {
+#ifdef LMEL_F16C
+            return static_cast<uint16_t>(_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT));
+#else
+            const uint32_t u = float_bits(f);
+            const uint32_t sign = (u >> 16) & 0x8000;
+            const uint32_t abs = u & 0x7fffffff;
+
+            // NaN stays quiet NaN, overflow rounds to infinity
+            if (abs > 0x7f800000)
+                return static_cast<uint16_t>(sign | 0x7e00 | ((abs >> 13) & 0x3ff));
+
+            if (abs >= 0x477ff000)
+                return static_cast<uint16_t>(sign | 0x7c00);
+
+            // Subnormal half: add 0.5 so the FPU rounds the mantissa to nearest even
+            if (abs < 0x38800000)
+                return static_cast<uint16_t>(sign | (float_bits(bits_float(abs) + 0.5f) - 0x3f000000));
+
+            const uint32_t odd = (abs >> 13) & 1;
+
+            return static_cast<uint16_t>(sign | ((abs + 0xc8000fff + odd) >> 13));
+#endif
+        }
+
+        inline float half_bits_to_float(uint16_t h) {
+#ifdef LMEL_F16C
+            return _cvtsh_ss(h);
+#else
+            const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+            const uint32_t abs = h & 0x7fff;
+
+            if (abs >= 0x7c00)
+                return bits_float(sign | 0x7f800000 | ((abs & 0x3ff) << 13));
+
+            // Subnormal half: value is the mantissa times 2^-24
+            if (abs < 0x0400)
+                return bits_float(sign | float_bits(float(abs) * 5.9604644775390625e-8f));
+
+            return bits_float(sign | ((abs << 13) + 0x38000000));
+#endif
+        }
+
+        inline uint16_t float_to_bfloat16_bits(float f) {
+            uint32_t u = float_bits(f);
+
+            if ((u & 0x7fffffff) > 0x7f800000)
+                return static_cast<uint16_t>((u >> 16) | 0x40);
+
+            u += 0x7fff + ((u >> 16) & 1);
+
+            return static_cast<uint16_t>(u >> 16);
+        }
+
+        inline float bfloat16_bits_to_float(uint16_t b) {
+            return bits_float(static_cast<uint32_t>(b) << 16);
+        }
+    }
+
+    class half {
+    private:
+        uint16_t bits = 0;
+
+    public:
+        half() = default;
+
+        half(float f)
+                : bits(detail::float_to_half_bits(f)) {}
+
+        operator float() const {
+            return detail::half_bits_to_float(bits);
+        }
+
+        static half from_bits(uint16_t bits) {
+            half h;
+            h.bits = bits;
+            return h;
+        }
+
+        uint16_t to_bits() const {
+            return bits;
+        }
+
+        // Compound operations compute in float:
+
+        half &operator+=(float val) {
+            return *this = float(*this) + val;
+        }
+
+        half &operator-=(float val) {
+            return *this = float(*this) - val;
+        }
+
+        half &operator*=(float val) {
+            return *this = float(*this) * val;
+        }
+
+        half &operator/=(float val) {
+            return *this = float(*this) / val;
+        }
+    };
+
+    class bfloat16 {
+    private:
+        uint16_t bits = 0;
+
+    public:
+        bfloat16() = default;
+
+        bfloat16(float f)
+                : bits(detail::float_to_bfloat16_bits(f)) {}
+
+        operator float() const {
+            return detail::bfloat16_bits_to_float(bits);
+        }
+
+        static bfloat16 from_bits(uint16_t bits) {
+            bfloat16 b;
+            b.bits = bits;
+            return b;
+        }
+
+        uint16_t to_bits() const {
+            return bits;
+        }
+
+        bfloat16 &operator+=(float val) {
+            return *this = float(*this) + val;
+        }
+
+        bfloat16 &operator-=(float val) {
+            return *this = float(*this) - val;
+        }
+
+        bfloat16 &operator*=(float val) {
+            return *this = float(*this) * val;
+        }
+
+        bfloat16 &operator/=(float val) {
+            return *this = float(*this) / val;
+        }
+    };
+
+    static_assert(sizeof(half) == 2 && sizeof(bfloat16) == 2, "16-bit scalars must be 2 bytes");
+
+    // Element types accepted by vector, matrix, square_matrix, quaternion and vector_batch
+    template<typename T>
+    struct is_element : std::is_arithmetic<T> {};
+
+    template<>
+    struct is_element<half> : std::true_type {};
+
+    template<>
+    struct is_element<bfloat16> : std::true_type {};
+
+    // 16-bit storage scalars, computed in float
+    template<typename T>
+    struct is_storage_scalar : std::false_type {};
+
+    template<>
+    struct is_storage_scalar<half> : std::true_type {};
+
+    template<>
+    struct is_storage_scalar<bfloat16> : std::true_type {};
+
+    // Type of sums and reductions (dot products, lengths, determinants): float for the
+    // 16-bit scalars, T itself otherwise
+    template<typename T>
+    using accumulate_t = typename std::conditional<is_storage_scalar<T>::value, float, T>::type;
+
+    // Bulk conversions, count elements from in to out. With F16C (half) and AVX2 (bfloat16)
+    // eight elements are converted per instruction sequence:
+
+    inline void convert(const half *in, float *out, size_t count) {
+        size_t i = 0;
+
+#ifdef LMEL_F16C
+        for (; i + 8 <= count; i += 8)
+            _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i))));
+#endif
+        for (; i < count; ++i)
+            out[i] = in[i];
+    }
+
+    inline void convert(const float *in, half *out, size_t count) {
+        size_t i = 0;
+
+#ifdef LMEL_F16C
+        for (; i + 8 <= count; i += 8)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                             _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+        for (; i < count; ++i)
+            out[i] = in[i];
+    }
+
+    inline void convert(const bfloat16 *in, float *out, size_t count) {
+        size_t i = 0;
+
+#ifdef LMEL_AVX2
+        for (; i + 8 <= count; i += 8) {
+            const __m256i u = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_slli_epi32(u, 16));
+        }
+#endif
+        for (; i < count; ++i)
+            out[i] = in[i];
+    }
+
+    inline void convert(const float *in, bfloat16 *out, size_t count) {
+        size_t i = 0;
+
+#ifdef LMEL_AVX2
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i bias = _mm256_set1_epi32(0x7fff);
+        const __m256i quiet = _mm256_set1_epi32(0x40);
+
+        for (; i + 8 <= count; i += 8) {
+            const __m256 f = _mm256_loadu_ps(in + i);
+            const __m256i u = _mm256_castps_si256(f);
+
+            const __m256i odd = _mm256_and_si256(_mm256_srli_epi32(u, 16), one);
+            const __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(u, _mm256_add_epi32(bias, odd)), 16);
+
+            // NaNs are truncated and quieted instead of rounded, as in float_to_bfloat16_bits,
+            // the rounding carry could turn them into infinity or zero
+            const __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(f, f, _CMP_UNORD_Q));
+            const __m256i quieted = _mm256_or_si256(_mm256_srli_epi32(u, 16), quiet);
+            const __m256i r = _mm256_blendv_epi8(rounded, quieted, nan);
+
+            // Pack works within 128-bit lanes, the permute puts the 16-bit results in order
+            const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(r, r), 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm256_castsi256_si128(packed));
+        }
+#endif
+        for (; i < count; ++i)
+            out[i] = in[i];
+    }
+
+    // Same-type copies, so generic code can convert without checking the type
+    template<typename T>
+    void convert(const T *in, T *out, size_t count) {
+        std::memcpy(out, in, count * sizeof(T));
+    }
+
+    static_assert(std::is_trivially_copyable<half>::value && std::is_trivially_copyable<bfloat16>::value &&
+                  sizeof(half) == 2 && sizeof(bfloat16) == 2, "16-bit scalars must be trivially copyable");
+}
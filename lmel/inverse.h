@@ -0,0 +1,245 @@
+#pragma once
+
+#include <type_traits>
+#include <cassert>
+#include "simd.h"
+#include "square_matrix.h"
+#include "counters.h"
+#include "half.h"
+
+namespace lmel {
+    namespace detail {
+        // 1 / det, or 0 when det is zero or its reciprocal is not finite
+        template<typename R>
+        constexpr R reciprocal(R det) {
+            if (det == 0)
+                return 0;
+
+            const R r = 1 / det;
+
+            return r - r == 0 ? r : 0;
+        }
+
+        // Inverse of any N x N matrix or view m into a, computed in R. Closed-form adjugate
+        // up to 4x4, Gauss-Jordan elimination with partial pivoting for larger matrices.
+        // Returns false for singular matrices
+        template<typename R, size_t N, typename M>
+        constexpr bool inverse(const M &m, R (&a)[N][N]) {
+            if constexpr (N == 1) {
+                const R r = reciprocal<R>(m(0, 0));
+                a[0][0] = r;
+                return r != 0;
+            } else if constexpr (N == 2) {
+                const R r = reciprocal<R>(R(m(0, 0)) * m(1, 1) - R(m(0, 1)) * m(1, 0));
+
+                a[0][0] = m(1, 1) * r;
+                a[0][1] = -m(0, 1) * r;
+                a[1][0] = -m(1, 0) * r;
+                a[1][1] = m(0, 0) * r;
+
+                return r != 0;
+            } else if constexpr (N == 3) {
+                const R m00 = m(0, 0), m01 = m(0, 1), m02 = m(0, 2);
+                const R m10 = m(1, 0), m11 = m(1, 1), m12 = m(1, 2);
+                const R m20 = m(2, 0), m21 = m(2, 1), m22 = m(2, 2);
+
+                // Cofactors of the first column give the determinant
+                const R c00 = m11 * m22 - m12 * m21;
+                const R c10 = m12 * m20 - m10 * m22;
+                const R c20 = m10 * m21 - m11 * m20;
+                const R r = reciprocal<R>(m00 * c00 + m01 * c10 + m02 * c20);
+
+                a[0][0] = c00 * r;
+                a[0][1] = (m02 * m21 - m01 * m22) * r;
+                a[0][2] = (m01 * m12 - m02 * m11) * r;
+                a[1][0] = c10 * r;
+                a[1][1] = (m00 * m22 - m02 * m20) * r;
+                a[1][2] = (m02 * m10 - m00 * m12) * r;
+                a[2][0] = c20 * r;
+                a[2][1] = (m01 * m20 - m00 * m21) * r;
+                a[2][2] = (m00 * m11 - m01 * m10) * r;
+
+                return r != 0;
+            } else if constexpr (N == 4) {
+                R e[4][4] {};
+
+                for (size_t i = 0; i < 4; ++i)
+                    for (size_t j = 0; j < 4; ++j)
+                        e[i][j] = m(i, j);
+
+                // 2x2 determinants of the upper (s) and lower (c) two rows
+                const R s0 = e[0][0] * e[1][1] - e[1][0] * e[0][1];
+                const R s1 = e[0][0] * e[1][2] - e[1][0] * e[0][2];
+                const R s2 = e[0][0] * e[1][3] - e[1][0] * e[0][3];
+                const R s3 = e[0][1] * e[1][2] - e[1][1] * e[0][2];
+                const R s4 = e[0][1] * e[1][3] - e[1][1] * e[0][3];
+                const R s5 = e[0][2] * e[1][3] - e[1][2] * e[0][3];
+
+                const R c5 = e[2][2] * e[3][3] - e[3][2] * e[2][3];
+                const R c4 = e[2][1] * e[3][3] - e[3][1] * e[2][3];
+                const R c3 = e[2][1] * e[3][2] - e[3][1] * e[2][2];
+                const R c2 = e[2][0] * e[3][3] - e[3][0] * e[2][3];
+                const R c1 = e[2][0] * e[3][2] - e[3][0] * e[2][2];
+                const R c0 = e[2][0] * e[3][1] - e[3][0] * e[2][1];
+
+                const R r = reciprocal<R>(s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+                a[0][0] = (e[1][1] * c5 - e[1][2] * c4 + e[1][3] * c3) * r;
+                a[0][1] = (-e[0][1] * c5 + e[0][2] * c4 - e[0][3] * c3) * r;
+                a[0][2] = (e[3][1] * s5 - e[3][2] * s4 + e[3][3] * s3) * r;
+                a[0][3] = (-e[2][1] * s5 + e[2][2] * s4 - e[2][3] * s3) * r;
+
+                a[1][0] = (-e[1][0] * c5 + e[1][2] * c2 - e[1][3] * c1) * r;
+                a[1][1] = (e[0][0] * c5 - e[0][2] * c2 + e[0][3] * c1) * r;
+                a[1][2] = (-e[3][0] * s5 + e[3][2] * s2 - e[3][3] * s1) * r;
+                a[1][3] = (e[2][0] * s5 - e[2][2] * s2 + e[2][3] * s1) * r;
+
+                a[2][0] = (e[1][0] * c4 - e[1][1] * c2 + e[1][3] * c0) * r;
+                a[2][1] = (-e[0][0] * c4 + e[0][1] * c2 - e[0][3] * c0) * r;
+                a[2][2] = (e[3][0] * s4 - e[3][1] * s2 + e[3][3] * s0) * r;
+                a[2][3] = (-e[2][0] * s4 + e[2][1] * s2 - e[2][3] * s0) * r;
+
+                a[3][0] = (-e[1][0] * c3 + e[1][1] * c1 - e[1][2] * c0) * r;
+                a[3][1] = (e[0][0] * c3 - e[0][1] * c1 + e[0][2] * c0) * r;
+                a[3][2] = (-e[3][0] * s3 + e[3][1] * s1 - e[3][2] * s0) * r;
+                a[3][3] = (e[2][0] * s3 - e[2][1] * s1 + e[2][2] * s0) * r;
+
+                return r != 0;
+            } else {
+                R e[N][N] {};
+
+                for (size_t i = 0; i < N; ++i)
+                    for (size_t j = 0; j < N; ++j) {
+                        e[i][j] = m(i, j);
+                        a[i][j] = i == j ? 1 : 0;
+                    }
+
+                for (size_t k = 0; k < N; ++k) {
+                    // Pivot: row with the largest absolute value in column k
+                    size_t p = k;
+                    R max = e[k][k] < 0 ? -e[k][k] : e[k][k];
+
+                    for (size_t i = k + 1; i < N; ++i) {
+                        R v = e[i][k] < 0 ? -e[i][k] : e[i][k];
+
+                        if (v > max) {
+                            max = v;
+                            p = i;
+                        }
+                    }
+
+                    const R r = reciprocal<R>(e[p][k]);
+
+                    if (r == 0)
+                        return false;
+
+                    if (p != k)
+                        for (size_t j = 0; j < N; ++j) {
+                            R tmp = e[k][j];
+                            e[k][j] = e[p][j];
+                            e[p][j] = tmp;
+
+                            tmp = a[k][j];
+                            a[k][j] = a[p][j];
+                            a[p][j] = tmp;
+                        }
+
+                    for (size_t j = 0; j < N; ++j) {
+                        e[k][j] *= r;
+                        a[k][j] *= r;
+                    }
+
+                    for (size_t i = 0; i < N; ++i) {
+                        const R f = e[i][k];
+
+                        if (i == k || f == 0)
+                            continue;
+
+                        for (size_t j = 0; j < N; ++j) {
+                            e[i][j] -= f * e[k][j];
+                            a[i][j] -= f * a[k][j];
+                        }
+                    }
+                }
+
+                return true;
+            }
+        }
+    }
+
+    // Inverse of m into out. Returns false and leaves out unchanged when m is singular.
+    // Computed in float for 16-bit scalars; 4x4 float matrices use the SSE kernel
+    template<typename T, size_t N, typename S, typename L>
+    constexpr bool try_inverse(const square_matrix<T, N, S, L> &m, square_matrix<T, N, S, L> &out) {
+        typedef accumulate_t<T> real;
+        typedef square_matrix<T, N, S, L> matrix_type;
+
+        static_assert(std::is_floating_point<real>::value, "inverse needs a floating point type");
+
+        LMEL_COUNT(inverse, N == 1 ? 1 : N == 2 ? 8 : N == 3 ? 42 : N == 4 ? 144 : 2 * N * N * N,
+                   2 * N * N * sizeof(T), 0);
+
+        if constexpr (N == 4 && matrix_type::stride == 4 && simd::inverse_kernel<T>::enabled)
+            if (!LMEL_CONSTANT_EVALUATED())
+                return simd::inverse_kernel<T>::inverse(&m(0, 0), &out(0, 0));
+
+        real a[N][N] {};
+
+        if (!detail::inverse<real, N>(m, a))
+            return false;
+
+        for (size_t i = 0; i < N; ++i)
+            for (size_t j = 0; j < N; ++j)
+                out(i, j) = a[i][j];
+
+        return true;
+    }
+
+    // Inverse of a non-singular matrix; asserts on singular matrices, which give zero
+    // in release builds
+    template<typename T, size_t N, typename S, typename L>
+    constexpr square_matrix<T, N, S, L> inverse(const square_matrix<T, N, S, L> &m) {
+        LMEL_COUNT_TEMPORARY(inverse, N * N * sizeof(T));
+
+        square_matrix<T, N, S, L> result(0);
+
+        if (!try_inverse(m, result))
+            assert(!"Singular matrix!");
+
+        return result;
+    }
+
+    // Inverse of an orthonormal matrix (a rotation or reflection) is its transpose.
+    // m is not checked
+    template<typename T, size_t N, typename S, typename L>
+    constexpr square_matrix<T, N, S, L> orthonormal_inverse(const square_matrix<T, N, S, L> &m) {
+        return m.get_transpose();
+    }
+
+    // Inverse of a rigid transform: an orthonormal rotation R in the upper left
+    // (N - 1) x (N - 1) block, a translation t in the last column and a last row of
+    // (0, ..., 0, 1). The inverse holds transpose(R) and -transpose(R) t; m is not checked
+    template<typename T, size_t N, typename S, typename L>
+    constexpr square_matrix<T, N, S, L> rigid_inverse(const square_matrix<T, N, S, L> &m) {
+        static_assert(N > 1, "a rigid transform needs at least 2x2 elements");
+
+        LMEL_COUNT(inverse, 2 * (N - 1) * (N - 1), 2 * N * N * sizeof(T), 1);
+
+        square_matrix<T, N, S, L> result(0);
+
+        for (size_t i = 0; i + 1 < N; ++i) {
+            accumulate_t<T> t = 0;
+
+            for (size_t j = 0; j + 1 < N; ++j) {
+                result(i, j) = m(j, i);
+                t -= m(j, i) * m(j, N - 1);
+            }
+
+            result(i, N - 1) = t;
+        }
+
+        result(N - 1, N - 1) = 1;
+
+        return result;
+    }
+}
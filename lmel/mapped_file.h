@@ -0,0 +1,502 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+#include <type_traits>
+#include <fstream>
+#include <vector>
+#include "aligned.h"
+#include "vector.h"
+#include "vector_batch.h"
+#include "serialize.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LMEL_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lmel {
+    // On-disk container for large arrays, read in place through a memory mapping.
+    // A 64-byte header describes the element (scalar, rows N, columns M, lanes per line,
+    // layout) and the count. The data starts at a multiple of 64 bytes, either as an array
+    // of elements or, for vectors, as N component arrays (structure of arrays) that are 64-byte
+    // aligned each. Files are in the byte order of the writer; other byte orders are rejected,
+    // since mapped data can not be swapped (use serialize() to exchange data between machines)
+    static const uint16_t mapped_version = 1;
+
+    // Arrangement of the data
+    enum class mapped_arrangement : uint8_t {
+        elements, components
+    };
+
+    struct mapped_header {
+        char magic[4];              // "LMEA"
+        uint32_t byte_order;        // serial_byte_order in the byte order of the writer
+        uint16_t version;           // mapped_version of the writer
+        uint8_t scalar;             // serial_scalar
+        uint8_t scalar_size;        // bytes per scalar
+        uint8_t arrangement;        // mapped_arrangement
+        uint8_t col_major;          // 1 for col_major matrices
+        uint16_t reserved0;
+        uint32_t rows;              // N
+        uint32_t cols;              // M, 1 for vectors and scalars
+        uint32_t stride;            // stored lanes per line, more than the line size with padded storage
+        uint32_t element_size;      // bytes per element (per vector for components)
+        uint64_t count;             // number of elements
+        uint64_t data_offset;       // start of the data from the start of the file
+        uint64_t component_stride;  // bytes between component arrays, 0 for elements
+        uint64_t reserved1;
+    };
+
+    static_assert(sizeof(mapped_header) == 64 && std::is_trivially_copyable<mapped_header>::value,
+                  "mapped_header must be 64 bytes without padding");
+
+    namespace detail {
+        // Rows, columns and stored lanes per line of an element. Vectors are detected by
+        // storage_size, matrices by row_step; other types count as a column of scalars
+        template<typename T, typename = void, typename = void>
+        struct mapped_shape {
+            static const size_t rows = sizeof(T) / sizeof(typename serial_scalar_of<T>::type);
+            static const size_t cols = 1;
+            static const size_t stride = rows;
+            static const bool col_major = false;
+        };
+
+        template<typename T>
+        struct mapped_shape<T, std::void_t<decltype(T::storage_size)>, void> {
+            static const size_t rows = T::size;
+            static const size_t cols = 1;
+            static const size_t stride = T::storage_size;
+            static const bool col_major = false;
+        };
+
+        template<typename T>
+        struct mapped_shape<T, void, std::void_t<decltype(T::row_step)>> {
+            static const size_t rows = T::rows;
+            static const size_t cols = T::cols;
+            static const size_t stride = T::stride;
+            static const bool col_major = T::is_col_major;
+        };
+
+        constexpr uint64_t mapped_align(uint64_t bytes) {
+            return (bytes + default_alignment - 1) / default_alignment * default_alignment;
+        }
+
+        template<typename T>
+        mapped_header make_mapped_header(size_t count) {
+            typedef serial_element<T> element;
+            typedef mapped_shape<T> shape;
+
+            static_assert(alignof(T) <= default_alignment, "mapped elements can be aligned to at most 64 bytes");
+
+            mapped_header h {};
+            memcpy(h.magic, "LMEA", 4);
+            h.byte_order = serial_byte_order;
+            h.version = mapped_version;
+            h.scalar = uint8_t(element::kind);
+            h.scalar_size = uint8_t(sizeof(typename element::scalar));
+            h.arrangement = uint8_t(mapped_arrangement::elements);
+            h.col_major = shape::col_major;
+            h.rows = uint32_t(shape::rows);
+            h.cols = uint32_t(shape::cols);
+            h.stride = uint32_t(shape::stride);
+            h.element_size = uint32_t(sizeof(T));
+            h.count = count;
+            h.data_offset = mapped_align(sizeof(mapped_header));
+
+            return h;
+        }
+    }
+
+    // Read-only array of elements in a mapped file, valid while the file is open
+    template<typename T>
+    class mapped_span {
+    private:
+        const T *ptr = nullptr;
+        size_t count = 0;
+
+    public:
+        typedef T value_type;
+
+        constexpr mapped_span() = default;
+
+        constexpr mapped_span(const T *ptr, size_t count)
+                : ptr(ptr), count(count) {}
+
+        constexpr const T *data() const {
+            return ptr;
+        }
+
+        constexpr size_t size() const {
+            return count;
+        }
+
+        constexpr bool empty() const {
+            return count == 0;
+        }
+
+        constexpr const T *begin() const {
+            return ptr;
+        }
+
+        constexpr const T *end() const {
+            return ptr + count;
+        }
+
+        constexpr const T &operator[](size_t i) const {
+            return ptr[i];
+        }
+    };
+
+    // Read-only component arrays of N-dimensional vectors in a mapped file, laid out like
+    // vector_batch. Valid while the file is open
+    template<typename T, size_t N>
+    class mapped_batch {
+    private:
+        const T *data[N] {};
+        size_t count = 0;
+
+    public:
+        static const size_t dimension = N;
+
+        constexpr mapped_batch() = default;
+
+        mapped_batch(const T *const components[N], size_t count)
+                : count(count) {
+            for (size_t c = 0; c < N; ++c)
+                data[c] = components[c];
+        }
+
+        constexpr size_t size() const {
+            return count;
+        }
+
+        constexpr bool empty() const {
+            return count == 0;
+        }
+
+        constexpr const T *component(size_t c) const {
+            return data[c];
+        }
+
+        vector<T, N> get(size_t i) const {
+            vector<T, N> result;
+
+            for (size_t c = 0; c < N; ++c)
+                result(c) = data[c][i];
+
+            return result;
+        }
+
+        // Copy into a batch, e.g. to modify the vectors
+        vector_batch<T, N> to_batch() const {
+            vector_batch<T, N> result(count);
+
+            for (size_t c = 0; c < N; ++c)
+                if (count)
+                    memcpy(result.component(c), data[c], count * sizeof(T));
+
+            return result;
+        }
+    };
+
+    // Reader: maps a file written by mapped_writer or write_mapped() and exposes its
+    // contents without copies. Without mmap support the file is read into memory instead
+    class mapped_file {
+    private:
+        const char *base = nullptr;
+        size_t length = 0;
+        bool mapped = false;
+        aligned_vector<char> buffer;
+        mapped_header h {};
+
+        // Checks the header and that the data fits into the file
+        bool validate() {
+            if (length < sizeof(mapped_header))
+                return false;
+
+            memcpy(&h, base, sizeof(mapped_header));
+
+            if (memcmp(h.magic, "LMEA", 4) != 0 || h.byte_order != serial_byte_order || h.version == 0 ||
+                h.version > mapped_version || h.data_offset % default_alignment != 0 || h.data_offset > length ||
+                h.scalar_size == 0 || h.element_size == 0 || h.rows == 0)
+                return false;
+
+            const uint64_t available = length - h.data_offset;
+
+            if (h.arrangement == uint8_t(mapped_arrangement::elements))
+                return h.component_stride == 0 && h.count <= available / h.element_size;
+
+            if (h.arrangement != uint8_t(mapped_arrangement::components) || h.cols != 1 ||
+                h.count > available / h.scalar_size || h.component_stride < h.count * h.scalar_size ||
+                h.component_stride % default_alignment != 0)
+                return false;
+
+            // The header is untrusted, the offset of the last component must not wrap around
+            if (h.rows > 1 && h.component_stride > available / (h.rows - 1))
+                return false;
+
+            return h.count * h.scalar_size <= available - h.component_stride * (h.rows - 1);
+        }
+
+    public:
+        mapped_file() = default;
+
+        explicit mapped_file(const char *path) {
+            open(path);
+        }
+
+        mapped_file(const mapped_file &) = delete;
+        mapped_file &operator=(const mapped_file &) = delete;
+
+        mapped_file(mapped_file &&ref) noexcept
+                : base(ref.base), length(ref.length), mapped(ref.mapped), buffer(std::move(ref.buffer)), h(ref.h) {
+            ref.base = nullptr;
+            ref.length = 0;
+            ref.mapped = false;
+        }
+
+        mapped_file &operator=(mapped_file &&val) noexcept {
+            if (&val == this)
+                return *this;
+
+            close();
+
+            base = val.base;
+            length = val.length;
+            mapped = val.mapped;
+            buffer = std::move(val.buffer);
+            h = val.h;
+
+            val.base = nullptr;
+            val.length = 0;
+            val.mapped = false;
+
+            return *this;
+        }
+
+        ~mapped_file() {
+            close();
+        }
+
+        // Returns false for missing files, other formats, newer versions, the other
+        // byte order and files shorter than their header says
+        bool open(const char *path) {
+            close();
+
+#ifdef LMEL_MMAP
+            const int fd = ::open(path, O_RDONLY);
+
+            if (fd < 0)
+                return false;
+
+            struct stat st;
+
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void *p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if (p != MAP_FAILED) {
+                    base = static_cast<const char *>(p);
+                    length = size_t(st.st_size);
+                    mapped = true;
+                }
+            }
+
+            ::close(fd);
+#else
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+
+            if (in) {
+                buffer.resize(size_t(in.tellg()));
+                in.seekg(0);
+
+                if (in.read(buffer.data(), std::streamsize(buffer.size()))) {
+                    base = buffer.data();
+                    length = buffer.size();
+                }
+            }
+#endif
+            if (!validate()) {
+                close();
+                return false;
+            }
+
+            return true;
+        }
+
+        void close() {
+#ifdef LMEL_MMAP
+            if (mapped)
+                munmap(const_cast<char *>(base), length);
+#endif
+            base = nullptr;
+            length = 0;
+            mapped = false;
+            buffer = aligned_vector<char>();
+            h = mapped_header {};
+        }
+
+        bool is_open() const {
+            return base != nullptr;
+        }
+
+        const mapped_header &header() const {
+            return h;
+        }
+
+        size_t size() const {
+            return size_t(h.count);
+        }
+
+        // True when the file holds an array of T: same scalar, shape, layout and size
+        template<typename T>
+        bool holds() const {
+            typedef detail::serial_element<T> element;
+            typedef detail::mapped_shape<T> shape;
+
+            return is_open() && h.arrangement == uint8_t(mapped_arrangement::elements) &&
+                   h.scalar == uint8_t(element::kind) && h.scalar_size == sizeof(typename element::scalar) &&
+                   h.rows == shape::rows && h.cols == shape::cols && h.stride == shape::stride &&
+                   h.col_major == shape::col_major && h.element_size == sizeof(T) &&
+                   alignof(T) <= default_alignment;
+        }
+
+        // True when the file holds component arrays of N-dimensional vectors of T
+        template<typename T, size_t N>
+        bool holds_components() const {
+            return is_open() && h.arrangement == uint8_t(mapped_arrangement::components) &&
+                   h.scalar == uint8_t(detail::serial_scalar_kind<T>()) && h.scalar_size == sizeof(T) &&
+                   h.rows == N && h.cols == 1;
+        }
+
+        // The elements in place, holds<T>() must be true
+        template<typename T>
+        mapped_span<T> elements() const {
+            assert(holds<T>());
+
+            return mapped_span<T>(reinterpret_cast<const T *>(base + h.data_offset), size());
+        }
+
+        // The component arrays in place, holds_components<T, N>() must be true
+        template<typename T, size_t N>
+        mapped_batch<T, N> components() const {
+            assert((holds_components<T, N>()));
+
+            const T *data[N];
+
+            for (size_t c = 0; c < N; ++c)
+                data[c] = reinterpret_cast<const T *>(base + h.data_offset + c * h.component_stride);
+
+            return mapped_batch<T, N>(data, size());
+        }
+    };
+
+    // Streaming writer: appends elements to the end of the file, the header gets the final
+    // count on close(). Until then the file reads as empty
+    template<typename T>
+    class mapped_writer {
+    private:
+        std::ofstream out;
+        size_t count = 0;
+
+    public:
+        mapped_writer() = default;
+
+        explicit mapped_writer(const char *path) {
+            open(path);
+        }
+
+        ~mapped_writer() {
+            close();
+        }
+
+        // Truncates the file and writes the header
+        bool open(const char *path) {
+            close();
+
+            out.open(path, std::ios::binary | std::ios::trunc);
+            count = 0;
+
+            const mapped_header h = detail::make_mapped_header<T>(0);
+            char head[detail::mapped_align(sizeof(mapped_header))] {};
+            memcpy(head, &h, sizeof(h));
+
+            out.write(head, sizeof(head));
+
+            return bool(out);
+        }
+
+        bool is_open() const {
+            return out.is_open();
+        }
+
+        size_t size() const {
+            return count;
+        }
+
+        bool append(const T *data, size_t n) {
+            out.write(reinterpret_cast<const char *>(data), std::streamsize(n * sizeof(T)));
+
+            if (!out)
+                return false;
+
+            count += n;
+
+            return true;
+        }
+
+        bool append(const std::vector<T> &data) {
+            return append(data.data(), data.size());
+        }
+
+        bool append(const T &val) {
+            return append(&val, 1);
+        }
+
+        // Writes the count into the header and closes the file
+        bool close() {
+            if (!out.is_open())
+                return true;
+
+            const mapped_header h = detail::make_mapped_header<T>(count);
+
+            out.seekp(0);
+            out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+            out.close();
+
+            return !out.fail();
+        }
+    };
+
+    // Write a batch as component arrays, which read back as a mapped_batch
+    template<typename T, size_t N>
+    bool write_mapped(const char *path, const vector_batch<T, N> &batch) {
+        mapped_header h = detail::make_mapped_header<vector<T, N>>(batch.size());
+        h.arrangement = uint8_t(mapped_arrangement::components);
+        h.stride = uint32_t(N);
+        h.element_size = uint32_t(N * sizeof(T));
+        h.component_stride = detail::mapped_align(batch.size() * sizeof(T));
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        std::vector<char> padding(size_t(h.component_stride - batch.size() * sizeof(T)));
+        char head[detail::mapped_align(sizeof(mapped_header))] {};
+        memcpy(head, &h, sizeof(h));
+
+        out.write(head, sizeof(head));
+
+        for (size_t c = 0; c < N; ++c) {
+            out.write(reinterpret_cast<const char *>(batch.component(c)), std::streamsize(batch.size() * sizeof(T)));
+
+            // The last array needs no padding
+            if (c + 1 < N)
+                out.write(padding.data(), std::streamsize(padding.size()));
+        }
+
+        return bool(out);
+    }
+}
@@ -1,297 +1,417 @@
 #pragma once
 
 #include <initializer_list>
+#include <type_traits>
+#include <cstddef>
 #include <cassert>
 #include "vector.h"
+#include "storage.h"
+#include "gemm.h"
+#include "view.h"
+#include "counters.h"
+#include "half.h"
 
 namespace lmel {
     template<
             typename T,
             size_t N,
             size_t M,
-            typename = typename std::enable_if<std::is_arithmetic<T>::value && N != 0 && M != 0, T>::type
+            typename Storage = packed_storage,
+            typename Layout = row_major,
+            typename = typename std::enable_if<is_element<T>::value && N != 0 && M != 0, T>::type
     >
     class matrix {
-    protected:
-        T data[N][M];
-
     public:
+        typedef T value_type;
+
         static const size_t rows = N;
         static const size_t cols = M;
 
+        // Type of R x C parts of the matrix, see block()
+        template<size_t R, size_t C>
+        using block_type = matrix<T, R, C, Storage, Layout>;
+
+        static const bool is_col_major = std::is_same<Layout, col_major>::value;
+
+        // Contiguous lines: rows for row_major, columns for col_major
+        static const size_t lines = is_col_major ? M : N;
+        static const size_t line_size = is_col_major ? N : M;
+
+        // Distance between lines in elements, more than line_size when the storage policy pads
+        static const size_t stride = Storage::padded_size(line_size);
+
+        // Distance between elements (i, j) and (i + 1, j), and between (i, j) and (i, j + 1)
+        static constexpr ptrdiff_t row_step = is_col_major ? 1 : stride;
+        static constexpr ptrdiff_t col_step = is_col_major ? stride : 1;
+
+    protected:
+        alignas(T) alignas(Storage::alignment) T data[lines][stride] {};
+
+        constexpr T &at(size_t row, size_t col) {
+            return is_col_major ? data[col][row] : data[row][col];
+        }
+
+        constexpr const T &at(size_t row, size_t col) const {
+            return is_col_major ? data[col][row] : data[row][col];
+        }
+
+    public:
         // Constructor with init value
-        explicit matrix(T init = 0) {
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+        constexpr explicit matrix(T init = 0) {
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     data[i][j] = init;
         }
 
-        // Initializer list constructor
-        matrix(std::initializer_list<T> il) {
+        // Initializer list constructor, elements are listed row by row for every layout
+        constexpr matrix(std::initializer_list<T> il) {
             assert(il.size() == N * M);
 
             auto it = il.begin();
 
             for (size_t i = 0; i < rows; ++i)
                 for (size_t j = 0; j < cols; ++j)
-                    data[i][j] = *it++;
+                    at(i, j) = *it++;
         }
 
-        // Copy constructor
-        matrix(const matrix &ref) {
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
-                    data[i][j] = ref.data[i][j];
-        }
+        // Copy constructor, trivial: matrices can be copied with memcpy
+        constexpr matrix(const matrix &ref) = default;
 
-        // Template copy constructor
-        template<typename O>
-        matrix(const matrix<O, N, M> &ref) {
-            for (size_t i = 0; i < rows; ++i)
+        // Template copy constructor (for other types, storage policies and layouts).
+        // Each loop order reads or writes along contiguous lines
+        template<typename O, typename S, typename L>
+        constexpr matrix(const matrix<O, N, M, S, L> &ref) {
+            if constexpr (is_col_major) {
                 for (size_t j = 0; j < cols; ++j)
-                    data[i][j] = ref(i, j);
+                    for (size_t i = 0; i < rows; ++i)
+                        data[j][i] = ref(i, j);
+            } else {
+                for (size_t i = 0; i < rows; ++i)
+                    for (size_t j = 0; j < cols; ++j)
+                        data[i][j] = ref(i, j);
+            }
         }
 
-        // Assignment operator
-        matrix &operator=(const matrix &val) {
-            if (&val == this)
-                return *this;
+        // Assignment operator, trivial
+        constexpr matrix &operator=(const matrix &val) = default;
 
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
-                    data[i][j] = val.data[i][j];
+        // Views into the matrix (see view.h), valid while the matrix lives:
 
-            return *this;
+        constexpr row_view<matrix> row(size_t i) {
+            return row_view<matrix>(*this, i);
         }
 
-        vector<T, M> get_row(const size_t row) const {
-            assert(row < rows);
-
-            vector<T, M> result(0);
-
-            for (size_t i = 0; i < cols; ++i)
-                result(i) = data[row][i];
-
-            return result;
+        constexpr row_view<const matrix> row(size_t i) const {
+            return row_view<const matrix>(*this, i);
         }
 
-        vector<T, N> get_col(const size_t col) const {
-            assert(col < cols);
+        constexpr col_view<matrix> col(size_t j) {
+            return col_view<matrix>(*this, j);
+        }
 
-            vector<T, N> result(0);
+        constexpr col_view<const matrix> col(size_t j) const {
+            return col_view<const matrix>(*this, j);
+        }
 
-            for (size_t i = 0; i < rows; ++i)
-                result(i) = data[i][col];
+        // R x C block with top left element (i, j)
+        template<size_t R, size_t C>
+        constexpr block_view<R, C, matrix> block(size_t i, size_t j) {
+            return block_view<R, C, matrix>(*this, i, j);
+        }
 
-            return result;
+        template<size_t R, size_t C>
+        constexpr block_view<R, C, const matrix> block(size_t i, size_t j) const {
+            return block_view<R, C, const matrix>(*this, i, j);
         }
 
-        void set_row(size_t row_num, const vector<T, M> &row) {
-            assert(row_num < rows);
+        constexpr vector<T, M> get_row(const size_t row_num) const {
+            return row(row_num);
+        }
 
-            for (size_t j = 0; j < cols; ++j)
-                data[row_num][j] = row(j);
+        constexpr vector<T, N> get_col(const size_t col_num) const {
+            return col(col_num);
         }
 
-        void set_col(size_t col_num, const vector<T, N> &col) {
-            assert(col_num < cols);
+        constexpr void set_row(size_t row_num, const vector<T, M> &val) {
+            row(row_num) = val;
+        }
 
-            for (size_t i = 0; i < rows; ++i)
-                data[i][col_num] = col(i);
+        constexpr void set_col(size_t col_num, const vector<T, N> &val) {
+            col(col_num) = val;
         }
 
-        void swap_rows(size_t a, size_t b) {
-            vector<T, M> tmp = get_row(a);
-            set_row(a, get_row(b));
-            set_row(b, tmp);
+        // Swaps exchange elements in place
+        constexpr void swap_rows(size_t a, size_t b) {
+            row(a).swap(row(b));
         }
 
-        void swap_cols(size_t a, size_t b) {
-            vector<T, N> tmp = get_col(a);
-            set_col(a, get_col(b));
-            set_col(b, tmp);
+        constexpr void swap_cols(size_t a, size_t b) {
+            col(a).swap(col(b));
         }
 
         // Default math operations:
 
-        matrix operator+(const matrix &val) const {
+        constexpr matrix operator+(const matrix &val) const {
+            LMEL_COUNT(matrix, N * M, 3 * N * M * sizeof(T), 1);
+
             matrix result(0);
 
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     result.data[i][j] = data[i][j] + val.data[i][j];
 
             return result;
         }
 
-        matrix operator-(const matrix &val) const {
+        constexpr matrix operator-(const matrix &val) const {
+            LMEL_COUNT(matrix, N * M, 3 * N * M * sizeof(T), 1);
+
             matrix result(0);
 
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     result.data[i][j] = data[i][j] - val.data[i][j];
 
             return result;
         }
 
         template<size_t K>
-        matrix<T, N, K> operator*(const matrix<T, M, K> &val) const {
-            matrix<T, N, K> result(0);
-
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
-                    for (size_t k = 0; k < K; ++k)
-                        result(i, k) += data[i][j] * val(j, k);
+        constexpr matrix<T, N, K, Storage, Layout> operator*(const matrix<T, M, K, Storage, Layout> &val) const {
+            typedef matrix<T, M, K, Storage, Layout> operand_type;
+            typedef matrix<T, N, K, Storage, Layout> result_type;
+
+            result_type result(0);
+
+            if constexpr (N * M * K >= gemm_threshold && std::is_arithmetic<T>::value)
+                if (!LMEL_CONSTANT_EVALUATED()) {
+                    gemm(N, M, K,
+                         &data[0][0], row_step, col_step,
+                         &val(0, 0), operand_type::row_step, operand_type::col_step,
+                         &result(0, 0), result_type::row_step, result_type::col_step);
+                    return result;
+                }
+
+            LMEL_COUNT(matrix_product, 2 * N * M * K, (N * M + M * K + N * K) * sizeof(T), 1);
+
+            // Innermost loop walks along contiguous lines: the columns of the result
+            // for row_major, its rows for col_major. 16-bit scalars instead sum each
+            // element in float and round it once
+            if constexpr (is_storage_scalar<T>::value) {
+                for (size_t i = 0; i < rows; ++i)
+                    for (size_t k = 0; k < K; ++k) {
+                        float sum = 0;
+
+                        for (size_t j = 0; j < cols; ++j)
+                            sum += at(i, j) * val(j, k);
+
+                        result(i, k) = sum;
+                    }
+            } else if constexpr (is_col_major) {
+                for (size_t k = 0; k < K; ++k)
+                    for (size_t j = 0; j < cols; ++j)
+                        for (size_t i = 0; i < rows; ++i)
+                            result(i, k) += at(i, j) * val(j, k);
+            } else {
+                for (size_t i = 0; i < rows; ++i)
+                    for (size_t j = 0; j < cols; ++j)
+                        for (size_t k = 0; k < K; ++k)
+                            result(i, k) += at(i, j) * val(j, k);
+            }
 
             return result;
         }
 
-        matrix &operator+=(const matrix &val) {
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+        constexpr matrix &operator+=(const matrix &val) {
+            LMEL_COUNT(matrix, N * M, 3 * N * M * sizeof(T), 0);
+
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     data[i][j] += val.data[i][j];
 
             return *this;
         }
 
-        matrix &operator-=(const matrix &val) {
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+        constexpr matrix &operator-=(const matrix &val) {
+            LMEL_COUNT(matrix, N * M, 3 * N * M * sizeof(T), 0);
+
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     data[i][j] -= val.data[i][j];
 
             return *this;
         }
 
-        matrix operator+(T val) const {
+        constexpr matrix operator+(T val) const {
+            LMEL_COUNT(matrix, N * M, 2 * N * M * sizeof(T), 1);
+
             matrix result(0);
 
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     result.data[i][j] = data[i][j] + val;
 
             return result;
         }
 
-        matrix operator-(T val) const {
+        constexpr matrix operator-(T val) const {
+            LMEL_COUNT(matrix, N * M, 2 * N * M * sizeof(T), 1);
+
             matrix result(0);
 
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     result.data[i][j] = data[i][j] - val;
 
             return result;
         }
 
-        matrix operator*(T val) const {
+        constexpr matrix operator*(T val) const {
+            LMEL_COUNT(matrix, N * M, 2 * N * M * sizeof(T), 1);
+
             matrix result(0);
 
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     result.data[i][j] = data[i][j] * val;
 
             return result;
         }
 
-        matrix operator/(T val) const {
+        constexpr matrix operator/(T val) const {
+            LMEL_COUNT(matrix, N * M, 2 * N * M * sizeof(T), 1);
+
             matrix result(0);
 
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     result.data[i][j] = data[i][j] / val;
 
             return result;
         }
 
-        matrix &operator+=(T val) {
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+        constexpr matrix &operator+=(T val) {
+            LMEL_COUNT(matrix, N * M, 2 * N * M * sizeof(T), 0);
+
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     data[i][j] += val;
 
             return *this;
         }
 
-        matrix &operator-=(T val) {
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+        constexpr matrix &operator-=(T val) {
+            LMEL_COUNT(matrix, N * M, 2 * N * M * sizeof(T), 0);
+
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     data[i][j] -= val;
 
             return *this;
         }
 
-        matrix &operator*=(T val) {
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+        constexpr matrix &operator*=(T val) {
+            LMEL_COUNT(matrix, N * M, 2 * N * M * sizeof(T), 0);
+
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     data[i][j] *= val;
 
             return *this;
         }
 
-        matrix &operator/=(T val) {
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+        constexpr matrix &operator/=(T val) {
+            LMEL_COUNT(matrix, N * M, 2 * N * M * sizeof(T), 0);
+
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     data[i][j] /= val;
 
             return *this;
         }
 
         // Vector product:
-        vector<T, N> operator*(const vector<T, M> &vec) const {
-            vector<T, N> result(0);
+        template<typename S>
+        constexpr vector<T, N, S> operator*(const vector<T, M, S> &vec) const {
+            LMEL_COUNT(matrix_vector, 2 * N * M, (N * M + M + N) * sizeof(T), 1);
 
-            for (size_t i = 0; i < rows; ++i)
+            vector<T, N, S> result(0);
+
+            // Dot product per row for row_major, sum of scaled columns for col_major
+            if constexpr (is_storage_scalar<T>::value) {
+                for (size_t i = 0; i < rows; ++i) {
+                    float sum = 0;
+
+                    for (size_t j = 0; j < cols; ++j)
+                        sum += at(i, j) * vec(j);
+
+                    result(i) = sum;
+                }
+            } else if constexpr (is_col_major) {
                 for (size_t j = 0; j < cols; ++j)
-                    result(i) += data[i][j] * vec(j);
+                    for (size_t i = 0; i < rows; ++i)
+                        result(i) += data[j][i] * vec(j);
+            } else {
+                for (size_t i = 0; i < rows; ++i)
+                    for (size_t j = 0; j < cols; ++j)
+                        result(i) += data[i][j] * vec(j);
+            }
 
             return result;
         }
 
         // Compare operations:
 
-        bool operator==(const matrix &m) const {
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+        constexpr bool operator==(const matrix &m) const {
+            LMEL_COUNT(matrix, 0, 2 * N * M * sizeof(T), 0);
+
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     if (data[i][j] != m.data[i][j])
                         return false;
 
             return true;
         }
 
-        bool operator!=(const matrix &m) const {
-            for (size_t i = 0; i < rows; ++i)
-                for (size_t j = 0; j < cols; ++j)
+        constexpr bool operator!=(const matrix &m) const {
+            LMEL_COUNT(matrix, 0, 2 * N * M * sizeof(T), 0);
+
+            for (size_t i = 0; i < lines; ++i)
+                for (size_t j = 0; j < line_size; ++j)
                     if (data[i][j] != m.data[i][j])
                         return true;
 
             return false;
         }
 
-        matrix<T, M, N> get_transpose() const {
-            matrix<T, M, N> result(0);
+        constexpr matrix<T, M, N, Storage, Layout> get_transpose() const {
+            LMEL_COUNT(transpose, 0, 2 * N * M * sizeof(T), 1);
+
+            matrix<T, M, N, Storage, Layout> result(0);
 
             for (size_t i = 0; i < rows; ++i)
                 for (size_t j = 0; j < cols; ++j)
-                    result(j, i) = data[i][j];
+                    result(j, i) = at(i, j);
 
             return result;
         }
 
         // get/set selected element:
 
-        T &operator()(size_t row, size_t col) {
+        constexpr T &operator()(size_t row, size_t col) {
             assert(row < rows && col < cols);
-            return data[row][col];
+            return at(row, col);
         }
 
-        const T &operator()(size_t row, size_t col) const {
+        constexpr const T &operator()(size_t row, size_t col) const {
             assert(row < rows && col < cols);
-            return data[row][col];
+            return at(row, col);
         }
 
         template<typename I, size_t K, size_t L>
-        friend matrix<I, K, L> make_matrix_from_rows(std::initializer_list<vector<I, L>> il);
+        friend constexpr matrix<I, K, L> make_matrix_from_rows(std::initializer_list<vector<I, L>> il);
 
         template<typename I, size_t K, size_t L>
-        friend matrix<I, K, L> make_matrix_from_cols(std::initializer_list<vector<I, K>> il);
+        friend constexpr matrix<I, K, L> make_matrix_from_cols(std::initializer_list<vector<I, K>> il);
     };
 
     template<size_t N, size_t M>
@@ -307,7 +427,7 @@ namespace lmel {
     using double_matrix = matrix<double, N, M>;
 
     template<typename T, size_t N, size_t M>
-    matrix<T, N, M> make_matrix_from_rows(std::initializer_list<vector<T, M>> il) {
+    constexpr matrix<T, N, M> make_matrix_from_rows(std::initializer_list<vector<T, M>> il) {
         assert(il.size() == N);
 
         auto it = il.begin();
@@ -326,7 +446,7 @@ namespace lmel {
     }
 
     template<typename T, size_t N, size_t M>
-    matrix<T, N, M> make_matrix_from_cols(std::initializer_list<vector<T, N>> il) {
+    constexpr matrix<T, N, M> make_matrix_from_cols(std::initializer_list<vector<T, N>> il) {
         assert(il.size() == M);
 
         auto it = il.begin();
@@ -343,4 +463,9 @@ namespace lmel {
 
         return result;
     }
+
+    static_assert(std::is_trivially_copyable<float_matrix<3, 4>>::value &&
+                  std::is_standard_layout<float_matrix<3, 4>>::value &&
+                  std::is_trivially_copyable<matrix<double, 3, 3, storage<16, true>, col_major>>::value,
+                  "matrix must be trivially copyable");
 }
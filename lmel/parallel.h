@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include "gemm.h"
+#include "matrix.h"
+#include "square_matrix.h"
+#include "dynamic_matrix.h"
+#include "thread_pool.h"
+#include "counters.h"
+
+namespace lmel {
+    // Products with fewer multiply-adds (N * M * K) than this always run on the calling thread
+    static const size_t parallel_threshold = 128 * 128 * 128;
+
+    // gemm() with C split into tiles, every tile is a task on the pool.
+    // Tiles cover disjoint parts of C, so the result equals the serial gemm().
+    // The product is counted once, on the calling thread
+    template<typename T>
+    void parallel_gemm(size_t n, size_t m, size_t k,
+                       const T *a, ptrdiff_t a_rs, ptrdiff_t a_cs,
+                       const T *b, ptrdiff_t b_rs, ptrdiff_t b_cs,
+                       T *c, ptrdiff_t c_rs, ptrdiff_t c_cs,
+                       thread_pool &pool = shared_thread_pool()) {
+        if (n * m * k < parallel_threshold || pool.size() == 0) {
+            gemm(n, m, k, a, a_rs, a_cs, b, b_rs, b_cs, c, c_rs, c_cs);
+            return;
+        }
+
+        LMEL_COUNT(gemm, 2 * n * m * k, (n * m + m * k + 2 * n * k) * sizeof(T), 0);
+
+        // Start from tiles of a few cache blocks and split until every thread gets some
+        size_t tile_rows = 192;
+        size_t tile_cols = 512;
+        const size_t min_tiles = 2 * (pool.size() + 1);
+
+        auto count = [](size_t size, size_t tile) { return (size + tile - 1) / tile; };
+
+        while (count(n, tile_rows) * count(k, tile_cols) < min_tiles && (tile_rows > 48 || tile_cols > 64)) {
+            if (tile_cols > 64 && (tile_cols >= tile_rows || tile_rows <= 48))
+                tile_cols /= 2;
+            else
+                tile_rows /= 2;
+        }
+
+        const size_t row_tiles = count(n, tile_rows);
+        const size_t col_tiles = count(k, tile_cols);
+
+        pool.parallel_for(row_tiles * col_tiles, [&](size_t t) {
+            const size_t i = t / col_tiles * tile_rows;
+            const size_t j = t % col_tiles * tile_cols;
+            const size_t rows = std::min(tile_rows, n - i);
+            const size_t cols = std::min(tile_cols, k - j);
+
+            detail::gemm_blocks(rows, m, cols,
+                                a + i * a_rs, a_rs, a_cs,
+                                b + j * b_cs, b_rs, b_cs,
+                                c + i * c_rs + j * c_cs, c_rs, c_cs);
+        });
+    }
+
+    // Same result as a * b, computed on the pool for large sizes.
+    // A pool of n workers computes on n + 1 threads, together with the calling thread
+    template<typename T>
+    dynamic_matrix<T> multiply(const dynamic_matrix<T> &a, const dynamic_matrix<T> &b,
+                               thread_pool &pool = shared_thread_pool()) {
+        assert(a.cols() == b.rows());
+
+        if (a.rows() * a.cols() * b.cols() < parallel_threshold)
+            return a * b;
+
+        dynamic_matrix<T> result(a.rows(), b.cols());
+
+        parallel_gemm(a.rows(), a.cols(), b.cols(),
+                      &a(0, 0), a.cols(), 1,
+                      &b(0, 0), b.cols(), 1,
+                      &result(0, 0), b.cols(), 1,
+                      pool);
+
+        return result;
+    }
+
+    template<typename T, size_t N, size_t M, size_t K>
+    matrix<T, N, K> multiply(const matrix<T, N, M> &a, const matrix<T, M, K> &b,
+                             thread_pool &pool = shared_thread_pool()) {
+        if constexpr (N * M * K < parallel_threshold) {
+            return a * b;
+        } else {
+            matrix<T, N, K> result(0);
+
+            parallel_gemm(N, M, K,
+                          &a(0, 0), M, 1,
+                          &b(0, 0), K, 1,
+                          &result(0, 0), K, 1,
+                          pool);
+
+            return result;
+        }
+    }
+
+    template<typename T, size_t N>
+    square_matrix<T, N> multiply(const square_matrix<T, N> &a, const square_matrix<T, N> &b,
+                                 thread_pool &pool = shared_thread_pool()) {
+        const matrix<T, N, N> &base = a;
+        return multiply(base, static_cast<const matrix<T, N, N> &>(b), pool);
+    }
+}
@@ -1,29 +1,41 @@
 #pragma once
 
 #include <initializer_list>
+#include <limits>
 #include <cassert>
 #include <math.h>
+#include "simd.h"
+#include "vector.h"
 #include "square_matrix.h"
+#include "counters.h"
 
 namespace lmel {
     template<
             typename T,
-            typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+            typename = typename std::enable_if<is_element<T>::value, T>::type
     >
     class quaternion {
+    private:
+        typedef simd::quaternion_kernel<T> kernel;
+
+        // Type of intermediate results: float for 16-bit scalars, T otherwise
+        typedef accumulate_t<T> real;
+
     public:
+        typedef T value_type;
+
         T x;
         T y;
         T z;
         T w;
 
         // Default constructor
-        explicit quaternion(T x = 0, T y = 0, T z = 0, T w = 0)
+        constexpr explicit quaternion(T x = 0, T y = 0, T z = 0, T w = 0)
                 : x(x), y(y), z(z), w(w) {}
 
         // Constructor from axis and angle
         quaternion(vector<T, 3> axis, T angle) {
-            T s = sin(angle / 2);
+            real s = sin(angle / 2);
 
             x = axis(0) * s;
             y = axis(1) * s;
@@ -31,50 +43,151 @@ namespace lmel {
             w = cos(angle / 2);
         }
 
-        // Initializer list constructor
-        quaternion(std::initializer_list<T> il) {
-            assert(il.size() == 4);
+        // Constructor from axis and angle with a math policy for sin and cos (see fast_math.h)
+        template<typename Math>
+        quaternion(vector<T, 3> axis, T angle, Math) {
+            real s, c;
+            Math::sincos(angle / 2, s, c);
 
-            auto it = il.begin();
-            x = *it++;
-            y = *it++;
-            z = *it++;
-            w = *it;
+            x = axis(0) * s;
+            y = axis(1) * s;
+            z = axis(2) * s;
+            w = c;
         }
 
-        // Copy constructor
-        quaternion(const quaternion &ref) {
-            x = ref.x;
-            y = ref.y;
-            z = ref.z;
-            w = ref.w;
+        // Initializer list constructor
+        constexpr quaternion(std::initializer_list<T> il)
+                : x(il.begin()[0]), y(il.begin()[1]), z(il.begin()[2]), w(il.begin()[3]) {
+            assert(il.size() == 4);
         }
 
+        // Copy constructor, trivial: quaternions can be copied with memcpy
+        constexpr quaternion(const quaternion &ref) = default;
+
         // Template copy constructor (for other types)
         template<typename O>
-        quaternion(const quaternion<O> &ref) {
-            x = ref.x;
-            y = ref.y;
-            z = ref.z;
-            w = ref.w;
+        constexpr quaternion(const quaternion<O> &ref)
+                : x(ref.x), y(ref.y), z(ref.z), w(ref.w) {}
+
+        // Assignment operator, trivial
+        constexpr quaternion &operator=(const quaternion &val) = default;
+
+        // Quaternion length
+        double length() const {
+            LMEL_COUNT(quaternion, 8, 4 * sizeof(T), 0);
+
+            real sum = x * x + y * y + z * z + w * w;
+
+            return sqrt(sum);
+        }
+
+        // Normalize quaternion
+        bool normalize() {
+            LMEL_COUNT(quaternion, 4, 8 * sizeof(T), 0);
+
+            double len = length();
+
+            if (len <= std::numeric_limits<double>::epsilon())
+                return false;
+
+            x /= len;
+            y /= len;
+            z /= len;
+            w /= len;
+
+            return true;
         }
 
-        // Assignment operator
-        quaternion &operator=(const quaternion &val) {
-            if (&val == this)
-                return *this;
+        // Normalize with a math policy (see fast_math.h)
+        template<typename Math>
+        bool normalize(Math) {
+            LMEL_COUNT(quaternion, 12, 8 * sizeof(T), 0);
 
-            x = val.x;
-            y = val.y;
-            z = val.z;
-            w = val.w;
+            static_assert(std::is_floating_point<real>::value, "normalize with a math policy needs a floating point type");
+
+            real sum = x * x + y * y + z * z + w * w;
+
+            if (sum <= std::numeric_limits<real>::min())
+                return false;
+
+            real inv = Math::rsqrt(sum);
+
+            x *= inv;
+            y *= inv;
+            z *= inv;
+            w *= inv;
+
+            return true;
+        }
 
+        constexpr quaternion get_conjugate() const {
+            return quaternion(-x, -y, -z, w);
+        }
+
+        // Conjugate divided by squared length, for unit quaternions get_conjugate() is enough
+        constexpr quaternion get_inverse() const {
+            LMEL_COUNT(quaternion, 11, 8 * sizeof(T), 1);
+
+            real sq = x * x + y * y + z * z + w * w;
+
+            assert(sq != 0);
+
+            return quaternion(-x / sq, -y / sq, -z / sq, w / sq);
+        }
+
+        // Default math operations:
+
+        // Hamilton product, applies val first and then this rotation
+        constexpr quaternion operator*(const quaternion &val) const {
+            LMEL_COUNT(quaternion, 28, 12 * sizeof(T), 1);
+
+            if constexpr (kernel::enabled) {
+                if (!LMEL_CONSTANT_EVALUATED()) {
+                    const T a[4] = {x, y, z, w};
+                    const T b[4] = {val.x, val.y, val.z, val.w};
+                    T r[4] {};
+
+                    kernel::mul(a, b, r);
+
+                    return quaternion(r[0], r[1], r[2], r[3]);
+                }
+            }
+
+            return quaternion(
+                    w * val.x + x * val.w + y * val.z - z * val.y,
+                    w * val.y - x * val.z + y * val.w + z * val.x,
+                    w * val.z + x * val.y - y * val.x + z * val.w,
+                    w * val.w - x * val.x - y * val.y - z * val.z
+            );
+        }
+
+        constexpr quaternion &operator*=(const quaternion &val) {
+            *this = *this * val;
             return *this;
         }
 
+        // Rotate vector by this quaternion, which must have unit length.
+        // Same result as get_rotation_matrix3d() * vec without building the matrix:
+        // t = 2 * cross(q.xyz, vec), result = vec + w * t + cross(q.xyz, t).
+        // Plain scalar code: in loops over many vectors the compiler vectorizes it
+        // across vectors, which is faster than packing one vector into a register
+        constexpr vector<T, 3> rotate(const vector<T, 3> &vec) const {
+            LMEL_COUNT(quaternion, 30, 10 * sizeof(T), 1);
+
+            const real tx = (y * vec(2) - z * vec(1)) * 2;
+            const real ty = (z * vec(0) - x * vec(2)) * 2;
+            const real tz = (x * vec(1) - y * vec(0)) * 2;
+
+            return vector<T, 3>{
+                    vec(0) + w * tx + (y * tz - z * ty),
+                    vec(1) + w * ty + (z * tx - x * tz),
+                    vec(2) + w * tz + (x * ty - y * tx)
+            };
+        }
+
         // Compare operations:
 
-        bool operator==(const quaternion &m) const {
+        constexpr bool operator==(const quaternion &m) const {
             return
                     x == m.x &&
                     y == m.y &&
@@ -82,7 +195,7 @@ namespace lmel {
                     w == m.w;
         }
 
-        bool operator!=(const quaternion &m) const {
+        constexpr bool operator!=(const quaternion &m) const {
             return
                     x != m.x ||
                     y != m.y ||
@@ -90,20 +203,22 @@ namespace lmel {
                     w != m.w;
         }
 
-        square_matrix<T, 3> get_rotation_matrix3d() const {
-            T sqx = x * x;
-            T sqy = y * y;
-            T sqz = z * z;
-            T sqw = w * w;
+        constexpr square_matrix<T, 3> get_rotation_matrix3d() const {
+            LMEL_COUNT(quaternion, 44, 13 * sizeof(T), 1);
+
+            real sqx = x * x;
+            real sqy = y * y;
+            real sqz = z * z;
+            real sqw = w * w;
 
-            T i = 1 / (sqx + sqy + sqz + sqw);
+            real i = 1 / (sqx + sqy + sqz + sqw);
 
-            T xy = x * y;
-            T zw = z * w;
-            T xz = x * z;
-            T yw = y * w;
-            T yz = y * z;
-            T xw = x * w;
+            real xy = x * y;
+            real zw = z * w;
+            real xz = x * z;
+            real yw = y * w;
+            real yz = y * z;
+            real xw = x * w;
 
             return square_matrix<T, 3>
                     {
@@ -116,19 +231,19 @@ namespace lmel {
 
     template<typename T, typename V, typename A>
     quaternion<T> make_quaternion(vector<V, 3> axis, A angle) {
-        T s = sin(angle / 2);
+        accumulate_t<T> s = sin(angle / 2);
 
         return quaternion<T>(
-                axis.x() * s,
-                axis.y() * s,
-                axis.z() * s,
+                axis(0) * s,
+                axis(1) * s,
+                axis(2) * s,
                 cos(angle / 2)
         );
     }
 
     template<typename T, typename V, typename A>
     quaternion<T> make_quaternion(V axis_x, V axis_y, V axis_z, A angle) {
-        T s = sin(angle / 2);
+        accumulate_t<T> s = sin(angle / 2);
 
         return quaternion<T>(
                 axis_x * s,
@@ -138,8 +253,28 @@ namespace lmel {
         );
     }
 
+    // Versions with a math policy for sin and cos (see fast_math.h)
+    template<typename T, typename V, typename A, typename Math>
+    quaternion<T> make_quaternion(vector<V, 3> axis, A angle, Math) {
+        accumulate_t<T> s, c;
+        Math::sincos(static_cast<accumulate_t<T>>(angle / 2), s, c);
+
+        return quaternion<T>(axis(0) * s, axis(1) * s, axis(2) * s, c);
+    }
+
+    template<typename T, typename V, typename A, typename Math>
+    quaternion<T> make_quaternion(V axis_x, V axis_y, V axis_z, A angle, Math) {
+        accumulate_t<T> s, c;
+        Math::sincos(static_cast<accumulate_t<T>>(angle / 2), s, c);
+
+        return quaternion<T>(axis_x * s, axis_y * s, axis_z * s, c);
+    }
+
     template<typename T>
-    quaternion<T> make_id_quaternion() {
-        return quaternion<T>(1, 0, 0, 0);
+    constexpr quaternion<T> make_id_quaternion() {
+        return quaternion<T>(0, 0, 0, 1);
     }
+
+    static_assert(std::is_trivially_copyable<quaternion<float>>::value &&
+                  std::is_standard_layout<quaternion<float>>::value, "quaternion must be trivially copyable");
 }
@@ -0,0 +1,601 @@
+#pragma once
+
+#include <type_traits>
+#include <cstddef>
+#include <cassert>
+#include <limits>
+#include <math.h>
+#include "simd.h"
+#include "gemm.h"
+#include "vector.h"
+#include "matrix.h"
+#include "square_matrix.h"
+#include "determinant.h"
+#include "counters.h"
+
+namespace lmel {
+    // Non-owning vectors and matrices over memory owned by someone else: network buffers,
+    // mapped files, GPU staging memory or the elements of an lmel vector or matrix.
+    //
+    // A ref is a pointer with a shape, copying a ref copies the pointer. Assigning to a
+    // ref, or any in-place operation on it, writes into the referenced memory. Binary
+    // operators return ordinary vectors and matrices. T may be const for read-only refs.
+    // The memory must outlive the ref; operands of in-place operations may be the same
+    // memory but must not partially overlap.
+
+    // N elements, stride elements apart
+    template<typename T, size_t N>
+    class vector_ref {
+    public:
+        typedef typename std::remove_const<T>::type value_type;
+        typedef vector<value_type, N> result_type;
+
+        static const size_t size = N;
+
+    private:
+        typedef simd::kernel<value_type, N> kernel;
+
+        T *ptr;
+        ptrdiff_t step;
+
+        // Kernels need contiguous elements
+        constexpr bool use_kernel() const {
+            return kernel::enabled && step == 1 && !LMEL_CONSTANT_EVALUATED();
+        }
+
+    public:
+        constexpr explicit vector_ref(T *data, ptrdiff_t stride = 1)
+                : ptr(data), step(stride) {}
+
+        // Ref to the elements of an lmel vector
+        template<typename S>
+        constexpr vector_ref(vector<value_type, N, S> &vec)
+                : ptr(&vec(0)), step(1) {}
+
+        template<typename S, typename U = T, typename = typename std::enable_if<std::is_const<U>::value>::type>
+        constexpr vector_ref(const vector<value_type, N, S> &vec)
+                : ptr(&vec(0)), step(1) {}
+
+        // Read-only ref from writable one
+        template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+        constexpr vector_ref(const vector_ref<U, N> &ref)
+                : ptr(ref.data()), step(ref.stride()) {}
+
+        constexpr vector_ref(const vector_ref &) = default;
+
+        // Copies elements, the ref keeps pointing at its own memory
+        constexpr vector_ref &operator=(const vector_ref &val) {
+            return *this = result_type(val);
+        }
+
+        constexpr vector_ref &operator=(const result_type &val) {
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) = val(i);
+
+            return *this;
+        }
+
+        constexpr operator result_type() const {
+            result_type result(0);
+
+            for (size_t i = 0; i < size; ++i)
+                result(i) = (*this)(i);
+
+            return result;
+        }
+
+        constexpr T *data() const {
+            return ptr;
+        }
+
+        constexpr ptrdiff_t stride() const {
+            return step;
+        }
+
+        // Vector length
+        double length() const {
+            value_type sum = *this * result_type(*this);
+
+            return sqrt(sum);
+        }
+
+        // Normalize vector in place
+        bool normalize() {
+            double len = length();
+
+            if (len <= std::numeric_limits<double>::epsilon())
+                return false;
+
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) /= len;
+
+            return true;
+        }
+
+        // Default math operations, results are vectors:
+
+        constexpr result_type operator+(const result_type &val) const {
+            return result_type(*this) + val;
+        }
+
+        constexpr result_type operator-(const result_type &val) const {
+            return result_type(*this) - val;
+        }
+
+        // Dot product
+        constexpr value_type operator*(const result_type &val) const {
+            if constexpr (kernel::enabled)
+                if (use_kernel())
+                    return kernel::dot(ptr, &val(0));
+
+            value_type prod = 0;
+
+            for (size_t i = 0; i < size; ++i)
+                prod += (*this)(i) * val(i);
+
+            return prod;
+        }
+
+        constexpr result_type operator+(value_type val) const {
+            return result_type(*this) + val;
+        }
+
+        constexpr result_type operator-(value_type val) const {
+            return result_type(*this) - val;
+        }
+
+        constexpr result_type operator*(value_type val) const {
+            return result_type(*this) * val;
+        }
+
+        constexpr result_type operator/(value_type val) const {
+            return result_type(*this) / val;
+        }
+
+        // In-place operations on the referenced memory:
+
+        constexpr vector_ref &operator+=(const result_type &val) {
+            if constexpr (kernel::enabled)
+                if (use_kernel()) {
+                    kernel::add(ptr, &val(0), ptr);
+                    return *this;
+                }
+
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) += val(i);
+
+            return *this;
+        }
+
+        constexpr vector_ref &operator-=(const result_type &val) {
+            if constexpr (kernel::enabled)
+                if (use_kernel()) {
+                    kernel::sub(ptr, &val(0), ptr);
+                    return *this;
+                }
+
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) -= val(i);
+
+            return *this;
+        }
+
+        constexpr vector_ref &operator+=(value_type val) {
+            if constexpr (kernel::enabled)
+                if (use_kernel()) {
+                    kernel::add(ptr, val, ptr);
+                    return *this;
+                }
+
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) += val;
+
+            return *this;
+        }
+
+        constexpr vector_ref &operator-=(value_type val) {
+            if constexpr (kernel::enabled)
+                if (use_kernel()) {
+                    kernel::sub(ptr, val, ptr);
+                    return *this;
+                }
+
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) -= val;
+
+            return *this;
+        }
+
+        constexpr vector_ref &operator*=(value_type val) {
+            if constexpr (kernel::enabled)
+                if (use_kernel()) {
+                    kernel::mul(ptr, val, ptr);
+                    return *this;
+                }
+
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) *= val;
+
+            return *this;
+        }
+
+        constexpr vector_ref &operator/=(value_type val) {
+            if constexpr (kernel::enabled)
+                if (use_kernel()) {
+                    kernel::div(ptr, val, ptr);
+                    return *this;
+                }
+
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) /= val;
+
+            return *this;
+        }
+
+        // Compare operations:
+
+        constexpr bool operator==(const result_type &val) const {
+            for (size_t i = 0; i < size; ++i)
+                if ((*this)(i) != val(i))
+                    return false;
+
+            return true;
+        }
+
+        constexpr bool operator!=(const result_type &val) const {
+            return !(*this == val);
+        }
+
+        // get/set selected element:
+
+        constexpr T &operator()(size_t i) const {
+            assert(i < size);
+            return ptr[static_cast<ptrdiff_t>(i) * step];
+        }
+    };
+
+    // N x M elements in lines stride elements apart: rows for row_major, columns for col_major
+    template<typename T, size_t N, size_t M, typename Layout = row_major>
+    class matrix_ref {
+    public:
+        typedef typename std::remove_const<T>::type value_type;
+
+        static const size_t rows = N;
+        static const size_t cols = M;
+
+        static const bool is_col_major = std::is_same<Layout, col_major>::value;
+        static const size_t line_size = is_col_major ? N : M;
+
+        // Matrix of given shape, square_matrix for square shapes
+        template<size_t R, size_t C>
+        using block_type = typename std::conditional<R == C,
+                square_matrix<value_type, R, packed_storage, Layout>,
+                matrix<value_type, R, C, packed_storage, Layout>>::type;
+
+        typedef block_type<N, M> result_type;
+
+    private:
+        T *ptr;
+        size_t line_stride;
+
+    public:
+        constexpr explicit matrix_ref(T *data, size_t stride = line_size)
+                : ptr(data), line_stride(stride) {
+            assert(stride >= line_size);
+        }
+
+        // Ref to the elements of an lmel matrix of the same layout
+        template<typename S>
+        constexpr matrix_ref(matrix<value_type, N, M, S, Layout> &m)
+                : ptr(&m(0, 0)), line_stride(matrix<value_type, N, M, S, Layout>::stride) {}
+
+        template<typename S, typename U = T, typename = typename std::enable_if<std::is_const<U>::value>::type>
+        constexpr matrix_ref(const matrix<value_type, N, M, S, Layout> &m)
+                : ptr(&m(0, 0)), line_stride(matrix<value_type, N, M, S, Layout>::stride) {}
+
+        // Read-only ref from writable one
+        template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+        constexpr matrix_ref(const matrix_ref<U, N, M, Layout> &ref)
+                : ptr(ref.data()), line_stride(ref.stride()) {}
+
+        constexpr matrix_ref(const matrix_ref &) = default;
+
+        // Copies elements, the ref keeps pointing at its own memory
+        constexpr matrix_ref &operator=(const matrix_ref &val) {
+            return *this = result_type(val);
+        }
+
+        constexpr matrix_ref &operator=(const result_type &val) {
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    (*this)(i, j) = val(i, j);
+
+            return *this;
+        }
+
+        constexpr operator result_type() const {
+            result_type result(0);
+
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    result(i, j) = (*this)(i, j);
+
+            return result;
+        }
+
+        constexpr T *data() const {
+            return ptr;
+        }
+
+        constexpr size_t stride() const {
+            return line_stride;
+        }
+
+        // Distance between elements (i, j) and (i + 1, j), and between (i, j) and (i, j + 1)
+        constexpr ptrdiff_t row_step() const {
+            return is_col_major ? 1 : line_stride;
+        }
+
+        constexpr ptrdiff_t col_step() const {
+            return is_col_major ? line_stride : 1;
+        }
+
+        // Refs to parts of the same memory:
+
+        constexpr vector_ref<T, M> row(size_t i) const {
+            assert(i < rows);
+            return vector_ref<T, M>(ptr + i * row_step(), col_step());
+        }
+
+        constexpr vector_ref<T, N> col(size_t j) const {
+            assert(j < cols);
+            return vector_ref<T, N>(ptr + j * col_step(), row_step());
+        }
+
+        // R x C block with top left element (i, j)
+        template<size_t R, size_t C>
+        constexpr matrix_ref<T, R, C, Layout> block(size_t i, size_t j) const {
+            assert(i + R <= rows && j + C <= cols);
+            return matrix_ref<T, R, C, Layout>(ptr + i * row_step() + j * col_step(), line_stride);
+        }
+
+        // Same memory read as the transposed matrix, the layout flips
+        constexpr matrix_ref<T, M, N, typename std::conditional<is_col_major, row_major, col_major>::type>
+        transposed() const {
+            return matrix_ref<T, M, N, typename std::conditional<is_col_major, row_major, col_major>::type>(
+                    ptr, line_stride);
+        }
+
+        // Default math operations, results are matrices:
+
+        constexpr result_type operator+(const result_type &val) const {
+            return result_type(*this) + val;
+        }
+
+        constexpr result_type operator-(const result_type &val) const {
+            return result_type(*this) - val;
+        }
+
+        constexpr result_type operator+(value_type val) const {
+            return result_type(*this) + val;
+        }
+
+        constexpr result_type operator-(value_type val) const {
+            return result_type(*this) - val;
+        }
+
+        constexpr result_type operator*(value_type val) const {
+            return result_type(*this) * val;
+        }
+
+        constexpr result_type operator/(value_type val) const {
+            return result_type(*this) / val;
+        }
+
+        // Matrix product, see also multiply() for a result written to a ref
+        template<typename U, size_t K, typename L>
+        block_type<N, K> operator*(const matrix_ref<U, M, K, L> &val) const;
+
+        template<size_t K, typename S, typename L>
+        block_type<N, K> operator*(const matrix<value_type, M, K, S, L> &val) const {
+            return *this * matrix_ref<const value_type, M, K, L>(val);
+        }
+
+        // Vector product
+        constexpr vector<value_type, N> operator*(const vector<value_type, M> &vec) const {
+            vector<value_type, N> result(0);
+
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    result(i) += (*this)(i, j) * vec(j);
+
+            return result;
+        }
+
+        // In-place operations on the referenced memory, lines are walked contiguously:
+
+        template<typename U, typename L>
+        constexpr matrix_ref &operator+=(const matrix_ref<U, N, M, L> &val) {
+            for (size_t i = 0; i < (is_col_major ? cols : rows); ++i)
+                for (size_t j = 0; j < line_size; ++j)
+                    element(i, j) += is_col_major ? val(j, i) : val(i, j);
+
+            return *this;
+        }
+
+        template<typename U, typename L>
+        constexpr matrix_ref &operator-=(const matrix_ref<U, N, M, L> &val) {
+            for (size_t i = 0; i < (is_col_major ? cols : rows); ++i)
+                for (size_t j = 0; j < line_size; ++j)
+                    element(i, j) -= is_col_major ? val(j, i) : val(i, j);
+
+            return *this;
+        }
+
+        constexpr matrix_ref &operator+=(const result_type &val) {
+            return *this += matrix_ref<const value_type, N, M, Layout>(val);
+        }
+
+        constexpr matrix_ref &operator-=(const result_type &val) {
+            return *this -= matrix_ref<const value_type, N, M, Layout>(val);
+        }
+
+        constexpr matrix_ref &operator+=(value_type val) {
+            for (size_t i = 0; i < (is_col_major ? cols : rows); ++i)
+                for (size_t j = 0; j < line_size; ++j)
+                    element(i, j) += val;
+
+            return *this;
+        }
+
+        constexpr matrix_ref &operator-=(value_type val) {
+            for (size_t i = 0; i < (is_col_major ? cols : rows); ++i)
+                for (size_t j = 0; j < line_size; ++j)
+                    element(i, j) -= val;
+
+            return *this;
+        }
+
+        constexpr matrix_ref &operator*=(value_type val) {
+            for (size_t i = 0; i < (is_col_major ? cols : rows); ++i)
+                for (size_t j = 0; j < line_size; ++j)
+                    element(i, j) *= val;
+
+            return *this;
+        }
+
+        constexpr matrix_ref &operator/=(value_type val) {
+            for (size_t i = 0; i < (is_col_major ? cols : rows); ++i)
+                for (size_t j = 0; j < line_size; ++j)
+                    element(i, j) /= val;
+
+            return *this;
+        }
+
+        // Compare operations:
+
+        // Matrices and refs of any storage and layout
+        template<typename V>
+        constexpr bool operator==(const V &val) const {
+            static_assert(V::rows == N && V::cols == M, "matrices must have the same size");
+
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    if ((*this)(i, j) != val(i, j))
+                        return false;
+
+            return true;
+        }
+
+        template<typename V>
+        constexpr bool operator!=(const V &val) const {
+            return !(*this == val);
+        }
+
+        // get/set selected element:
+
+        constexpr T &operator()(size_t row, size_t col) const {
+            assert(row < rows && col < cols);
+            return is_col_major ? ptr[col * line_stride + row] : ptr[row * line_stride + col];
+        }
+
+    private:
+        // Element j of line i
+        constexpr T &element(size_t i, size_t j) const {
+            return ptr[i * line_stride + j];
+        }
+    };
+
+    // C = A * B written into the memory of c, which must not overlap a or b.
+    // Large products go through gemm() with the strides of the refs, 16-bit scalars
+    // sum each element in float and round it once
+    template<typename A, typename B, typename C, size_t N, size_t M, size_t K,
+             typename LA, typename LB, typename LC>
+    void multiply(const matrix_ref<A, N, M, LA> &a, const matrix_ref<B, M, K, LB> &b,
+                  const matrix_ref<C, N, K, LC> &c) {
+        static_assert(std::is_same<typename matrix_ref<A, N, M, LA>::value_type, C>::value &&
+                      std::is_same<typename matrix_ref<B, M, K, LB>::value_type, C>::value,
+                      "operands must have the same element type");
+
+        for (size_t i = 0; i < N; ++i)
+            for (size_t k = 0; k < K; ++k)
+                c(i, k) = 0;
+
+        if constexpr (N * M * K >= gemm_threshold && std::is_arithmetic<C>::value) {
+            gemm(N, M, K,
+                 a.data(), a.row_step(), a.col_step(),
+                 b.data(), b.row_step(), b.col_step(),
+                 c.data(), c.row_step(), c.col_step());
+        } else if constexpr (is_storage_scalar<C>::value) {
+            for (size_t i = 0; i < N; ++i)
+                for (size_t k = 0; k < K; ++k) {
+                    accumulate_t<C> sum = 0;
+
+                    for (size_t j = 0; j < M; ++j)
+                        sum += a(i, j) * b(j, k);
+
+                    c(i, k) = sum;
+                }
+        } else {
+            for (size_t i = 0; i < N; ++i)
+                for (size_t j = 0; j < M; ++j)
+                    for (size_t k = 0; k < K; ++k)
+                        c(i, k) += a(i, j) * b(j, k);
+        }
+    }
+
+    template<typename T, size_t N, size_t M, typename Layout>
+    template<typename U, size_t K, typename L>
+    typename matrix_ref<T, N, M, Layout>::template block_type<N, K>
+    matrix_ref<T, N, M, Layout>::operator*(const matrix_ref<U, M, K, L> &val) const {
+        block_type<N, K> result(0);
+
+        multiply(*this, val, matrix_ref<value_type, N, K, Layout>(result));
+
+        return result;
+    }
+
+    // Refs to the elements of lmel vectors and matrices
+    template<typename T, size_t N, typename S>
+    constexpr vector_ref<T, N> make_ref(vector<T, N, S> &vec) {
+        return vector_ref<T, N>(vec);
+    }
+
+    template<typename T, size_t N, typename S>
+    constexpr vector_ref<const T, N> make_ref(const vector<T, N, S> &vec) {
+        return vector_ref<const T, N>(vec);
+    }
+
+    template<typename T, size_t N, size_t M, typename S, typename L>
+    constexpr matrix_ref<T, N, M, L> make_ref(matrix<T, N, M, S, L> &m) {
+        return matrix_ref<T, N, M, L>(m);
+    }
+
+    template<typename T, size_t N, size_t M, typename S, typename L>
+    constexpr matrix_ref<const T, N, M, L> make_ref(const matrix<T, N, M, S, L> &m) {
+        return matrix_ref<const T, N, M, L>(m);
+    }
+
+    template<typename T, size_t N, typename L>
+    constexpr typename matrix_ref<T, N, N, L>::value_type determinant(const matrix_ref<T, N, N, L> &m) {
+        return detail::determinant<typename matrix_ref<T, N, N, L>::value_type, N>(m);
+    }
+
+    // Destinations of lazy expressions (see expression.h)
+    template<typename T, size_t N, typename E>
+    constexpr void assign_expression(const vector_ref<T, N> &dst, const E &e) {
+        LMEL_COUNT(expression, E::operations * N, (E::operands + 1) * N * sizeof(T), 0);
+
+        for (size_t i = 0; i < N; ++i)
+            dst(i) = e(i);
+    }
+
+    template<typename T, size_t N, size_t M, typename L, typename E>
+    constexpr void assign_expression(const matrix_ref<T, N, M, L> &dst, const E &e) {
+        LMEL_COUNT(expression, E::operations * N * M, (E::operands + 1) * N * M * sizeof(T), 0);
+
+        for (size_t i = 0; i < N; ++i)
+            for (size_t j = 0; j < M; ++j)
+                dst(i, j) = e(i, j);
+    }
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "half.h"
+
+namespace lmel {
+    // Binary snapshots of contiguous arrays of trivially copyable elements: vectors, matrices,
+    // quaternions, transforms or plain scalars. A 32-byte header is followed by the raw element
+    // bytes, so a whole array is written and read with one call. Data is written in the byte
+    // order of the writer and swapped on load when the reader's differs
+    static const uint16_t serial_version = 1;
+    static const uint32_t serial_byte_order = 0x01020304;
+
+    // Bytes read at a time into a growing std::vector, so that a corrupt count in the
+    // header can not allocate more memory than the stream holds
+    static const size_t serial_block = 1 << 24;
+
+    // Kind of the scalars an element is made of
+    enum class serial_scalar : uint8_t {
+        other, signed_integer, unsigned_integer, floating_point, half, bfloat16
+    };
+
+    struct serial_header {
+        char magic[4];          // "LMEL"
+        uint32_t byte_order;    // serial_byte_order in the byte order of the writer
+        uint16_t version;       // serial_version of the writer
+        uint8_t scalar;         // serial_scalar
+        uint8_t scalar_size;    // bytes per scalar, the unit of byte swapping
+        uint32_t element_size;  // bytes per element
+        uint64_t count;         // number of elements
+        uint64_t reserved;
+    };
+
+    static_assert(sizeof(serial_header) == 32 && std::is_trivially_copyable<serial_header>::value,
+                  "serial_header must be 32 bytes without padding");
+
+    namespace detail {
+        // Scalar type of an element: value_type, recursively, or the type itself
+        template<typename T, typename = void>
+        struct serial_scalar_of {
+            typedef T type;
+        };
+
+        template<typename T>
+        struct serial_scalar_of<T, std::void_t<typename T::value_type>> {
+            typedef typename serial_scalar_of<typename T::value_type>::type type;
+        };
+
+        template<typename S>
+        constexpr serial_scalar serial_scalar_kind() {
+            if constexpr (std::is_same<S, half>::value)
+                return serial_scalar::half;
+            else if constexpr (std::is_same<S, bfloat16>::value)
+                return serial_scalar::bfloat16;
+            else if constexpr (std::is_floating_point<S>::value)
+                return serial_scalar::floating_point;
+            else if constexpr (std::is_integral<S>::value && std::is_signed<S>::value)
+                return serial_scalar::signed_integer;
+            else if constexpr (std::is_integral<S>::value)
+                return serial_scalar::unsigned_integer;
+            else
+                return serial_scalar::other;
+        }
+
+        template<typename U>
+        U byte_swap(U v) {
+            U result = 0;
+
+            for (size_t i = 0; i < sizeof(U); ++i) {
+                result = U(result << 8) | U(v & 0xff);
+                v = U(v >> 8);
+            }
+
+            return result;
+        }
+
+        template<typename U>
+        void byte_swap(char *p, size_t count) {
+            for (size_t i = 0; i < count; ++i, p += sizeof(U)) {
+                U v;
+                memcpy(&v, p, sizeof(U));
+                v = byte_swap(v);
+                memcpy(p, &v, sizeof(U));
+            }
+        }
+
+        // Reverse the bytes of every width-byte unit in [p, p + bytes)
+        inline void byte_swap(char *p, size_t bytes, size_t width) {
+            switch (width) {
+                case 1:
+                    break;
+                case 2:
+                    byte_swap<uint16_t>(p, bytes / 2);
+                    break;
+                case 4:
+                    byte_swap<uint32_t>(p, bytes / 4);
+                    break;
+                case 8:
+                    byte_swap<uint64_t>(p, bytes / 8);
+                    break;
+                default:
+                    for (size_t i = 0; i + width <= bytes; i += width)
+                        std::reverse(p + i, p + i + width);
+            }
+        }
+
+        // Element and header checks shared by serialize() and deserialize()
+        template<typename T>
+        struct serial_element {
+            typedef typename serial_scalar_of<T>::type scalar;
+
+            static_assert(std::is_trivially_copyable<T>::value, "serialized elements must be trivially copyable");
+            static_assert(sizeof(T) % sizeof(scalar) == 0, "serialized elements must be made of whole scalars");
+
+            static constexpr serial_scalar kind = serial_scalar_kind<scalar>();
+
+            // Elements of kind other are opaque, their bytes can not be swapped
+            static bool matches(const serial_header &h) {
+                return h.scalar == uint8_t(kind) && h.scalar_size == sizeof(scalar) &&
+                       h.element_size == sizeof(T) && (kind != serial_scalar::other || h.byte_order == serial_byte_order);
+            }
+        };
+    }
+
+    // Header for count elements of type T
+    template<typename T>
+    serial_header make_serial_header(size_t count) {
+        typedef detail::serial_element<T> element;
+
+        serial_header h {};
+        memcpy(h.magic, "LMEL", 4);
+        h.byte_order = serial_byte_order;
+        h.version = serial_version;
+        h.scalar = uint8_t(element::kind);
+        h.scalar_size = uint8_t(sizeof(typename element::scalar));
+        h.element_size = uint32_t(sizeof(T));
+        h.count = count;
+
+        return h;
+    }
+
+    // Read a header and bring its fields into native byte order. byte_order is kept as read,
+    // it differs from serial_byte_order when the data has to be swapped. Returns false for
+    // other data and for versions newer than serial_version
+    inline bool read_serial_header(std::istream &in, serial_header &h) {
+        if (!in.read(reinterpret_cast<char *>(&h), sizeof(h)) || memcmp(h.magic, "LMEL", 4) != 0)
+            return false;
+
+        if (h.byte_order == detail::byte_swap(serial_byte_order)) {
+            h.version = detail::byte_swap(h.version);
+            h.element_size = detail::byte_swap(h.element_size);
+            h.count = detail::byte_swap(h.count);
+            h.reserved = detail::byte_swap(h.reserved);
+        } else if (h.byte_order != serial_byte_order)
+            return false;
+
+        return h.version != 0 && h.version <= serial_version;
+    }
+
+    // Write count elements with a header, the elements in a single write.
+    // Returns false when the stream fails
+    template<typename T>
+    bool serialize(std::ostream &out, const T *data, size_t count) {
+        const serial_header h = make_serial_header<T>(count);
+
+        out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char *>(data), std::streamsize(count * sizeof(T)));
+
+        return bool(out);
+    }
+
+    template<typename T>
+    bool serialize(std::ostream &out, const std::vector<T> &data) {
+        return serialize(out, data.data(), data.size());
+    }
+
+    namespace detail {
+        template<typename T>
+        bool deserialize_data(std::istream &in, const serial_header &h, T *data, size_t count) {
+            char *const p = reinterpret_cast<char *>(data);
+            const size_t bytes = count * sizeof(T);
+
+            if (!in.read(p, std::streamsize(bytes)))
+                return false;
+
+            if (h.byte_order != serial_byte_order)
+                byte_swap(p, bytes, sizeof(typename serial_element<T>::scalar));
+
+            return true;
+        }
+    }
+
+    // Read exactly count elements written by serialize(). Returns false when the header does
+    // not match T and count, or the stream ends early; data may be partly written then
+    template<typename T>
+    bool deserialize(std::istream &in, T *data, size_t count) {
+        serial_header h;
+
+        if (!read_serial_header(in, h) || !detail::serial_element<T>::matches(h) || h.count != count)
+            return false;
+
+        return detail::deserialize_data(in, h, data, count);
+    }
+
+    // Read all elements written by serialize() into data, resized to their count. The count
+    // in the header is not trusted: data grows by serial_block bytes as the stream delivers them
+    template<typename T>
+    bool deserialize(std::istream &in, std::vector<T> &data) {
+        serial_header h;
+
+        if (!read_serial_header(in, h) || !detail::serial_element<T>::matches(h) || h.count > data.max_size())
+            return false;
+
+        const size_t count = size_t(h.count);
+        const size_t block = std::max(serial_block / sizeof(T), size_t(1));
+
+        data.clear();
+
+        for (size_t done = 0; done < count;) {
+            const size_t n = std::min(block, count - done);
+
+            data.resize(done + n);
+
+            if (!detail::deserialize_data(in, h, data.data() + done, n))
+                return false;
+
+            done += n;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,314 @@
+#pragma once
+
+#include <cstddef>
+
+// True while a constexpr function is evaluated by the compiler, where the SIMD
+// kernels can not run. Without compiler support the scalar paths are always used.
+#if defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+#define LMEL_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+#define LMEL_CONSTANT_EVALUATED() true
+#endif
+
+// SIMD support detection. Define LMEL_NO_SIMD to force the scalar paths.
+#if !defined(LMEL_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define LMEL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(LMEL_SSE2) && defined(__AVX__)
+#define LMEL_AVX 1
+#include <immintrin.h>
+#endif
+
+#if defined(LMEL_AVX) && defined(__AVX2__)
+#define LMEL_AVX2 1
+#endif
+
+namespace lmel {
+    namespace simd {
+        // Hand-written kernels for small fixed-size vectors.
+        // Types without a specialization use the scalar loops of the caller.
+        // Every kernel gives the same result as the scalar loop: the dot product
+        // sums the lane products in index order and is not fused.
+        template<typename T, size_t N>
+        struct kernel {
+            static const bool enabled = false;
+        };
+
+#ifdef LMEL_SSE2
+        template<>
+        struct kernel<float, 4> {
+            static const bool enabled = true;
+
+            static void add(const float *a, const float *b, float *r) {
+                _mm_storeu_ps(r, _mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+            }
+
+            static void sub(const float *a, const float *b, float *r) {
+                _mm_storeu_ps(r, _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+            }
+
+            static void add(const float *a, float b, float *r) {
+                _mm_storeu_ps(r, _mm_add_ps(_mm_loadu_ps(a), _mm_set1_ps(b)));
+            }
+
+            static void sub(const float *a, float b, float *r) {
+                _mm_storeu_ps(r, _mm_sub_ps(_mm_loadu_ps(a), _mm_set1_ps(b)));
+            }
+
+            static void mul(const float *a, float b, float *r) {
+                _mm_storeu_ps(r, _mm_mul_ps(_mm_loadu_ps(a), _mm_set1_ps(b)));
+            }
+
+            static void div(const float *a, float b, float *r) {
+                _mm_storeu_ps(r, _mm_div_ps(_mm_loadu_ps(a), _mm_set1_ps(b)));
+            }
+
+            // Divide by a double value as the scalar code does: widen, divide, narrow
+            static void div(const float *a, double b, float *r) {
+                __m128 v = _mm_loadu_ps(a);
+                __m128d lo = _mm_cvtps_pd(v);
+                __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+                __m128d d = _mm_set1_pd(b);
+
+                lo = _mm_div_pd(lo, d);
+                hi = _mm_div_pd(hi, d);
+
+                _mm_storeu_ps(r, _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+            }
+
+            static float dot(const float *a, const float *b) {
+                alignas(16) float p[4];
+                _mm_store_ps(p, _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+
+                return ((p[0] + p[1]) + p[2]) + p[3];
+            }
+
+            static bool equal(const float *a, const float *b) {
+                return _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))) == 0xF;
+            }
+        };
+
+        template<>
+        struct kernel<double, 4> {
+            static const bool enabled = true;
+
+#ifdef LMEL_AVX
+            static void add(const double *a, const double *b, double *r) {
+                _mm256_storeu_pd(r, _mm256_add_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b)));
+            }
+
+            static void sub(const double *a, const double *b, double *r) {
+                _mm256_storeu_pd(r, _mm256_sub_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b)));
+            }
+
+            static void add(const double *a, double b, double *r) {
+                _mm256_storeu_pd(r, _mm256_add_pd(_mm256_loadu_pd(a), _mm256_set1_pd(b)));
+            }
+
+            static void sub(const double *a, double b, double *r) {
+                _mm256_storeu_pd(r, _mm256_sub_pd(_mm256_loadu_pd(a), _mm256_set1_pd(b)));
+            }
+
+            static void mul(const double *a, double b, double *r) {
+                _mm256_storeu_pd(r, _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_set1_pd(b)));
+            }
+
+            static void div(const double *a, double b, double *r) {
+                _mm256_storeu_pd(r, _mm256_div_pd(_mm256_loadu_pd(a), _mm256_set1_pd(b)));
+            }
+
+            static double dot(const double *a, const double *b) {
+                alignas(32) double p[4];
+                _mm256_store_pd(p, _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b)));
+
+                return ((p[0] + p[1]) + p[2]) + p[3];
+            }
+
+            static bool equal(const double *a, const double *b) {
+                return _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b), _CMP_EQ_OQ)) == 0xF;
+            }
+#else
+            static void add(const double *a, const double *b, double *r) {
+                _mm_storeu_pd(r, _mm_add_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+                _mm_storeu_pd(r + 2, _mm_add_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+            }
+
+            static void sub(const double *a, const double *b, double *r) {
+                _mm_storeu_pd(r, _mm_sub_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+                _mm_storeu_pd(r + 2, _mm_sub_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+            }
+
+            static void add(const double *a, double b, double *r) {
+                __m128d s = _mm_set1_pd(b);
+                _mm_storeu_pd(r, _mm_add_pd(_mm_loadu_pd(a), s));
+                _mm_storeu_pd(r + 2, _mm_add_pd(_mm_loadu_pd(a + 2), s));
+            }
+
+            static void sub(const double *a, double b, double *r) {
+                __m128d s = _mm_set1_pd(b);
+                _mm_storeu_pd(r, _mm_sub_pd(_mm_loadu_pd(a), s));
+                _mm_storeu_pd(r + 2, _mm_sub_pd(_mm_loadu_pd(a + 2), s));
+            }
+
+            static void mul(const double *a, double b, double *r) {
+                __m128d s = _mm_set1_pd(b);
+                _mm_storeu_pd(r, _mm_mul_pd(_mm_loadu_pd(a), s));
+                _mm_storeu_pd(r + 2, _mm_mul_pd(_mm_loadu_pd(a + 2), s));
+            }
+
+            static void div(const double *a, double b, double *r) {
+                __m128d s = _mm_set1_pd(b);
+                _mm_storeu_pd(r, _mm_div_pd(_mm_loadu_pd(a), s));
+                _mm_storeu_pd(r + 2, _mm_div_pd(_mm_loadu_pd(a + 2), s));
+            }
+
+            static double dot(const double *a, const double *b) {
+                alignas(16) double p[4];
+                _mm_store_pd(p, _mm_mul_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+                _mm_store_pd(p + 2, _mm_mul_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+
+                return ((p[0] + p[1]) + p[2]) + p[3];
+            }
+
+            static bool equal(const double *a, const double *b) {
+                int lo = _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+                int hi = _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+
+                return (lo & hi) == 0x3;
+            }
+#endif
+        };
+#endif
+
+        // Quaternion kernels, values are passed as {x, y, z, w}.
+        // Same summation order as the scalar code in quaternion.h
+        template<typename T>
+        struct quaternion_kernel {
+            static const bool enabled = false;
+        };
+
+#ifdef LMEL_SSE2
+        template<>
+        struct quaternion_kernel<float> {
+            static const bool enabled = true;
+
+            static __m128 flip(__m128 v, int x, int y, int z, int w) {
+                const int s = int(0x80000000);
+                return _mm_xor_ps(v, _mm_castsi128_ps(_mm_setr_epi32(x ? s : 0, y ? s : 0, z ? s : 0, w ? s : 0)));
+            }
+
+            // Hamilton product a * b
+            static void mul(const float *a, const float *b, float *r) {
+                const __m128 q = _mm_loadu_ps(b);
+
+                __m128 t0 = _mm_mul_ps(_mm_set1_ps(a[3]), q);
+                __m128 t1 = _mm_mul_ps(_mm_set1_ps(a[0]), flip(_mm_shuffle_ps(q, q, _MM_SHUFFLE(0, 1, 2, 3)), 0, 1, 0, 1));
+                __m128 t2 = _mm_mul_ps(_mm_set1_ps(a[1]), flip(_mm_shuffle_ps(q, q, _MM_SHUFFLE(1, 0, 3, 2)), 0, 0, 1, 1));
+                __m128 t3 = _mm_mul_ps(_mm_set1_ps(a[2]), flip(_mm_shuffle_ps(q, q, _MM_SHUFFLE(2, 3, 0, 1)), 1, 0, 0, 1));
+
+                _mm_storeu_ps(r, _mm_add_ps(_mm_add_ps(_mm_add_ps(t0, t1), t2), t3));
+            }
+        };
+#endif
+
+        // 4x4 inverse kernels, 16 contiguous values line by line. The inverse of the
+        // transpose is the transpose of the inverse, so the kernel works for both layouts
+        template<typename T>
+        struct inverse_kernel {
+            static const bool enabled = false;
+        };
+
+#ifdef LMEL_SSE2
+        template<>
+        struct inverse_kernel<float> {
+            static const bool enabled = true;
+
+            template<int X, int Y, int Z, int W>
+            static __m128 shuffle(__m128 a, __m128 b) {
+                return _mm_shuffle_ps(a, b, _MM_SHUFFLE(W, Z, Y, X));
+            }
+
+            template<int X, int Y, int Z, int W>
+            static __m128 swizzle(__m128 a) {
+                return _mm_shuffle_ps(a, a, _MM_SHUFFLE(W, Z, Y, X));
+            }
+
+            // Products of 2x2 matrices held as {m00, m01, m10, m11}: a * b, adj(a) * b and a * adj(b)
+            static __m128 mul(__m128 a, __m128 b) {
+                return _mm_add_ps(_mm_mul_ps(a, swizzle<0, 3, 0, 3>(b)),
+                                  _mm_mul_ps(swizzle<1, 0, 3, 2>(a), swizzle<2, 1, 2, 1>(b)));
+            }
+
+            static __m128 adj_mul(__m128 a, __m128 b) {
+                return _mm_sub_ps(_mm_mul_ps(swizzle<3, 3, 0, 0>(a), b),
+                                  _mm_mul_ps(swizzle<1, 1, 2, 2>(a), swizzle<2, 3, 0, 1>(b)));
+            }
+
+            static __m128 mul_adj(__m128 a, __m128 b) {
+                return _mm_sub_ps(_mm_mul_ps(a, swizzle<3, 0, 3, 0>(b)),
+                                  _mm_mul_ps(swizzle<1, 0, 3, 2>(a), swizzle<2, 1, 2, 1>(b)));
+            }
+
+            // Blockwise inverse of m = [A B; C D] with 2x2 blocks, from their adjugates and
+            // determinants. Returns false and leaves r unchanged when m is singular
+            static bool inverse(const float *m, float *r) {
+                const __m128 r0 = _mm_loadu_ps(m);
+                const __m128 r1 = _mm_loadu_ps(m + 4);
+                const __m128 r2 = _mm_loadu_ps(m + 8);
+                const __m128 r3 = _mm_loadu_ps(m + 12);
+
+                const __m128 a = _mm_movelh_ps(r0, r1);
+                const __m128 b = _mm_movehl_ps(r1, r0);
+                const __m128 c = _mm_movelh_ps(r2, r3);
+                const __m128 d = _mm_movehl_ps(r3, r2);
+
+                // {|A|, |B|, |C|, |D|}
+                const __m128 det_sub = _mm_sub_ps(_mm_mul_ps(shuffle<0, 2, 0, 2>(r0, r2), shuffle<1, 3, 1, 3>(r1, r3)),
+                                                  _mm_mul_ps(shuffle<1, 3, 1, 3>(r0, r2), shuffle<0, 2, 0, 2>(r1, r3)));
+
+                const __m128 det_a = swizzle<0, 0, 0, 0>(det_sub);
+                const __m128 det_b = swizzle<1, 1, 1, 1>(det_sub);
+                const __m128 det_c = swizzle<2, 2, 2, 2>(det_sub);
+                const __m128 det_d = swizzle<3, 3, 3, 3>(det_sub);
+
+                const __m128 d_c = adj_mul(d, c);
+                const __m128 a_b = adj_mul(a, b);
+
+                // Adjugates of the blocks of the inverse, times |m|
+                __m128 x = _mm_sub_ps(_mm_mul_ps(det_d, a), mul(b, d_c));
+                __m128 w = _mm_sub_ps(_mm_mul_ps(det_a, d), mul(c, a_b));
+                __m128 y = _mm_sub_ps(_mm_mul_ps(det_b, c), mul_adj(d, a_b));
+                __m128 z = _mm_sub_ps(_mm_mul_ps(det_c, b), mul_adj(a, d_c));
+
+                // |m| = |A| |D| + |B| |C| - tr(adj(A) B adj(D) C)
+                __m128 tr = _mm_mul_ps(a_b, swizzle<0, 2, 1, 3>(d_c));
+                tr = _mm_add_ps(tr, swizzle<1, 0, 3, 2>(tr));
+                tr = _mm_add_ps(tr, swizzle<2, 3, 0, 1>(tr));
+
+                const __m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), tr);
+                const float inv_det = 1 / _mm_cvtss_f32(det);
+
+                if (!(inv_det - inv_det == 0))
+                    return false;
+
+                const __m128 scale = _mm_mul_ps(_mm_set1_ps(inv_det), _mm_setr_ps(1, -1, -1, 1));
+
+                x = _mm_mul_ps(x, scale);
+                y = _mm_mul_ps(y, scale);
+                z = _mm_mul_ps(z, scale);
+                w = _mm_mul_ps(w, scale);
+
+                // Adjugate and store shuffles combined
+                _mm_storeu_ps(r, shuffle<3, 1, 3, 1>(x, y));
+                _mm_storeu_ps(r + 4, shuffle<2, 0, 2, 0>(x, y));
+                _mm_storeu_ps(r + 8, shuffle<3, 1, 3, 1>(z, w));
+                _mm_storeu_ps(r + 12, shuffle<2, 0, 2, 0>(z, w));
+
+                return true;
+            }
+        };
+#endif
+    }
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <math.h>
+#include "simd.h"
+#include "vector.h"
+#include "square_matrix.h"
+#include "dual_quaternion.h"
+#include "transform.h"
+#include "thread_pool.h"
+
+namespace lmel {
+    // Skinning reads packed streams: vertex i has K influences, influence k is bone
+    // bones[i * K + k] of the palette with weight weights[i * K + k]. Weights of a vertex
+    // should sum to 1. Large inputs are split into chunks on the pool like transform_points().
+    // The AVX2 float paths skin eight vertices at a time, gathering palette entries per lane.
+    // in and out may be the same array
+    namespace detail {
+        // Vertices [begin, end) by the weighted sum of palette matrices (affine, the last row is not read)
+        template<size_t K, typename T, typename S, typename L, typename I>
+        void skin_linear(const square_matrix<T, 4, S, L> *palette, const vector<T, 3> *in, const I *bones,
+                         const T *weights, vector<T, 3> *out, size_t begin, size_t end) {
+            size_t i = begin;
+
+#ifdef LMEL_AVX2
+            if constexpr (std::is_same<T, float>::value && sizeof(square_matrix<T, 4, S, L>) % sizeof(T) == 0 &&
+                          sizeof(vector<T, 3>) % sizeof(T) == 0) {
+                const float *const base = &palette[0](0, 0);
+                const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+                const __m256i stride = _mm256_set1_epi32(int(sizeof(square_matrix<T, 4, S, L>) / sizeof(T)));
+                const __m256i vertex = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(int(sizeof(vector<T, 3>) / sizeof(T))));
+                const __m256i influence = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(int(K)));
+
+                // Element offsets within a palette matrix, any storage and layout
+                __m256i offset[3][4];
+
+                for (size_t r = 0; r < 3; ++r)
+                    for (size_t c = 0; c < 4; ++c)
+                        offset[r][c] = _mm256_set1_epi32(int(&palette[0](r, c) - base));
+
+                auto gather = [&](const float *p, __m256i idx) {
+                    return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), p, idx, all, 4);
+                };
+
+                for (; i + 8 <= end; i += 8) {
+                    const float *const v = &in[i](0);
+                    const __m256 x = gather(v, vertex);
+                    const __m256 y = gather(v + 1, vertex);
+                    const __m256 z = gather(v + 2, vertex);
+                    __m256 acc[3] = {_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps()};
+
+                    for (size_t k = 0; k < K; ++k) {
+                        const I *const b = bones + i * K + k;
+                        const __m256i m = _mm256_mullo_epi32(
+                                _mm256_setr_epi32(int(b[0]), int(b[K]), int(b[2 * K]), int(b[3 * K]),
+                                                  int(b[4 * K]), int(b[5 * K]), int(b[6 * K]), int(b[7 * K])),
+                                stride);
+                        const __m256 w = gather(weights + i * K + k, influence);
+
+                        // Each influence transforms the point, the results are blended
+                        for (size_t r = 0; r < 3; ++r) {
+                            __m256 t = gather(base, _mm256_add_epi32(m, offset[r][3]));
+                            t = _mm256_add_ps(t, _mm256_mul_ps(gather(base, _mm256_add_epi32(m, offset[r][0])), x));
+                            t = _mm256_add_ps(t, _mm256_mul_ps(gather(base, _mm256_add_epi32(m, offset[r][1])), y));
+                            t = _mm256_add_ps(t, _mm256_mul_ps(gather(base, _mm256_add_epi32(m, offset[r][2])), z));
+
+                            acc[r] = _mm256_add_ps(acc[r], _mm256_mul_ps(w, t));
+                        }
+                    }
+
+                    alignas(32) float t[3][8];
+
+                    for (size_t r = 0; r < 3; ++r)
+                        _mm256_store_ps(t[r], acc[r]);
+
+                    for (size_t j = 0; j < 8; ++j) {
+                        out[i + j](0) = t[0][j];
+                        out[i + j](1) = t[1][j];
+                        out[i + j](2) = t[2][j];
+                    }
+                }
+            }
+#endif
+            for (; i < end; ++i) {
+                const T x = in[i](0), y = in[i](1), z = in[i](2);
+                T acc[3] = {0, 0, 0};
+
+                for (size_t k = 0; k < K; ++k) {
+                    const square_matrix<T, 4, S, L> &m = palette[bones[i * K + k]];
+                    const T w = weights[i * K + k];
+
+                    for (size_t r = 0; r < 3; ++r)
+                        acc[r] += w * (m(r, 3) + m(r, 0) * x + m(r, 1) * y + m(r, 2) * z);
+                }
+
+                out[i](0) = acc[0];
+                out[i](1) = acc[1];
+                out[i](2) = acc[2];
+            }
+        }
+
+        // Vertices [begin, end) by the normalized weighted sum of palette dual quaternions.
+        // Influences in the other hemisphere than the first one are negated before blending
+        template<size_t K, typename T, typename I>
+        void skin_dual_quaternion(const dual_quaternion<T> *palette, const vector<T, 3> *in, const I *bones,
+                                  const T *weights, vector<T, 3> *out, size_t begin, size_t end) {
+            size_t i = begin;
+
+#ifdef LMEL_AVX2
+            if constexpr (std::is_same<T, float>::value && sizeof(dual_quaternion<T>) % sizeof(T) == 0 &&
+                          sizeof(vector<T, 3>) % sizeof(T) == 0) {
+                const float *const base = &palette[0].real.x;
+                const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                const __m256 sign = _mm256_set1_ps(-0.0f);
+                const __m256 two = _mm256_set1_ps(2);
+                const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+                const __m256i stride = _mm256_set1_epi32(int(sizeof(dual_quaternion<T>) / sizeof(T)));
+                const __m256i vertex = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(int(sizeof(vector<T, 3>) / sizeof(T))));
+                const __m256i influence = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(int(K)));
+
+                const float *const element[8] = {
+                        &palette[0].real.x, &palette[0].real.y, &palette[0].real.z, &palette[0].real.w,
+                        &palette[0].dual.x, &palette[0].dual.y, &palette[0].dual.z, &palette[0].dual.w
+                };
+                __m256i offset[8];
+
+                for (size_t e = 0; e < 8; ++e)
+                    offset[e] = _mm256_set1_epi32(int(element[e] - base));
+
+                auto gather = [&](const float *p, __m256i idx) {
+                    return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), p, idx, all, 4);
+                };
+
+                for (; i + 8 <= end; i += 8) {
+                    // Blended real (r) and dual (d) parts, x, y, z, w each
+                    __m256 r[4], d[4], pivot[4];
+
+                    for (size_t e = 0; e < 4; ++e)
+                        r[e] = d[e] = pivot[e] = _mm256_setzero_ps();
+
+                    for (size_t k = 0; k < K; ++k) {
+                        const I *const b = bones + i * K + k;
+                        const __m256i m = _mm256_mullo_epi32(
+                                _mm256_setr_epi32(int(b[0]), int(b[K]), int(b[2 * K]), int(b[3 * K]),
+                                                  int(b[4 * K]), int(b[5 * K]), int(b[6 * K]), int(b[7 * K])),
+                                stride);
+                        __m256 w = gather(weights + i * K + k, influence);
+                        __m256 q[8];
+
+                        for (size_t e = 0; e < 8; ++e)
+                            q[e] = gather(base, _mm256_add_epi32(m, offset[e]));
+
+                        if (k == 0) {
+                            for (size_t e = 0; e < 4; ++e) {
+                                pivot[e] = q[e];
+                                r[e] = _mm256_mul_ps(w, q[e]);
+                                d[e] = _mm256_mul_ps(w, q[e + 4]);
+                            }
+
+                            continue;
+                        }
+
+                        // q and -q are the same transform, take the one closer to the first influence
+                        const __m256 dot = _mm256_add_ps(
+                                _mm256_add_ps(_mm256_mul_ps(q[0], pivot[0]), _mm256_mul_ps(q[1], pivot[1])),
+                                _mm256_add_ps(_mm256_mul_ps(q[2], pivot[2]), _mm256_mul_ps(q[3], pivot[3])));
+                        w = _mm256_xor_ps(w, _mm256_and_ps(dot, sign));
+
+                        for (size_t e = 0; e < 4; ++e) {
+                            r[e] = _mm256_add_ps(r[e], _mm256_mul_ps(w, q[e]));
+                            d[e] = _mm256_add_ps(d[e], _mm256_mul_ps(w, q[e + 4]));
+                        }
+                    }
+
+                    const __m256 sq = _mm256_add_ps(
+                            _mm256_add_ps(_mm256_mul_ps(r[0], r[0]), _mm256_mul_ps(r[1], r[1])),
+                            _mm256_add_ps(_mm256_mul_ps(r[2], r[2]), _mm256_mul_ps(r[3], r[3])));
+                    const __m256 inv = _mm256_div_ps(_mm256_set1_ps(1), _mm256_sqrt_ps(sq));
+
+                    for (size_t e = 0; e < 4; ++e) {
+                        r[e] = _mm256_mul_ps(r[e], inv);
+                        d[e] = _mm256_mul_ps(d[e], inv);
+                    }
+
+                    const float *const v = &in[i](0);
+                    const __m256 p[3] = {gather(v, vertex), gather(v + 1, vertex), gather(v + 2, vertex)};
+
+                    // Rotation as in quaternion::rotate(): t = 2 (r.xyz x p), p + r.w t + r.xyz x t
+                    __m256 t[3], o[3];
+
+                    for (size_t c = 0; c < 3; ++c) {
+                        const size_t c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+                        t[c] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(r[c1], p[c2]), _mm256_mul_ps(r[c2], p[c1])), two);
+                    }
+
+                    for (size_t c = 0; c < 3; ++c) {
+                        const size_t c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+
+                        // Translation 2 (r.w d.xyz - d.w r.xyz + r.xyz x d.xyz)
+                        const __m256 tr = _mm256_add_ps(
+                                _mm256_sub_ps(_mm256_mul_ps(r[3], d[c]), _mm256_mul_ps(d[3], r[c])),
+                                _mm256_sub_ps(_mm256_mul_ps(r[c1], d[c2]), _mm256_mul_ps(r[c2], d[c1])));
+
+                        o[c] = _mm256_add_ps(
+                                _mm256_add_ps(p[c], _mm256_mul_ps(r[3], t[c])),
+                                _mm256_sub_ps(_mm256_mul_ps(r[c1], t[c2]), _mm256_mul_ps(r[c2], t[c1])));
+                        o[c] = _mm256_add_ps(o[c], _mm256_mul_ps(tr, two));
+                    }
+
+                    alignas(32) float s[3][8];
+
+                    for (size_t c = 0; c < 3; ++c)
+                        _mm256_store_ps(s[c], o[c]);
+
+                    for (size_t j = 0; j < 8; ++j) {
+                        out[i + j](0) = s[0][j];
+                        out[i + j](1) = s[1][j];
+                        out[i + j](2) = s[2][j];
+                    }
+                }
+            }
+#endif
+            for (; i < end; ++i) {
+                const quaternion<T> &pivot = palette[bones[i * K]].real;
+                T r[4] = {0, 0, 0, 0}, d[4] = {0, 0, 0, 0};
+
+                for (size_t k = 0; k < K; ++k) {
+                    const dual_quaternion<T> &q = palette[bones[i * K + k]];
+                    T w = weights[i * K + k];
+
+                    if (q.real.x * pivot.x + q.real.y * pivot.y + q.real.z * pivot.z + q.real.w * pivot.w < 0)
+                        w = -w;
+
+                    r[0] += w * q.real.x;
+                    r[1] += w * q.real.y;
+                    r[2] += w * q.real.z;
+                    r[3] += w * q.real.w;
+                    d[0] += w * q.dual.x;
+                    d[1] += w * q.dual.y;
+                    d[2] += w * q.dual.z;
+                    d[3] += w * q.dual.w;
+                }
+
+                const T inv = 1 / sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+
+                for (size_t e = 0; e < 4; ++e) {
+                    r[e] *= inv;
+                    d[e] *= inv;
+                }
+
+                const T p[3] = {in[i](0), in[i](1), in[i](2)};
+                T t[3];
+
+                for (size_t c = 0; c < 3; ++c)
+                    t[c] = (r[(c + 1) % 3] * p[(c + 2) % 3] - r[(c + 2) % 3] * p[(c + 1) % 3]) * 2;
+
+                for (size_t c = 0; c < 3; ++c) {
+                    const size_t c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+                    const T tr = (r[3] * d[c] - d[3] * r[c]) + (r[c1] * d[c2] - r[c2] * d[c1]);
+
+                    out[i](c) = (p[c] + r[3] * t[c]) + (r[c1] * t[c2] - r[c2] * t[c1]) + tr * 2;
+                }
+            }
+        }
+    }
+
+    // Linear blend skinning of count vertices with a palette of 4x4 bone matrices
+    template<size_t K, typename T, typename S, typename L, typename I>
+    void skin_linear(const square_matrix<T, 4, S, L> *palette, const vector<T, 3> *in, const I *bones,
+                     const T *weights, vector<T, 3> *out, size_t count, thread_pool &pool = shared_thread_pool()) {
+        static_assert(K > 0 && std::is_integral<I>::value, "skinning needs integral bone indices");
+
+        detail::transform_split(count, pool, [&](size_t begin, size_t end) {
+            detail::skin_linear<K>(palette, in, bones, weights, out, begin, end);
+        });
+    }
+
+    // Dual quaternion skinning of count vertices with a palette of unit dual quaternions.
+    // Rotations blend without the volume loss of linear blending
+    template<size_t K, typename T, typename I>
+    void skin_dual_quaternion(const dual_quaternion<T> *palette, const vector<T, 3> *in, const I *bones,
+                              const T *weights, vector<T, 3> *out, size_t count,
+                              thread_pool &pool = shared_thread_pool()) {
+        static_assert(K > 0 && std::is_integral<I>::value, "skinning needs integral bone indices");
+
+        detail::transform_split(count, pool, [&](size_t begin, size_t end) {
+            detail::skin_dual_quaternion<K>(palette, in, bones, weights, out, begin, end);
+        });
+    }
+}
@@ -0,0 +1,528 @@
+#pragma once
+
+#include <type_traits>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include "simd.h"
+#include "aligned.h"
+#include "dynamic_vector.h"
+#include "dynamic_matrix.h"
+#include "dynamic_ref.h"
+#include "thread_pool.h"
+#include "counters.h"
+
+namespace lmel {
+    // Products over at least this many nonzeros are split into row ranges on the pool,
+    // every range holding about sparse_chunk nonzeros
+    static const size_t sparse_parallel_threshold = 1 << 16;
+    static const size_t sparse_chunk = 1 << 14;
+
+    template<typename T, typename>
+    class sparse_matrix;
+
+    // Collects (row, col, value) triplets in any order; duplicates are summed by build()
+    template<
+            typename T,
+            typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+    >
+    class sparse_builder {
+    public:
+        typedef T value_type;
+        typedef uint32_t index_type;
+
+        struct triplet {
+            index_type row;
+            index_type col;
+            T value;
+        };
+
+    private:
+        aligned_vector<triplet> entries;
+        size_t n_rows;
+        size_t n_cols;
+
+    public:
+        // Column indices are 32 bits wide, so cols must fit in index_type
+        explicit sparse_builder(size_t rows = 0, size_t cols = 0)
+                : n_rows(rows), n_cols(cols) {
+            assert(rows <= UINT32_MAX && cols <= UINT32_MAX);
+        }
+
+        void reserve(size_t count) {
+            entries.reserve(count);
+        }
+
+        void add(size_t row, size_t col, T value) {
+            assert(row < n_rows && col < n_cols);
+            entries.push_back({static_cast<index_type>(row), static_cast<index_type>(col), value});
+        }
+
+        size_t rows() const {
+            return n_rows;
+        }
+
+        size_t cols() const {
+            return n_cols;
+        }
+
+        // Number of added triplets, duplicates included
+        size_t size() const {
+            return entries.size();
+        }
+
+        const triplet *begin() const {
+            return entries.data();
+        }
+
+        const triplet *end() const {
+            return entries.data() + entries.size();
+        }
+
+        void clear() {
+            entries.clear();
+        }
+
+        sparse_matrix<T, T> build() const;
+    };
+
+    // Compressed sparse row matrix: nonzeros of every row are stored together, sorted by column.
+    // Storage is one value and one 32-bit column index per nonzero plus rows + 1 row offsets
+    template<
+            typename T,
+            typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+    >
+    class sparse_matrix {
+    public:
+        typedef T value_type;
+        typedef uint32_t index_type;
+
+    private:
+        aligned_vector<size_t> offsets;
+        aligned_vector<index_type> indices;
+        aligned_vector<T> data;
+        size_t n_cols;
+
+        friend class sparse_builder<T>;
+
+    public:
+        // Empty rows x cols matrix
+        explicit sparse_matrix(size_t rows = 0, size_t cols = 0)
+                : offsets(rows + 1, 0), n_cols(cols) {}
+
+        explicit sparse_matrix(const sparse_builder<T> &builder)
+                : sparse_matrix(builder.build()) {}
+
+        // Nonzero elements of a dense matrix
+        explicit sparse_matrix(const dynamic_matrix<T> &m)
+                : offsets(m.rows() + 1, 0), n_cols(m.cols()) {
+            for (size_t i = 0; i < m.rows(); ++i) {
+                for (size_t j = 0; j < m.cols(); ++j)
+                    if (m(i, j) != 0) {
+                        indices.push_back(static_cast<index_type>(j));
+                        data.push_back(m(i, j));
+                    }
+
+                offsets[i + 1] = data.size();
+            }
+        }
+
+        dynamic_matrix<T> to_dynamic_matrix() const {
+            dynamic_matrix<T> result(rows(), n_cols);
+
+            for (size_t i = 0; i < rows(); ++i)
+                for (size_t k = offsets[i]; k < offsets[i + 1]; ++k)
+                    result(i, indices[k]) = data[k];
+
+            return result;
+        }
+
+        size_t rows() const {
+            return offsets.size() - 1;
+        }
+
+        size_t cols() const {
+            return n_cols;
+        }
+
+        size_t nonzeros() const {
+            return data.size();
+        }
+
+        // CSR arrays: nonzeros of row i are [row_offsets()[i], row_offsets()[i + 1])
+        const size_t *row_offsets() const {
+            return offsets.data();
+        }
+
+        const index_type *col_indices() const {
+            return indices.data();
+        }
+
+        // Values may be changed in place, the sparsity pattern stays
+        T *values() {
+            return data.data();
+        }
+
+        const T *values() const {
+            return data.data();
+        }
+
+        // A^T, built in O(nonzeros + cols)
+        sparse_matrix get_transpose() const {
+            sparse_matrix result(n_cols, rows());
+
+            result.indices.resize(nonzeros());
+            result.data.resize(nonzeros());
+
+            for (index_type j : indices)
+                ++result.offsets[j + 1];
+
+            for (size_t j = 0; j < n_cols; ++j)
+                result.offsets[j + 1] += result.offsets[j];
+
+            aligned_vector<size_t> next(result.offsets.begin(), result.offsets.end() - 1);
+
+            for (size_t i = 0; i < rows(); ++i)
+                for (size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+                    const size_t pos = next[indices[k]]++;
+
+                    result.indices[pos] = static_cast<index_type>(i);
+                    result.data[pos] = data[k];
+                }
+
+            return result;
+        }
+
+        // Default math operations:
+
+        sparse_matrix operator*(T val) const {
+            sparse_matrix result = *this;
+            result *= val;
+            return result;
+        }
+
+        sparse_matrix &operator*=(T val) {
+            for (T &v : data)
+                v *= val;
+
+            return *this;
+        }
+
+        sparse_matrix &operator/=(T val) {
+            for (T &v : data)
+                v /= val;
+
+            return *this;
+        }
+
+        // Products on the shared pool, see multiply() for other pools:
+
+        dynamic_vector<T> operator*(const dynamic_vector_ref<const T> &vec) const;
+
+        dynamic_matrix<T> operator*(const dynamic_matrix<T> &val) const;
+
+        // Compare operations:
+
+        bool operator==(const sparse_matrix &m) const {
+            return n_cols == m.n_cols && offsets == m.offsets && indices == m.indices && data == m.data;
+        }
+
+        bool operator!=(const sparse_matrix &m) const {
+            return !(*this == m);
+        }
+
+        // get selected element, zero when it is not stored (binary search in the row)
+        T operator()(size_t row, size_t col) const {
+            assert(row < rows() && col < n_cols);
+
+            const index_type *first = indices.data() + offsets[row];
+            const index_type *last = indices.data() + offsets[row + 1];
+            const index_type *it = std::lower_bound(first, last, static_cast<index_type>(col));
+
+            return it != last && *it == col ? data[it - indices.data()] : T(0);
+        }
+    };
+
+    // Sort by row with a counting pass, then by column inside every row, and merge duplicates
+    template<typename T, typename E>
+    sparse_matrix<T, T> sparse_builder<T, E>::build() const {
+        sparse_matrix<T, T> result(n_rows, n_cols);
+
+        aligned_vector<size_t> &offsets = result.offsets;
+
+        for (const triplet &t : entries)
+            ++offsets[t.row + 1];
+
+        for (size_t i = 0; i < n_rows; ++i)
+            offsets[i + 1] += offsets[i];
+
+        aligned_vector<size_t> next(offsets.begin(), offsets.end() - 1);
+        aligned_vector<std::pair<index_type, T>> sorted(entries.size());
+
+        for (const triplet &t : entries)
+            sorted[next[t.row]++] = {t.col, t.value};
+
+        result.indices.reserve(entries.size());
+        result.data.reserve(entries.size());
+
+        size_t begin = 0;
+
+        for (size_t i = 0; i < n_rows; ++i) {
+            const size_t end = offsets[i + 1];
+
+            std::sort(sorted.begin() + begin, sorted.begin() + end,
+                      [](const std::pair<index_type, T> &a, const std::pair<index_type, T> &b) {
+                          return a.first < b.first;
+                      });
+
+            for (size_t k = begin; k < end; ++k) {
+                if (k > begin && sorted[k].first == sorted[k - 1].first)
+                    result.data.back() += sorted[k].second;
+                else {
+                    result.indices.push_back(sorted[k].first);
+                    result.data.push_back(sorted[k].second);
+                }
+            }
+
+            offsets[i + 1] = result.data.size();
+            begin = end;
+        }
+
+        return result;
+    }
+
+    namespace detail {
+        // Size of the CSR arrays, read once by every product
+        template<typename T>
+        size_t sparse_bytes(const sparse_matrix<T, T> &a) {
+            return a.nonzeros() * (sizeof(T) + sizeof(uint32_t)) + (a.rows() + 1) * sizeof(size_t);
+        }
+
+        // Sum of values[k] * x[indices[k]] for k in [0, count). The AVX2 path gathers
+        // four (double) or eight (float) elements of x at a time into separate partial sums.
+        // Gathers read indices as signed 32-bit offsets, so gather must be false when
+        // indices can exceed INT32_MAX
+        template<typename T>
+        T sparse_dot(const T *values, const uint32_t *indices, size_t count, const T *x, bool gather) {
+            size_t k = 0;
+            T sum = 0;
+
+#ifdef LMEL_AVX2
+            if constexpr (std::is_same<T, double>::value) {
+                if (gather && count >= 8) {
+                    // Masked form with a zero source: the plain gather reads an undefined register
+                    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+                    __m256d acc = _mm256_setzero_pd();
+
+                    for (; k + 4 <= count; k += 4) {
+                        const __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i *>(indices + k));
+                        const __m256d v = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, idx, all, 8);
+
+                        acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(values + k), v));
+                    }
+
+                    alignas(32) double p[4];
+                    _mm256_store_pd(p, acc);
+                    sum = (p[0] + p[1]) + (p[2] + p[3]);
+                }
+            } else if constexpr (std::is_same<T, float>::value) {
+                if (gather && count >= 16) {
+                    const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                    __m256 acc = _mm256_setzero_ps();
+
+                    for (; k + 8 <= count; k += 8) {
+                        const __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(indices + k));
+                        const __m256 v = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), x, idx, all, 4);
+
+                        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(values + k), v));
+                    }
+
+                    alignas(32) float p[8];
+                    _mm256_store_ps(p, acc);
+                    sum = ((p[0] + p[1]) + (p[2] + p[3])) + ((p[4] + p[5]) + (p[6] + p[7]));
+                }
+            }
+#endif
+            for (; k < count; ++k)
+                sum += values[k] * x[indices[k]];
+
+            return sum;
+        }
+
+        // Call f(begin, end) for row ranges holding about sparse_chunk nonzeros each
+        template<typename T, typename F>
+        void sparse_split(const sparse_matrix<T, T> &a, thread_pool &pool, F &&f) {
+            const size_t rows = a.rows();
+            const size_t nnz = a.nonzeros();
+
+            if (nnz < sparse_parallel_threshold || pool.size() == 0) {
+                f(size_t(0), rows);
+                return;
+            }
+
+            const size_t *offsets = a.row_offsets();
+            const size_t chunks = (nnz + sparse_chunk - 1) / sparse_chunk;
+
+            // First row of range t: the row holding nonzero t * nnz / chunks.
+            // Range 0 starts at row 0 so that leading empty rows are written too
+            auto first_row = [&](size_t t) -> size_t {
+                if (t == 0)
+                    return 0;
+
+                if (t == chunks)
+                    return rows;
+
+                return std::upper_bound(offsets, offsets + rows + 1, t * nnz / chunks) - offsets - 1;
+            };
+
+            pool.parallel_for(chunks, [&](size_t t) {
+                const size_t begin = first_row(t);
+                const size_t end = first_row(t + 1);
+
+                if (begin < end)
+                    f(begin, end);
+            });
+        }
+    }
+
+    // y = A * x; x and y must not overlap
+    template<typename T>
+    void multiply(const sparse_matrix<T, T> &a, const dynamic_vector_ref<const T> &x, dynamic_vector_ref<T> y,
+                  thread_pool &pool = shared_thread_pool()) {
+        assert(x.size() == a.cols() && y.size() == a.rows());
+
+        LMEL_COUNT(sparse, 2 * a.nonzeros(), detail::sparse_bytes(a) + (a.rows() + a.cols()) * sizeof(T), 0);
+
+        const size_t *offsets = a.row_offsets();
+        const uint32_t *indices = a.col_indices();
+        const T *values = a.values();
+        const bool gather = a.cols() <= INT32_MAX;
+
+        detail::sparse_split(a, pool, [&](size_t begin, size_t end) {
+            if (x.stride() == 1) {
+                for (size_t i = begin; i < end; ++i)
+                    y(i) = detail::sparse_dot(values + offsets[i], indices + offsets[i],
+                                              offsets[i + 1] - offsets[i], x.data(), gather);
+            } else {
+                for (size_t i = begin; i < end; ++i) {
+                    T sum = 0;
+
+                    for (size_t k = offsets[i]; k < offsets[i + 1]; ++k)
+                        sum += values[k] * x(indices[k]);
+
+                    y(i) = sum;
+                }
+            }
+        });
+    }
+
+    // y = A^T * x without forming A^T. Every row range scatters into its own buffer,
+    // buffers are summed column by column in range order
+    template<typename T>
+    void transpose_multiply(const sparse_matrix<T, T> &a, const dynamic_vector_ref<const T> &x,
+                            dynamic_vector_ref<T> y, thread_pool &pool = shared_thread_pool()) {
+        assert(x.size() == a.rows() && y.size() == a.cols());
+
+        LMEL_COUNT(sparse, 2 * a.nonzeros(), detail::sparse_bytes(a) + (a.rows() + a.cols()) * sizeof(T), 0);
+
+        const size_t *offsets = a.row_offsets();
+        const uint32_t *indices = a.col_indices();
+        const T *values = a.values();
+        const size_t rows = a.rows();
+        const size_t cols = a.cols();
+
+        auto scatter = [&](size_t begin, size_t end, T *out, ptrdiff_t step) {
+            for (size_t i = begin; i < end; ++i) {
+                const T v = x(i);
+
+                for (size_t k = offsets[i]; k < offsets[i + 1]; ++k)
+                    out[indices[k] * step] += values[k] * v;
+            }
+        };
+
+        const size_t ranges = a.nonzeros() < sparse_parallel_threshold ? 1 : pool.size() + 1;
+
+        if (ranges == 1) {
+            for (size_t j = 0; j < cols; ++j)
+                y(j) = 0;
+
+            scatter(0, rows, y.data(), y.stride());
+            return;
+        }
+
+        aligned_vector<T> partial(ranges * cols, 0);
+
+        pool.parallel_for(ranges, [&](size_t t) {
+            const size_t first = offsets[rows] * t / ranges;
+            const size_t last = offsets[rows] * (t + 1) / ranges;
+
+            const size_t begin = t == 0 ? 0 : std::upper_bound(offsets, offsets + rows + 1, first) - offsets - 1;
+            const size_t end = t + 1 == ranges ? rows : std::upper_bound(offsets, offsets + rows + 1, last) - offsets - 1;
+
+            if (begin < end)
+                scatter(begin, end, partial.data() + t * cols, 1);
+        });
+
+        pool.parallel_for((cols + sparse_chunk - 1) / sparse_chunk, [&](size_t c) {
+            const size_t end = std::min(cols, (c + 1) * sparse_chunk);
+
+            for (size_t j = c * sparse_chunk; j < end; ++j) {
+                T sum = 0;
+
+                for (size_t t = 0; t < ranges; ++t)
+                    sum += partial[t * cols + j];
+
+                y(j) = sum;
+            }
+        });
+    }
+
+    // A * B with dense B: every row of the result is a sum of scaled rows of B
+    template<typename T>
+    dynamic_matrix<T> multiply(const sparse_matrix<T, T> &a, const dynamic_matrix<T> &b,
+                               thread_pool &pool = shared_thread_pool()) {
+        assert(a.cols() == b.rows());
+
+        LMEL_COUNT(sparse, 2 * a.nonzeros() * b.cols(),
+                   detail::sparse_bytes(a) + (b.rows() + a.rows()) * b.cols() * sizeof(T), 1);
+
+        dynamic_matrix<T> result(a.rows(), b.cols());
+
+        const size_t *offsets = a.row_offsets();
+        const uint32_t *indices = a.col_indices();
+        const T *values = a.values();
+        const size_t k_cols = b.cols();
+
+        detail::sparse_split(a, pool, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                T *__restrict out = result.row_data(i);
+
+                for (size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+                    const T v = values[k];
+                    const T *__restrict in = b.row_data(indices[k]);
+
+                    for (size_t j = 0; j < k_cols; ++j)
+                        out[j] += v * in[j];
+                }
+            }
+        });
+
+        return result;
+    }
+
+    template<typename T, typename E>
+    dynamic_vector<T> sparse_matrix<T, E>::operator*(const dynamic_vector_ref<const T> &vec) const {
+        dynamic_vector<T> result(rows());
+        multiply(*this, vec, dynamic_vector_ref<T>(result));
+        return result;
+    }
+
+    template<typename T, typename E>
+    dynamic_matrix<T> sparse_matrix<T, E>::operator*(const dynamic_matrix<T> &val) const {
+        return multiply(*this, val);
+    }
+
+    using float_sparse_matrix = sparse_matrix<float>;
+    using double_sparse_matrix = sparse_matrix<double>;
+}
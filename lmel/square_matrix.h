@@ -4,59 +4,63 @@
 #include <cassert>
 #include "matrix.h"
 #include "vector.h"
+#include "gemm.h"
+#include "counters.h"
+#include "half.h"
 
 namespace lmel
 {
 	template <
 		typename T,
 		size_t N,
-		typename = typename std::enable_if<std::is_arithmetic<T>::value && N != 0, T>::type
+		typename Storage = packed_storage,
+		typename Layout = row_major,
+		typename = typename std::enable_if<is_element<T>::value && N != 0, T>::type
 		>
-	class square_matrix : public matrix<T, N, N>
+	class square_matrix : public matrix<T, N, N, Storage, Layout>
 	{
 	private:
-		typedef matrix<T, N, N> base;
+		typedef matrix<T, N, N, Storage, Layout> base;
 
 	public:
 		static const size_t rows = N;
 		static const size_t cols = N;
 
+		using base::lines;
+		using base::line_size;
+		using base::is_col_major;
+
+		// Square parts of a square matrix are square matrices
+		template <size_t R, size_t C>
+		using block_type = typename std::conditional<R == C,
+			square_matrix<T, R, Storage, Layout>,
+			matrix<T, R, C, Storage, Layout>>::type;
+
 		// Constructor with init value
-		explicit square_matrix(T init = 0)
+		constexpr explicit square_matrix(T init = 0)
 			: base(init)
 		{}
 
 		// Initializer list constructor
-		square_matrix(std::initializer_list<T> il)
+		constexpr square_matrix(std::initializer_list<T> il)
 			: base(il)
 		{}
 		
-		// Copy constructor
-		square_matrix(const square_matrix & ref)
-		{
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
-					this->data[i][j] = ref.data[i][j];
-		}
+		// Copy constructor, trivial
+		constexpr square_matrix(const square_matrix & ref) = default;
 
-		// Template copy constructor
-		template <typename O>
-		square_matrix(const square_matrix<O, N> & ref)
-		{
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
-					this->data[i][j] = ref(i, j);
-		}
+		// Template copy constructor (for other types, storage policies and layouts)
+		template <typename O, typename S, typename L>
+		constexpr square_matrix(const square_matrix<O, N, S, L> & ref)
+			: base(ref)
+		{}
 
 		// Constructor from matrix
-		square_matrix(const base & ref)
-		{
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
-					this->data[i][j] = ref(i, j);
-		}
+		constexpr square_matrix(const base & ref)
+			: base(ref)
+		{}
 
-		vector<T, N> get_diagonal() const
+		constexpr vector<T, N> get_diagonal() const
 		{
 			vector<T, N> result(0);
 
@@ -68,344 +72,423 @@ namespace lmel
 
 		// Default math operations:
 
-		square_matrix operator+(const square_matrix & val) const
+		constexpr square_matrix operator+(const square_matrix & val) const
 		{
+			LMEL_COUNT(matrix, N * N, 3 * N * N * sizeof(T), 1);
+
 			square_matrix result(0);
 
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
+			for (size_t i = 0; i < lines; ++i)
+				for (size_t j = 0; j < line_size; ++j)
 					result.data[i][j] = this->data[i][j] + val.data[i][j];
 
 			return result;
 		}
 
-		square_matrix operator-(const square_matrix & val) const
+		constexpr square_matrix operator-(const square_matrix & val) const
 		{
+			LMEL_COUNT(matrix, N * N, 3 * N * N * sizeof(T), 1);
+
 			square_matrix result(0);
 
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
+			for (size_t i = 0; i < lines; ++i)
+				for (size_t j = 0; j < line_size; ++j)
 					result.data[i][j] = this->data[i][j] - val.data[i][j];
 
 			return result;
 		}
 
-		square_matrix operator*(const square_matrix & val) const
+		constexpr square_matrix operator*(const square_matrix & val) const
 		{
 			square_matrix result(0);
 
-			for (size_t i = 0; i < rows; ++i)
+			if constexpr (N * N * N >= gemm_threshold && std::is_arithmetic<T>::value)
+				if (!LMEL_CONSTANT_EVALUATED())
+				{
+					gemm(N, N, N,
+						 &this->data[0][0], base::row_step, base::col_step,
+						 &val.data[0][0], base::row_step, base::col_step,
+						 &result.data[0][0], base::row_step, base::col_step);
+					return result;
+				}
+
+			LMEL_COUNT(matrix_product, 2 * N * N * N, 3 * N * N * sizeof(T), 1);
+
+			// Innermost loop walks along contiguous lines of the result and one operand:
+			// k before j for row_major, k before i for col_major. 16-bit scalars instead
+			// sum each element in float and round it once
+			if constexpr (is_storage_scalar<T>::value)
+			{
+				for (size_t i = 0; i < rows; ++i)
+					for (size_t j = 0; j < cols; ++j)
+					{
+						float sum = 0;
+
+						for (size_t k = 0; k < rows; ++k)
+							sum += (*this)(i, k) * val(k, j);
+
+						result(i, j) = sum;
+					}
+			}
+			else if constexpr (is_col_major)
+			{
 				for (size_t j = 0; j < cols; ++j)
 					for (size_t k = 0; k < rows; ++k)
-						result.data[i][j] += this->data[i][k] * val.data[k][j];
+						for (size_t i = 0; i < rows; ++i)
+							result.data[j][i] += this->data[k][i] * val.data[j][k];
+			}
+			else
+			{
+				for (size_t i = 0; i < rows; ++i)
+					for (size_t k = 0; k < rows; ++k)
+						for (size_t j = 0; j < cols; ++j)
+							result.data[i][j] += this->data[i][k] * val.data[k][j];
+			}
 
 			return result;
 		}
 
-		square_matrix & operator+=(const square_matrix & val)
+		constexpr square_matrix & operator+=(const square_matrix & val)
 		{
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
+			LMEL_COUNT(matrix, N * N, 3 * N * N * sizeof(T), 0);
+
+			for (size_t i = 0; i < lines; ++i)
+				for (size_t j = 0; j < line_size; ++j)
 					this->data[i][j] += val.data[i][j];
 
 			return *this;
 		}
 
-		square_matrix & operator-=(const square_matrix & val)
+		constexpr square_matrix & operator-=(const square_matrix & val)
 		{
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
+			LMEL_COUNT(matrix, N * N, 3 * N * N * sizeof(T), 0);
+
+			for (size_t i = 0; i < lines; ++i)
+				for (size_t j = 0; j < line_size; ++j)
 					this->data[i][j] -= val.data[i][j];
 
 			return *this;
 		}
 
-		square_matrix & operator*=(const square_matrix & val)
+		constexpr square_matrix & operator*=(const square_matrix & val)
 		{
-			square_matrix result(0);
-
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
-					for (size_t k = 0; k < rows; ++k)
-						result.data[i][j] += this->data[i][k] * val.data[k][j];
-
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
-					this->data[i][j] = result.data[i][j];
+			*this = *this * val;
 
 			return *this;
 		}
 
-		square_matrix operator+(T val) const
+		constexpr square_matrix operator+(T val) const
 		{
+			LMEL_COUNT(matrix, N * N, 2 * N * N * sizeof(T), 1);
+
 			square_matrix result(0);
 
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
+			for (size_t i = 0; i < lines; ++i)
+				for (size_t j = 0; j < line_size; ++j)
 					result.data[i][j] = this->data[i][j] + val;
 
 			return result;
 		}
 
-		square_matrix operator-(T val) const
+		constexpr square_matrix operator-(T val) const
 		{
+			LMEL_COUNT(matrix, N * N, 2 * N * N * sizeof(T), 1);
+
 			square_matrix result(0);
 
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
+			for (size_t i = 0; i < lines; ++i)
+				for (size_t j = 0; j < line_size; ++j)
 					result.data[i][j] = this->data[i][j] - val;
 
 			return result;
 		}
 
-		square_matrix operator*(T val) const
+		constexpr square_matrix operator*(T val) const
 		{
+			LMEL_COUNT(matrix, N * N, 2 * N * N * sizeof(T), 1);
+
 			square_matrix result(0);
 
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
+			for (size_t i = 0; i < lines; ++i)
+				for (size_t j = 0; j < line_size; ++j)
 					result.data[i][j] = this->data[i][j] * val;
 
 			return result;
 		}
 
-		square_matrix operator/(T val) const
+		constexpr square_matrix operator/(T val) const
 		{
+			LMEL_COUNT(matrix, N * N, 2 * N * N * sizeof(T), 1);
+
 			square_matrix result(0);
 
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
+			for (size_t i = 0; i < lines; ++i)
+				for (size_t j = 0; j < line_size; ++j)
 					result.data[i][j] = this->data[i][j] / val;
 
 			return result;
 		}
 
-		square_matrix & operator+=(T val)
+		constexpr square_matrix & operator+=(T val)
 		{
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
+			LMEL_COUNT(matrix, N * N, 2 * N * N * sizeof(T), 0);
+
+			for (size_t i = 0; i < lines; ++i)
+				for (size_t j = 0; j < line_size; ++j)
 					this->data[i][j] += val;
 
 			return *this;
 		}
 
-		square_matrix & operator-=(T val)
+		constexpr square_matrix & operator-=(T val)
 		{
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
+			LMEL_COUNT(matrix, N * N, 2 * N * N * sizeof(T), 0);
+
+			for (size_t i = 0; i < lines; ++i)
+				for (size_t j = 0; j < line_size; ++j)
 					this->data[i][j] -= val;
 
 			return *this;
 		}
 
-		square_matrix & operator*=(T val)
+		constexpr square_matrix & operator*=(T val)
 		{
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
+			LMEL_COUNT(matrix, N * N, 2 * N * N * sizeof(T), 0);
+
+			for (size_t i = 0; i < lines; ++i)
+				for (size_t j = 0; j < line_size; ++j)
 					this->data[i][j] *= val;
 
 			return *this;
 		}
 
-		square_matrix & operator/=(T val)
+		constexpr square_matrix & operator/=(T val)
 		{
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
+			LMEL_COUNT(matrix, N * N, 2 * N * N * sizeof(T), 0);
+
+			for (size_t i = 0; i < lines; ++i)
+				for (size_t j = 0; j < line_size; ++j)
 					this->data[i][j] /= val;
 
 			return *this;
 		}
 
 		// vector product:
-		vector<T, N> operator*(const vector<T, N> & vec) const
+		template <typename S>
+		constexpr vector<T, N, S> operator*(const vector<T, N, S> & vec) const
 		{
-			vector<T, N> result(0);
-
-			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
-					result(i) += this->data[i][j] * vec(j);
-
-			return result;
+			return base::operator*(vec);
 		}
 
-		square_matrix<T, N - 1> minor(const size_t row, const size_t col) const
+		// R x C block with top left element (i, j), see matrix::block()
+		template <size_t R, size_t C>
+		constexpr block_view<R, C, square_matrix> block(size_t i, size_t j)
 		{
-			assert(row < rows && col < cols);
-
-			square_matrix<T, N - 1> result(0);
-
-			for (size_t i = 0, x = 0; i < rows; ++i)
-			{
-				if (i == row)
-					continue;
+			return block_view<R, C, square_matrix>(*this, i, j);
+		}
 
-				for (size_t j = 0, y = 0; j < cols; ++j)
-				{
-					if (j == col)
-						continue;
+		template <size_t R, size_t C>
+		constexpr block_view<R, C, const square_matrix> block(size_t i, size_t j) const
+		{
+			return block_view<R, C, const square_matrix>(*this, i, j);
+		}
 
-					result(x, y++) = this->data[i][j];
-				}
+		// View of the elements outside given row and column, no copy is made
+		constexpr sub_view<square_matrix, N - 1, N - 1, true> minor_view(size_t row, size_t col)
+		{
+			return sub_view<square_matrix, N - 1, N - 1, true>(*this, row, col);
+		}
 
-				++x;
-			}
+		constexpr sub_view<const square_matrix, N - 1, N - 1, true> minor_view(size_t row, size_t col) const
+		{
+			return sub_view<const square_matrix, N - 1, N - 1, true>(*this, row, col);
+		}
 
-			return result;
+		constexpr square_matrix<T, N - 1, Storage, Layout> minor(const size_t row, const size_t col) const
+		{
+			return minor_view(row, col);
 		}
 
-		void transpose()
+		// In place, swaps the elements above the diagonal with those below
+		constexpr void transpose()
 		{
-			square_matrix tmp = *this;
+			LMEL_COUNT(transpose, 0, 2 * N * N * sizeof(T), 0);
 
 			for (size_t i = 0; i < rows; ++i)
-				for (size_t j = 0; j < cols; ++j)
-					this->data[i][j] = tmp.data[j][i];
+				for (size_t j = i + 1; j < cols; ++j)
+				{
+					T tmp = this->data[i][j];
+					this->data[i][j] = this->data[j][i];
+					this->data[j][i] = tmp;
+				}
 		}
 
 		template <typename K, size_t L>
-		friend K determinant(const square_matrix<K, L> & m);
-
-		template <typename K>
-		friend K determinant(const square_matrix<K, 2> & m);
+		friend constexpr square_matrix<K, L> make_id_matrix();
 
 		template <typename K, size_t L>
-		friend square_matrix<K, L> make_id_matrix();
+		friend constexpr square_matrix<K, L> make_square_matrix_from_rows(std::initializer_list<vector<K, L>> il);
 
 		template <typename K, size_t L>
-		friend square_matrix<K, L> make_square_matrix_from_rows(std::initializer_list<vector<K, L>> il);
-
-		template <typename K, size_t L>
-		friend square_matrix<K, L> make_square_matrix_from_cols(std::initializer_list<vector<K, L>> il);
+		friend constexpr square_matrix<K, L> make_square_matrix_from_cols(std::initializer_list<vector<K, L>> il);
 	};
 
 	// 1x1 matrix specialization
-	template <typename T>
-	class square_matrix<T, 1> : public matrix<T, 1, 1>
+	template <typename T, typename Storage, typename Layout>
+	class square_matrix<T, 1, Storage, Layout> : public matrix<T, 1, 1, Storage, Layout>
 	{
 	private:
-		typedef matrix<T, 1, 1> base;
+		typedef matrix<T, 1, 1, Storage, Layout> base;
 
 	public:
 		static const size_t rows = 1;
 		static const size_t cols = 1;
 
 		// Constructor with init value
-		explicit square_matrix(T init = 0)
+		constexpr explicit square_matrix(T init = 0)
 			: base(init)
 		{}
 
 		// Initializer list constructor
-		square_matrix(std::initializer_list<T> il)
+		constexpr square_matrix(std::initializer_list<T> il)
 			: base(il)
 		{}
 
-		// Copy constructor
-		square_matrix(const square_matrix & ref)
-		{
-			this->data[0][0] = ref.data[0][0];
-		}
+		// Copy constructor, trivial
+		constexpr square_matrix(const square_matrix & ref) = default;
 
-		// Template copy constructor (for other types)
-		template <typename O>
-		square_matrix(const square_matrix<O, 1> & ref)
+		// Template copy constructor (for other types, storage policies and layouts)
+		template <typename O, typename S, typename L>
+		constexpr square_matrix(const square_matrix<O, 1, S, L> & ref)
 		{
 			this->data[0][0] = ref(0, 0);
 		}
 
 		// Constructor from matrix
-		square_matrix(const base & ref)
+		constexpr square_matrix(const base & ref)
 		{
 			this->data[0][0] = ref(0, 0);
 		}
 
-		vector<T, 1> get_diagonal() const
+		constexpr vector<T, 1> get_diagonal() const
 		{
 			return vector<T, 1>(this->data[0][0]);
 		}
 
 		// Default math operations:
 
-		square_matrix operator+(const square_matrix & val) const
+		constexpr square_matrix operator+(const square_matrix & val) const
 		{
+			LMEL_COUNT(matrix, 1, 3 * sizeof(T), 1);
+
 			return square_matrix(this->data[0][0] + val.data[0][0]);
 		}
 
-		square_matrix operator-(const square_matrix & val) const
+		constexpr square_matrix operator-(const square_matrix & val) const
 		{
+			LMEL_COUNT(matrix, 1, 3 * sizeof(T), 1);
+
 			return square_matrix(this->data[0][0] - val.data[0][0]);
 		}
 
-		square_matrix operator*(const square_matrix & val) const
+		constexpr square_matrix operator*(const square_matrix & val) const
 		{
+			LMEL_COUNT(matrix_product, 1, 3 * sizeof(T), 1);
+
 			return square_matrix(this->data[0][0] * val.data[0][0]);
 		}
 
-		square_matrix & operator+=(const square_matrix & val)
+		constexpr square_matrix & operator+=(const square_matrix & val)
 		{
+			LMEL_COUNT(matrix, 1, 3 * sizeof(T), 0);
+
 			this->data[0][0] += val.data[0][0];
 			return *this;
 		}
 
-		square_matrix & operator-=(const square_matrix & val)
+		constexpr square_matrix & operator-=(const square_matrix & val)
 		{
+			LMEL_COUNT(matrix, 1, 3 * sizeof(T), 0);
+
 			this->data[0][0] -= val.data[0][0];
 			return *this;
 		}
 
-		square_matrix & operator*=(const square_matrix & val)
+		constexpr square_matrix & operator*=(const square_matrix & val)
 		{
+			LMEL_COUNT(matrix_product, 1, 3 * sizeof(T), 0);
+
 			this->data[0][0] *= val.data[0][0];
 			return *this;
 		}
 
-		square_matrix operator+(T val) const
+		constexpr square_matrix operator+(T val) const
 		{
+			LMEL_COUNT(matrix, 1, 2 * sizeof(T), 1);
+
 			return square_matrix(this->data[0][0] + val);
 		}
 
-		square_matrix operator-(T val) const
+		constexpr square_matrix operator-(T val) const
 		{
+			LMEL_COUNT(matrix, 1, 2 * sizeof(T), 1);
+
 			return square_matrix(this->data[0][0] - val);
 		}
 
-		square_matrix operator*(T val) const
+		constexpr square_matrix operator*(T val) const
 		{
+			LMEL_COUNT(matrix, 1, 2 * sizeof(T), 1);
+
 			return square_matrix(this->data[0][0] * val);
 		}
 
-		square_matrix operator/(T val) const
+		constexpr square_matrix operator/(T val) const
 		{
+			LMEL_COUNT(matrix, 1, 2 * sizeof(T), 1);
+
 			return square_matrix(this->data[0][0] / val);
 		}
 
-		square_matrix & operator+=(T val)
+		constexpr square_matrix & operator+=(T val)
 		{
+			LMEL_COUNT(matrix, 1, 2 * sizeof(T), 0);
+
 			this->data[0][0] += val;
 			return *this;
 		}
 
-		square_matrix & operator-=(T val)
+		constexpr square_matrix & operator-=(T val)
 		{
+			LMEL_COUNT(matrix, 1, 2 * sizeof(T), 0);
+
 			this->data[0][0] -= val;
 			return *this;
 		}
 
-		square_matrix & operator*=(T val)
+		constexpr square_matrix & operator*=(T val)
 		{
+			LMEL_COUNT(matrix, 1, 2 * sizeof(T), 0);
+
 			this->data[0][0] *= val;
 			return *this;
 		}
 
-		square_matrix & operator/=(T val)
+		constexpr square_matrix & operator/=(T val)
 		{
+			LMEL_COUNT(matrix, 1, 2 * sizeof(T), 0);
+
 			this->data[0][0] /= val;
 			return *this;
 		}
 
 		// vector product:
-		vector<T, 1> operator*(const vector<T, 1> & vec) const
+		template <typename S>
+		constexpr vector<T, 1, S> operator*(const vector<T, 1, S> & vec) const
 		{
-			return vector<T, 1>(this->data[0][0] * vec(0));
+			LMEL_COUNT(matrix_vector, 1, 3 * sizeof(T), 1);
+
+			return vector<T, 1, S>(this->data[0][0] * vec(0));
 		}
 
 		square_matrix minor(const size_t row, const size_t col) const
@@ -415,19 +498,16 @@ namespace lmel
 			return square_matrix(0);
 		}
 
-		void transpose() {}
-
-		template <typename K>
-		friend K determinant(const square_matrix<K, 1> & m);
+		constexpr void transpose() {}
 
 		template <typename K, size_t L>
-		friend square_matrix<K, L> make_id_matrix();
+		friend constexpr square_matrix<K, L> make_id_matrix();
 
 		template <typename K, size_t L>
-		friend square_matrix<K, L> make_square_matrix_from_rows(std::initializer_list<vector<K, L>> il);
+		friend constexpr square_matrix<K, L> make_square_matrix_from_rows(std::initializer_list<vector<K, L>> il);
 
 		template <typename K, size_t L>
-		friend square_matrix<K, L> make_square_matrix_from_cols(std::initializer_list<vector<K, L>> il);
+		friend constexpr square_matrix<K, L> make_square_matrix_from_cols(std::initializer_list<vector<K, L>> il);
 	};
 
 	template <typename T>
@@ -470,7 +550,7 @@ namespace lmel
 	using float_matrix5d = square_matrix<float, 5>;
 
 	template <typename T, size_t N>
-	square_matrix<T, N> make_id_matrix()
+	constexpr square_matrix<T, N> make_id_matrix()
 	{
 		square_matrix<T, N> result(0);
 
@@ -481,7 +561,7 @@ namespace lmel
 	}
 
     template <typename T, size_t N>
-	square_matrix<T, N> make_square_matrix_from_rows(std::initializer_list<vector<T, N>> il)
+	constexpr square_matrix<T, N> make_square_matrix_from_rows(std::initializer_list<vector<T, N>> il)
 	{
 		assert(il.size() == N);
 
@@ -502,7 +582,7 @@ namespace lmel
 	}
 
 	template <typename T, size_t N>
-	square_matrix<T, N> make_square_matrix_from_cols(std::initializer_list<vector<T, N>> il)
+	constexpr square_matrix<T, N> make_square_matrix_from_cols(std::initializer_list<vector<T, N>> il)
 	{
 		assert(il.size() == N);
 
@@ -521,4 +601,7 @@ namespace lmel
 
 		return result;
 	}
+
+	static_assert(std::is_trivially_copyable<float_matrix4d>::value && std::is_standard_layout<float_matrix4d>::value &&
+		std::is_trivially_copyable<double_matrix1d>::value, "square_matrix must be trivially copyable");
 }
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+namespace lmel {
+    // Storage policy for the elements of vector and matrix.
+    // Alignment is the alignment of the element array in bytes, 0 keeps the natural one.
+    // With Pad the size of a vector, or the row length of a matrix, is rounded up to
+    // whole groups of 4 lanes (3 becomes 4), so rows can be loaded with full-width
+    // SIMD instructions. Padding lanes are always zero
+    template<size_t Alignment = 0, bool Pad = false>
+    struct storage {
+        static_assert((Alignment & (Alignment - 1)) == 0, "alignment must be a power of two");
+
+        // alignas(0) is ignored but warned about, alignas(1) never weakens alignas(T)
+        static const size_t alignment = Alignment ? Alignment : 1;
+
+        static constexpr size_t padded_size(size_t n) {
+            return Pad && n > 2 ? (n + 3) / 4 * 4 : n;
+        }
+    };
+
+    // Natural alignment without padding, the default layout
+    using packed_storage = storage<>;
+
+    // Matrix layouts: elements of a row (row_major, the default) or of a column
+    // (col_major) are contiguous
+    struct row_major {};
+    struct col_major {};
+}
@@ -0,0 +1,464 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <algorithm>
+#include <type_traits>
+#include "vector.h"
+#include "matrix.h"
+#include "quaternion.h"
+#include "vector_batch.h"
+#include "thread_pool.h"
+#include "half.h"
+
+namespace lmel {
+    // Text input and output of arrays of scalars, vectors, matrices and quaternions.
+    // Text is a sequence of numbers separated by whitespace, commas or semicolons, # starts
+    // a comment up to the end of the line. Line breaks carry no meaning: every N numbers make
+    // a vector of N, every N * M numbers a matrix in row order. Numbers are read with
+    // std::from_chars and written with std::to_chars in the shortest form that reads back
+    // to the same value; 16-bit scalars go through float
+
+    // Bytes read from a stream at a time, and bytes of text per parallel task
+    static const size_t text_block = 1 << 24;
+    static const size_t text_chunk = 1 << 18;
+
+    namespace detail {
+        // Numbers per element, k-th number of an element and numbers per written line.
+        // Vectors are detected by storage_size, matrices by row_step; other types are scalars
+        template<typename E, typename = void, typename = void>
+        struct text_element {
+            typedef E scalar;
+
+            static const size_t size = 1;
+            static const size_t line = 1;
+
+            static scalar get(const E &e, size_t) {
+                return e;
+            }
+
+            template<typename V>
+            static void set(E &e, size_t, V v) {
+                e = scalar(v);
+            }
+        };
+
+        template<typename E>
+        struct text_element<E, std::void_t<decltype(E::storage_size)>, void> {
+            typedef typename E::value_type scalar;
+
+            static const size_t size = E::size;
+            static const size_t line = E::size;
+
+            static scalar get(const E &e, size_t k) {
+                return e(k);
+            }
+
+            template<typename V>
+            static void set(E &e, size_t k, V v) {
+                e(k) = scalar(v);
+            }
+        };
+
+        template<typename E>
+        struct text_element<E, void, std::void_t<decltype(E::row_step)>> {
+            typedef typename E::value_type scalar;
+
+            static const size_t size = E::rows * E::cols;
+            static const size_t line = E::cols;
+
+            static scalar get(const E &e, size_t k) {
+                return e(k / E::cols, k % E::cols);
+            }
+
+            template<typename V>
+            static void set(E &e, size_t k, V v) {
+                e(k / E::cols, k % E::cols) = scalar(v);
+            }
+        };
+
+        template<typename T>
+        struct text_element<quaternion<T>, void, void> {
+            typedef T scalar;
+
+            static const size_t size = 4;
+            static const size_t line = 4;
+
+            static scalar get(const quaternion<T> &q, size_t k) {
+                return k == 0 ? q.x : k == 1 ? q.y : k == 2 ? q.z : q.w;
+            }
+
+            template<typename V>
+            static void set(quaternion<T> &q, size_t k, V v) {
+                (k == 0 ? q.x : k == 1 ? q.y : k == 2 ? q.z : q.w) = T(v);
+            }
+        };
+
+        // Type numbers are parsed and formatted in
+        template<typename S>
+        using text_scalar = typename std::conditional<is_storage_scalar<S>::value, float, S>::type;
+
+        // Upper bound of the characters of one number and its separator
+        static const size_t text_number_size = 32;
+
+        // Character classes: 0 for characters of numbers, 1 for separators, 2 for # (comment)
+        struct text_class_table {
+            unsigned char classes[256];
+
+            constexpr text_class_table()
+                    : classes{} {
+                for (char c : {' ', '\n', ',', '\t', '\r', ';', '\v', '\f'})
+                    classes[(unsigned char) c] = 1;
+
+                classes[(unsigned char) '#'] = 2;
+            }
+
+            constexpr unsigned char operator()(char c) const {
+                return classes[(unsigned char) c];
+            }
+        };
+
+        static constexpr text_class_table text_class {};
+
+        // Call f(begin, end) for every number in [p, end), stops with false when f returns false
+        template<typename F>
+        bool text_numbers(const char *p, const char *end, F &&f) {
+            while (p != end) {
+                const unsigned char c = text_class(*p);
+
+                if (c == 1) {
+                    ++p;
+                } else if (c == 2) {
+                    p = static_cast<const char *>(memchr(p, '\n', size_t(end - p)));
+
+                    if (!p)
+                        return true;
+                } else {
+                    const char *begin = p;
+
+                    while (++p != end && text_class(*p) == 0);
+
+                    if (!f(begin, p))
+                        return false;
+                }
+            }
+
+            return true;
+        }
+
+        // The whole of [p, end) must be the number; from_chars does not take a plus sign
+        template<typename S>
+        bool text_parse(const char *p, const char *end, S &value) {
+            if (end - p > 1 && *p == '+' && p[1] != '-')
+                ++p;
+
+            const std::from_chars_result r = std::from_chars(p, end, value);
+
+            return r.ec == std::errc() && r.ptr == end;
+        }
+
+        template<typename S>
+        char *text_format(char *p, S value) {
+            return std::to_chars(p, p + text_number_size, text_scalar<S>(value)).ptr;
+        }
+
+        // Split [begin, end) into pieces of about text_chunk bytes, each ending after a line break
+        inline std::vector<const char *> text_chunks(const char *begin, const char *end) {
+            std::vector<const char *> bounds{begin};
+
+            while (size_t(end - bounds.back()) > text_chunk) {
+                const char *p = bounds.back() + text_chunk;
+                const char *line = static_cast<const char *>(memchr(p, '\n', size_t(end - p)));
+
+                if (!line)
+                    break;
+
+                bounds.push_back(line + 1);
+            }
+
+            if (bounds.back() != end)
+                bounds.push_back(end);
+
+            return bounds;
+        }
+
+        // f(t) for t in [0, count), on the pool when there is more than one
+        template<typename F>
+        void text_for(size_t count, thread_pool &pool, F &&f) {
+            if (count < 2 || pool.size() == 0) {
+                for (size_t t = 0; t < count; ++t)
+                    f(t);
+            } else
+                pool.parallel_for(count, f);
+        }
+
+        // Arrays of elements and batches as parser outputs
+        template<typename Out>
+        struct text_target;
+
+        template<typename E, typename A>
+        struct text_target<std::vector<E, A>> {
+            typedef text_element<E> element;
+            typedef typename element::scalar scalar;
+
+            static const size_t size = element::size;
+
+            static void resize(std::vector<E, A> &out, size_t count) {
+                out.resize(count);
+            }
+
+            template<typename V>
+            static void set(std::vector<E, A> &out, size_t index, V v) {
+                element::set(out[index / size], index % size, v);
+            }
+        };
+
+        template<typename T, size_t N>
+        struct text_target<vector_batch<T, N>> {
+            typedef T scalar;
+
+            static const size_t size = N;
+
+            static void resize(vector_batch<T, N> &out, size_t count) {
+                out.resize(count);
+            }
+
+            template<typename V>
+            static void set(vector_batch<T, N> &out, size_t index, V v) {
+                out.component(index % N)[index / N] = T(v);
+            }
+        };
+
+        // Parses text blocks into out. Numbers are counted across blocks, so elements may
+        // span blocks, chunks and lines
+        template<typename Out>
+        class text_parser {
+        private:
+            typedef text_target<Out> target;
+            typedef text_scalar<typename target::scalar> scalar;
+
+            Out &out;
+            thread_pool &pool;
+            size_t numbers = 0;
+
+        public:
+            text_parser(Out &out, thread_pool &pool)
+                    : out(out), pool(pool) {
+                target::resize(out, 0);
+            }
+
+            // Chunks are parsed into their own arrays first, then copied to their place in out
+            bool parse(const char *begin, const char *end) {
+                const std::vector<const char *> bounds = text_chunks(begin, end);
+                const size_t chunks = bounds.size() - 1;
+                std::vector<std::vector<scalar>> values(chunks);
+                std::vector<char> ok(chunks, 0);
+
+                text_for(chunks, pool, [&](size_t t) {
+                    std::vector<scalar> &v = values[t];
+                    v.reserve(size_t(bounds[t + 1] - bounds[t]) / 4);
+
+                    ok[t] = text_numbers(bounds[t], bounds[t + 1], [&v](const char *p, const char *e) {
+                        scalar value;
+
+                        if (!text_parse(p, e, value))
+                            return false;
+
+                        v.push_back(value);
+                        return true;
+                    });
+                });
+
+                std::vector<size_t> first(chunks + 1, numbers);
+
+                for (size_t t = 0; t < chunks; ++t)
+                    first[t + 1] = first[t] + values[t].size();
+
+                numbers = first[chunks];
+                target::resize(out, (numbers + target::size - 1) / target::size);
+
+                text_for(chunks, pool, [&](size_t t) {
+                    size_t index = first[t];
+
+                    for (scalar value : values[t])
+                        target::set(out, index++, value);
+                });
+
+                return std::all_of(ok.begin(), ok.end(), [](char c) { return c != 0; });
+            }
+
+            // An incomplete last element is dropped and reported
+            bool finish() {
+                target::resize(out, numbers / target::size);
+
+                return numbers % target::size == 0;
+            }
+        };
+
+        template<typename Out>
+        bool parse_text(const char *begin, const char *end, Out &out, thread_pool &pool) {
+            text_parser<Out> parser(out, pool);
+
+            const bool ok = parser.parse(begin, end);
+
+            return parser.finish() && ok;
+        }
+
+        // Reads block bytes at a time and parses up to the last line break,
+        // the rest of the line moves to the front of the next block
+        template<typename Out>
+        bool read_text(std::istream &in, Out &out, thread_pool &pool, size_t block = text_block) {
+            text_parser<Out> parser(out, pool);
+            std::vector<char> buffer(block);
+            size_t kept = 0;
+
+            for (;;) {
+                in.read(buffer.data() + kept, std::streamsize(buffer.size() - kept));
+
+                const size_t size = kept + size_t(in.gcount());
+                char *const data = buffer.data();
+
+                if (!in) {
+                    const bool ok = !in.bad() && parser.parse(data, data + size);
+
+                    return parser.finish() && ok;
+                }
+
+                size_t line = size;
+
+                while (line > 0 && data[line - 1] != '\n')
+                    --line;
+
+                // A line longer than the buffer: read more of it
+                if (line == 0) {
+                    buffer.resize(buffer.size() * 2);
+                    kept = size;
+                    continue;
+                }
+
+                if (!parser.parse(data, data + line)) {
+                    parser.finish();
+                    return false;
+                }
+
+                kept = size - line;
+                memmove(data, data + line, kept);
+            }
+        }
+
+        // Elements [begin, end) as text appended to s: vectors and quaternions on one line,
+        // matrices with one row per line
+        template<typename E, typename Get>
+        void format_text(std::string &s, size_t begin, size_t end, Get &&get) {
+            typedef text_element<E> element;
+
+            const size_t start = s.size();
+            s.resize(start + (end - begin) * element::size * text_number_size);
+
+            char *p = &s[start];
+
+            for (size_t i = begin; i < end; ++i) {
+                for (size_t k = 0; k < element::size; ++k) {
+                    p = text_format(p, get(i, k));
+                    *p++ = (k + 1) % element::line == 0 ? '\n' : ' ';
+                }
+            }
+
+            s.resize(size_t(p - s.data()));
+        }
+
+        // Formats rounds of chunks on the pool and writes them in order
+        template<typename E, typename Get>
+        bool write_text(std::ostream &out, size_t count, thread_pool &pool, Get &&get) {
+            const size_t chunk = 1 << 14;
+            const size_t chunks = (count + chunk - 1) / chunk;
+            std::vector<std::string> text(std::max<size_t>(pool.size(), 1) * 4);
+
+            for (size_t round = 0; round < chunks; round += text.size()) {
+                const size_t n = std::min(text.size(), chunks - round);
+
+                text_for(n, pool, [&](size_t t) {
+                    const size_t begin = (round + t) * chunk;
+
+                    text[t].clear();
+                    format_text<E>(text[t], begin, std::min(begin + chunk, count), get);
+                });
+
+                for (size_t t = 0; t < n; ++t)
+                    out.write(text[t].data(), std::streamsize(text[t].size()));
+            }
+
+            return bool(out);
+        }
+    }
+
+    // Parse text into elements (scalars, vectors, matrices or quaternions) or a batch of vectors,
+    // large texts in parallel chunks on the pool. Returns false for text that is not a number
+    // and when the count of numbers is not a whole number of elements
+    template<typename E, typename A>
+    bool parse_text(const char *begin, const char *end, std::vector<E, A> &out,
+                    thread_pool &pool = shared_thread_pool()) {
+        return detail::parse_text(begin, end, out, pool);
+    }
+
+    template<typename T, size_t N>
+    bool parse_text(const char *begin, const char *end, vector_batch<T, N> &out,
+                    thread_pool &pool = shared_thread_pool()) {
+        return detail::parse_text(begin, end, out, pool);
+    }
+
+    template<typename Out>
+    bool parse_text(const std::string &text, Out &out, thread_pool &pool = shared_thread_pool()) {
+        return parse_text(text.data(), text.data() + text.size(), out, pool);
+    }
+
+    // Read a whole stream in blocks of text_block bytes, see parse_text()
+    template<typename E, typename A>
+    bool read_text(std::istream &in, std::vector<E, A> &out, thread_pool &pool = shared_thread_pool()) {
+        return detail::read_text(in, out, pool);
+    }
+
+    template<typename T, size_t N>
+    bool read_text(std::istream &in, vector_batch<T, N> &out, thread_pool &pool = shared_thread_pool()) {
+        return detail::read_text(in, out, pool);
+    }
+
+    // Write count elements as text that parse_text() reads back exactly. Vectors and
+    // quaternions take one line, matrices one line per row
+    template<typename E>
+    bool write_text(std::ostream &out, const E *data, size_t count, thread_pool &pool = shared_thread_pool()) {
+        return detail::write_text<E>(out, count, pool, [data](size_t i, size_t k) {
+            return detail::text_element<E>::get(data[i], k);
+        });
+    }
+
+    template<typename E, typename A>
+    bool write_text(std::ostream &out, const std::vector<E, A> &data, thread_pool &pool = shared_thread_pool()) {
+        return write_text(out, data.data(), data.size(), pool);
+    }
+
+    template<typename T, size_t N>
+    bool write_text(std::ostream &out, const vector_batch<T, N> &batch, thread_pool &pool = shared_thread_pool()) {
+        return detail::write_text<vector<T, N>>(out, batch.size(), pool, [&batch](size_t i, size_t k) {
+            return batch.component(k)[i];
+        });
+    }
+
+    // One element
+    template<typename E>
+    bool write_text(std::ostream &out, const E &val) {
+        std::string s;
+        detail::format_text<E>(s, 0, 1, [&val](size_t, size_t k) {
+            return detail::text_element<E>::get(val, k);
+        });
+
+        out.write(s.data(), std::streamsize(s.size()));
+
+        return bool(out);
+    }
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lmel {
+    // Work-stealing thread pool.
+    //
+    // Every worker owns a task queue: it takes its own tasks from the back and,
+    // when that is empty, steals from the front of the other queues. A thread
+    // waiting in parallel_for() runs queued tasks too, so nested parallel loops
+    // do not deadlock.
+    class thread_pool {
+    private:
+        struct task_queue {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::thread> threads;
+        std::vector<std::unique_ptr<task_queue>> queues;
+        std::atomic<size_t> pending {0};
+        std::atomic<size_t> next_queue {0};
+        std::mutex sleep_mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+
+        // Queue of the worker running on this thread (if any)
+        static thread_local thread_pool *current_pool;
+        static thread_local size_t current_index;
+
+        bool pop(size_t index, std::function<void()> &task) {
+            task_queue &q = *queues[index];
+            std::lock_guard<std::mutex> lock(q.mutex);
+
+            if (q.tasks.empty())
+                return false;
+
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+
+            return true;
+        }
+
+        bool steal(size_t index, std::function<void()> &task) {
+            task_queue &q = *queues[index];
+            std::lock_guard<std::mutex> lock(q.mutex);
+
+            if (q.tasks.empty())
+                return false;
+
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+
+            return true;
+        }
+
+        // Own queue first, then the others starting from the next one
+        bool find_task(size_t self, std::function<void()> &task) {
+            const size_t n = queues.size();
+
+            if (self < n && pop(self, task))
+                return true;
+
+            for (size_t i = 1; i <= n; ++i)
+                if (steal((self + i) % n, task))
+                    return true;
+
+            return false;
+        }
+
+        void worker(size_t index) {
+            current_pool = this;
+            current_index = index;
+
+            std::function<void()> task;
+
+            for (;;) {
+                if (find_task(index, task)) {
+                    --pending;
+                    task();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                wake.wait(lock, [this] { return stopping || pending > 0; });
+
+                if (stopping && pending == 0)
+                    return;
+            }
+        }
+
+        void start(size_t count) {
+            stopping = false;
+
+            for (size_t i = 0; i < count; ++i)
+                queues.emplace_back(new task_queue);
+
+            for (size_t i = 0; i < count; ++i)
+                threads.emplace_back(&thread_pool::worker, this, i);
+        }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                stopping = true;
+            }
+
+            wake.notify_all();
+
+            for (std::thread &t : threads)
+                t.join();
+
+            threads.clear();
+            queues.clear();
+        }
+
+    public:
+        // Pool with given number of worker threads. The thread calling parallel_for() works
+        // too, so thread_pool(n) computes on n + 1 threads; 0 or 1 runs everything on the
+        // calling thread
+        explicit thread_pool(size_t count = default_thread_count()) {
+            start(count > 1 ? count : 0);
+        }
+
+        thread_pool(const thread_pool &) = delete;
+        thread_pool &operator=(const thread_pool &) = delete;
+
+        ~thread_pool() {
+            stop();
+        }
+
+        // LMEL_NUM_THREADS environment variable or number of hardware threads
+        static size_t default_thread_count() {
+            if (const char *env = std::getenv("LMEL_NUM_THREADS"))
+                return static_cast<size_t>(std::strtoul(env, nullptr, 10));
+
+            return std::thread::hardware_concurrency();
+        }
+
+        // Number of worker threads, not counting the calling thread
+        size_t size() const {
+            return threads.size();
+        }
+
+        // Change number of worker threads; no parallel work may be running
+        void resize(size_t count) {
+            stop();
+            start(count > 1 ? count : 0);
+        }
+
+        // Queue a task, from a worker thread it goes to that worker's own queue
+        void submit(std::function<void()> task) {
+            if (threads.empty()) {
+                task();
+                return;
+            }
+
+            size_t index = current_pool == this
+                           ? current_index
+                           : next_queue++ % queues.size();
+
+            // Count the task before it becomes visible, so that taking it can't
+            // decrement pending below zero
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                ++pending;
+            }
+
+            {
+                task_queue &q = *queues[index];
+                std::lock_guard<std::mutex> lock(q.mutex);
+                q.tasks.push_back(std::move(task));
+            }
+
+            wake.notify_one();
+        }
+
+        // Run one queued task on the calling thread, false if there was none
+        bool run_pending_task() {
+            if (threads.empty())
+                return false;
+
+            std::function<void()> task;
+            size_t self = current_pool == this ? current_index : queues.size();
+
+            if (!find_task(self, task))
+                return false;
+
+            --pending;
+            task();
+
+            return true;
+        }
+
+        // Call f(i) for every i in [0, count) and wait for all calls to finish.
+        // The calling thread takes part in the work. If calls throw, the remaining
+        // calls still run and the first exception is rethrown on the calling thread
+        template<typename F>
+        void parallel_for(size_t count, F &&f) {
+            if (threads.empty() || count <= 1) {
+                for (size_t i = 0; i < count; ++i)
+                    f(i);
+
+                return;
+            }
+
+            std::atomic<size_t> remaining(count);
+            std::exception_ptr error;
+            std::mutex error_mutex;
+
+            auto run = [&f, &remaining, &error, &error_mutex](size_t i) {
+                try {
+                    f(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+
+                    if (!error)
+                        error = std::current_exception();
+                }
+
+                --remaining;
+            };
+
+            for (size_t i = 1; i < count; ++i)
+                submit([&run, i] { run(i); });
+
+            run(0);
+
+            while (remaining > 0)
+                if (!run_pending_task())
+                    std::this_thread::yield();
+
+            if (error)
+                std::rethrow_exception(error);
+        }
+    };
+
+    inline thread_local thread_pool *thread_pool::current_pool = nullptr;
+    inline thread_local size_t thread_pool::current_index = 0;
+
+    // Pool shared by the library's parallel algorithms
+    inline thread_pool &shared_thread_pool() {
+        static thread_pool pool;
+        return pool;
+    }
+
+    // Number of threads used by the shared pool; no parallel work may be running
+    inline void set_shared_thread_count(size_t count) {
+        shared_thread_pool().resize(count);
+    }
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+#include "simd.h"
+#include "vector.h"
+#include "square_matrix.h"
+#include "vector_batch.h"
+#include "thread_pool.h"
+
+namespace lmel {
+    // Inputs with at least this many vectors are split into chunks and transformed on the pool
+    static const size_t transform_parallel_threshold = 1 << 16;
+    static const size_t transform_chunk = 1 << 14;
+
+    namespace detail {
+        // Call f(begin, end) for [0, count), in chunks on the pool for large counts
+        template<typename F>
+        void transform_split(size_t count, thread_pool &pool, F &&f) {
+            if (count < transform_parallel_threshold || pool.size() == 0) {
+                f(size_t(0), count);
+                return;
+            }
+
+            const size_t chunks = (count + transform_chunk - 1) / transform_chunk;
+
+            pool.parallel_for(chunks, [&](size_t t) {
+                const size_t begin = t * transform_chunk;
+                f(begin, std::min(begin + transform_chunk, count));
+            });
+        }
+
+        // Array of vectors, [begin, end). Point adds the translation column (w = 1),
+        // Divide divides by the resulting w. Sums in the same order as matrix * vector
+        template<bool Point, bool Divide, typename T, typename S, typename L>
+        void transform_aos(const square_matrix<T, 4, S, L> &m, const vector<T, 3> *in, vector<T, 3> *out,
+                           size_t begin, size_t end) {
+#ifdef LMEL_SSE2
+            if constexpr (std::is_same<T, float>::value) {
+                // Matrix columns stay in registers for the whole range,
+                // a col_major matrix has them contiguous already
+                __m128 c0, c1, c2, c3;
+
+                if constexpr (square_matrix<T, 4, S, L>::is_col_major) {
+                    c0 = _mm_loadu_ps(&m(0, 0));
+                    c1 = _mm_loadu_ps(&m(0, 1));
+                    c2 = _mm_loadu_ps(&m(0, 2));
+                    c3 = _mm_loadu_ps(&m(0, 3));
+                } else {
+                    c0 = _mm_setr_ps(m(0, 0), m(1, 0), m(2, 0), m(3, 0));
+                    c1 = _mm_setr_ps(m(0, 1), m(1, 1), m(2, 1), m(3, 1));
+                    c2 = _mm_setr_ps(m(0, 2), m(1, 2), m(2, 2), m(3, 2));
+                    c3 = _mm_setr_ps(m(0, 3), m(1, 3), m(2, 3), m(3, 3));
+                }
+
+                for (size_t i = begin; i < end; ++i) {
+                    const vector<T, 3> &v = in[i];
+
+                    __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(v(0))),
+                                                     _mm_mul_ps(c1, _mm_set1_ps(v(1)))),
+                                          _mm_mul_ps(c2, _mm_set1_ps(v(2))));
+
+                    if constexpr (Point)
+                        r = _mm_add_ps(r, c3);
+
+                    if constexpr (Divide)
+                        r = _mm_div_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3)));
+
+                    alignas(16) float t[4];
+                    _mm_store_ps(t, r);
+
+                    out[i](0) = t[0];
+                    out[i](1) = t[1];
+                    out[i](2) = t[2];
+                }
+
+                return;
+            }
+#endif
+            T a[4][4];
+
+            for (size_t r = 0; r < 4; ++r)
+                for (size_t c = 0; c < 4; ++c)
+                    a[r][c] = m(r, c);
+
+            for (size_t i = begin; i < end; ++i) {
+                const T x = in[i](0), y = in[i](1), z = in[i](2);
+                T r[4];
+
+                for (size_t k = 0; k < 4; ++k) {
+                    r[k] = a[k][0] * x + a[k][1] * y + a[k][2] * z;
+
+                    if constexpr (Point)
+                        r[k] += a[k][3];
+                }
+
+                for (size_t k = 0; k < 3; ++k)
+                    out[i](k) = Divide ? r[k] / r[3] : r[k];
+            }
+        }
+
+        // Component arrays, [begin, end). Every lane is loaded before its result is stored,
+        // so in and out may be the same arrays
+        template<bool Point, bool Divide, typename T, typename S, typename L>
+        void transform_soa(const square_matrix<T, 4, S, L> &m, const T *const in[3], T *const out[3],
+                           size_t begin, size_t end) {
+            T a[4][4];
+
+            for (size_t r = 0; r < 4; ++r)
+                for (size_t c = 0; c < 4; ++c)
+                    a[r][c] = m(r, c);
+
+            size_t i = begin;
+
+#ifdef LMEL_SSE2
+            if constexpr (std::is_same<T, float>::value) {
+                // Four vectors at a time, every matrix element broadcast to its own register
+                __m128 b[4][4];
+
+                for (size_t r = 0; r < 4; ++r)
+                    for (size_t c = 0; c < 4; ++c)
+                        b[r][c] = _mm_set1_ps(a[r][c]);
+
+                for (; i + 4 <= end; i += 4) {
+                    const __m128 x = _mm_loadu_ps(in[0] + i);
+                    const __m128 y = _mm_loadu_ps(in[1] + i);
+                    const __m128 z = _mm_loadu_ps(in[2] + i);
+                    __m128 r[4];
+
+                    for (size_t k = 0; k < (Divide ? 4 : 3); ++k) {
+                        r[k] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b[k][0], x), _mm_mul_ps(b[k][1], y)),
+                                          _mm_mul_ps(b[k][2], z));
+
+                        if constexpr (Point)
+                            r[k] = _mm_add_ps(r[k], b[k][3]);
+                    }
+
+                    for (size_t k = 0; k < 3; ++k)
+                        _mm_storeu_ps(out[k] + i, Divide ? _mm_div_ps(r[k], r[3]) : r[k]);
+                }
+            }
+#endif
+            for (; i < end; ++i) {
+                const T x = in[0][i], y = in[1][i], z = in[2][i];
+                T r[4];
+
+                for (size_t k = 0; k < 4; ++k) {
+                    r[k] = a[k][0] * x + a[k][1] * y + a[k][2] * z;
+
+                    if constexpr (Point)
+                        r[k] += a[k][3];
+                }
+
+                for (size_t k = 0; k < 3; ++k)
+                    out[k][i] = Divide ? r[k] / r[3] : r[k];
+            }
+        }
+    }
+
+    // Transform count points (w = 1) by m, results go to out[0, count).
+    // With perspective the result is divided by w. in and out may be the same array
+    template<typename T, typename S, typename L>
+    void transform_points(const square_matrix<T, 4, S, L> &m, const vector<T, 3> *in, vector<T, 3> *out,
+                          size_t count, bool perspective = false,
+                          thread_pool &pool = shared_thread_pool()) {
+        detail::transform_split(count, pool, [&](size_t begin, size_t end) {
+            if (perspective)
+                detail::transform_aos<true, true>(m, in, out, begin, end);
+            else
+                detail::transform_aos<true, false>(m, in, out, begin, end);
+        });
+    }
+
+    // Transform count directions (w = 0): translation is ignored
+    template<typename T, typename S, typename L>
+    void transform_directions(const square_matrix<T, 4, S, L> &m, const vector<T, 3> *in, vector<T, 3> *out,
+                              size_t count, thread_pool &pool = shared_thread_pool()) {
+        detail::transform_split(count, pool, [&](size_t begin, size_t end) {
+            detail::transform_aos<false, false>(m, in, out, begin, end);
+        });
+    }
+
+    // Batch versions, out is resized to in.size() and may be the same batch as in
+    template<typename T, typename S, typename L>
+    void transform_points(const square_matrix<T, 4, S, L> &m, const vector_batch<T, 3> &in, vector_batch<T, 3> &out,
+                          bool perspective = false, thread_pool &pool = shared_thread_pool()) {
+        out.resize(in.size());
+
+        const T *const src[3] = {in.component(0), in.component(1), in.component(2)};
+        T *const dst[3] = {out.component(0), out.component(1), out.component(2)};
+
+        detail::transform_split(in.size(), pool, [&](size_t begin, size_t end) {
+            if (perspective)
+                detail::transform_soa<true, true>(m, src, dst, begin, end);
+            else
+                detail::transform_soa<true, false>(m, src, dst, begin, end);
+        });
+    }
+
+    template<typename T, typename S, typename L>
+    void transform_directions(const square_matrix<T, 4, S, L> &m, const vector_batch<T, 3> &in, vector_batch<T, 3> &out,
+                              thread_pool &pool = shared_thread_pool()) {
+        out.resize(in.size());
+
+        const T *const src[3] = {in.component(0), in.component(1), in.component(2)};
+        T *const dst[3] = {out.component(0), out.component(1), out.component(2)};
+
+        detail::transform_split(in.size(), pool, [&](size_t begin, size_t end) {
+            detail::transform_soa<false, false>(m, src, dst, begin, end);
+        });
+    }
+}
@@ -2,33 +2,55 @@
 
 #include <type_traits>
 #include <initializer_list>
+#include <limits>
 #include <cassert>
 #include <math.h>
+#include "simd.h"
+#include "storage.h"
+#include "counters.h"
+#include "half.h"
 
 namespace lmel
 {
 	template <
 		typename T,
 		size_t N,
-		typename = typename std::enable_if<std::is_arithmetic<T>::value && N != 0, T>::type
+		typename Storage = packed_storage,
+		typename = typename std::enable_if<is_element<T>::value && N != 0, T>::type
 		>
 	class vector
 	{
+	public:
+		typedef T value_type;
+
+		static const size_t size = N;
+
+		// Number of stored lanes, more than size when the storage policy pads
+		static const size_t storage_size = Storage::padded_size(N);
+
 	private:
-		T data[N];
+		typedef simd::kernel<T, storage_size> kernel;
+
+		alignas(T) alignas(Storage::alignment) T data[storage_size] {};
+
+		// Kernels work on all stored lanes, scalar operations can make the padding non-zero
+		constexpr void clear_padding()
+		{
+			for (size_t i = size; i < storage_size; ++i)
+				data[i] = 0;
+		}
 
 	public:
-		static const size_t size = N;
 
 		// Constructor with init value
-		explicit vector(T init = 0)
+		constexpr explicit vector(T init = 0)
 		{
 			for (size_t i = 0; i < size; ++i)
 				data[i] = init;
 		}
 
 		// Initializer list constructor
-		vector(std::initializer_list<T> il)
+		constexpr vector(std::initializer_list<T> il)
 		{
 			assert(il.size() == N);
 
@@ -38,40 +60,26 @@ namespace lmel
 				data[i++] = v;
 		}
 
-		// Copy constructor
-		vector(const vector & ref)
-		{
-			for (size_t i = 0; i < size; ++i)
-				data[i] = ref.data[i];
-		}
+		// Copy constructor, trivial: vectors can be copied with memcpy
+		constexpr vector(const vector & ref) = default;
 
-		// Template copy constructor (for other types)
-		template <typename O>
-		vector(const vector<O, N> & ref)
+		// Template copy constructor (for other types and storage policies)
+		template <typename O, typename S>
+		constexpr vector(const vector<O, N, S> & ref)
 		{
 			for (size_t i = 0; i < size; ++i)
 				data[i] = ref(i);
 		}
 
-		// Assignment operator
-		vector & operator=(const vector & val)
-		{
-			if (&val == this)
-				return *this;
-
-			for (size_t i = 0; i < size; ++i)
-				data[i] = val.data[i];
-
-			return *this;
-		}
+		// Assignment operator, trivial
+		constexpr vector & operator=(const vector & val) = default;
 
 		// Vector length
 		double length() const
 		{
-			T sum = 0;
+			LMEL_COUNT(length, 1, 0, 0);
 
-			for (size_t i = 0; i < size; ++i)
-				sum += data[i] * data[i];
+			accumulate_t<T> sum = *this * *this;
 
 			return sqrt(sum);
 		}
@@ -79,42 +87,94 @@ namespace lmel
 		// Normalize vector
 		bool normalize()
 		{
+			LMEL_COUNT(length, N, 2 * N * sizeof(T), 0);
+
 			double len = length();
 
 			if (len <= std::numeric_limits<double>::epsilon())
                 return false;
 
-			for (size_t i = 0; i < size; ++i)
-				data[i] /= len;
+			if constexpr (kernel::enabled)
+			{
+				kernel::div(data, len, data);
+				clear_padding();
+			}
+			else
+				for (size_t i = 0; i < size; ++i)
+					data[i] /= len;
 
             return true;
 		}
 
+		// Normalize vector with a math policy (see fast_math.h): multiplies by Math::rsqrt
+		// of the squared length, computed in T (in float for 16-bit scalars)
+		template <typename Math>
+		bool normalize(Math)
+		{
+			typedef accumulate_t<T> real;
+
+			static_assert(std::is_floating_point<real>::value, "normalize with a math policy needs a floating point type");
+
+			real sum = *this * *this;
+
+			if (sum <= std::numeric_limits<real>::min())
+				return false;
+
+			*this *= Math::rsqrt(sum);
+
+			return true;
+		}
+
 		// Default math operations:
 
-		vector operator+(const vector & val) const
+		constexpr vector operator+(const vector & val) const
 		{
+			LMEL_COUNT(vector, N, 3 * N * sizeof(T), 1);
+
 			vector result(0);
 
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+				{
+					kernel::add(data, val.data, result.data);
+					return result;
+				}
+
 			for (size_t i = 0; i < size; ++i)
 				result.data[i] = data[i] + val.data[i];
 
 			return result;
 		}
 
-		vector operator-(const vector & val) const
+		constexpr vector operator-(const vector & val) const
 		{
+			LMEL_COUNT(vector, N, 3 * N * sizeof(T), 1);
+
 			vector result(0);
 
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+				{
+					kernel::sub(data, val.data, result.data);
+					return result;
+				}
+
 			for (size_t i = 0; i < size; ++i)
-				result.data[i] = data[i] + val.data[i];
+				result.data[i] = data[i] - val.data[i];
 
 			return result;
 		}
 
-		T operator*(const vector & val) const
+		// Dot product, summed in float for 16-bit scalars
+		constexpr accumulate_t<T> operator*(const vector & val) const
 		{
-			T prod = 0;
+			LMEL_COUNT(dot, 2 * N, 2 * N * sizeof(T), 0);
+
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+					return kernel::dot(data, val.data);
+
+			accumulate_t<T> prod = 0;
 
 			for (size_t i = 0; i < size; ++i)
 				prod += data[i] * val.data[i];
@@ -122,88 +182,186 @@ namespace lmel
 			return prod;
 		}
 
-		vector & operator+=(const vector & val)
+		constexpr vector & operator+=(const vector & val)
 		{
+			LMEL_COUNT(vector, N, 3 * N * sizeof(T), 0);
+
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+				{
+					kernel::add(data, val.data, data);
+					return *this;
+				}
+
 			for (size_t i = 0; i < size; ++i)
 				data[i] += val.data[i];
 
 			return *this;
 		}
 
-		vector & operator-=(const vector & val)
+		constexpr vector & operator-=(const vector & val)
 		{
+			LMEL_COUNT(vector, N, 3 * N * sizeof(T), 0);
+
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+				{
+					kernel::sub(data, val.data, data);
+					return *this;
+				}
+
 			for (size_t i = 0; i < size; ++i)
 				data[i] -= val.data[i];
 
 			return *this;
 		}
 
-		vector operator+(T val) const
+		constexpr vector operator+(T val) const
 		{
+			LMEL_COUNT(vector, N, 2 * N * sizeof(T), 1);
+
 			vector result(0);
 
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+				{
+					kernel::add(data, val, result.data);
+					result.clear_padding();
+					return result;
+				}
+
 			for (size_t i = 0; i < size; ++i)
 				result.data[i] = data[i] + val;
 
 			return result;
 		}
 
-		vector operator-(T val) const
+		constexpr vector operator-(T val) const
 		{
+			LMEL_COUNT(vector, N, 2 * N * sizeof(T), 1);
+
 			vector result(0);
 
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+				{
+					kernel::sub(data, val, result.data);
+					result.clear_padding();
+					return result;
+				}
+
 			for (size_t i = 0; i < size; ++i)
 				result.data[i] = data[i] - val;
 
 			return result;
 		}
 
-		vector operator*(T val) const
+		constexpr vector operator*(T val) const
 		{
+			LMEL_COUNT(vector, N, 2 * N * sizeof(T), 1);
+
 			vector result(0);
 
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+				{
+					kernel::mul(data, val, result.data);
+					result.clear_padding();
+					return result;
+				}
+
 			for (size_t i = 0; i < size; ++i)
 				result.data[i] = data[i] * val;
 
 			return result;
 		}
 
-		vector operator/(T val) const
+		constexpr vector operator/(T val) const
 		{
+			LMEL_COUNT(vector, N, 2 * N * sizeof(T), 1);
+
 			vector result(0);
 
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+				{
+					kernel::div(data, val, result.data);
+					result.clear_padding();
+					return result;
+				}
+
 			for (size_t i = 0; i < size; ++i)
 				result.data[i] = data[i] / val;
 
 			return result;
 		}
 
-		vector & operator+=(T val)
+		constexpr vector & operator+=(T val)
 		{
+			LMEL_COUNT(vector, N, 2 * N * sizeof(T), 0);
+
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+				{
+					kernel::add(data, val, data);
+					clear_padding();
+					return *this;
+				}
+
 			for (size_t i = 0; i < size; ++i)
 				data[i] += val;
 
 			return *this;
 		}
 
-		vector & operator-=(T val)
+		constexpr vector & operator-=(T val)
 		{
+			LMEL_COUNT(vector, N, 2 * N * sizeof(T), 0);
+
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+				{
+					kernel::sub(data, val, data);
+					clear_padding();
+					return *this;
+				}
+
 			for (size_t i = 0; i < size; ++i)
 				data[i] -= val;
 
 			return *this;
 		}
 
-		vector & operator*=(T val)
+		constexpr vector & operator*=(T val)
 		{
+			LMEL_COUNT(vector, N, 2 * N * sizeof(T), 0);
+
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+				{
+					kernel::mul(data, val, data);
+					clear_padding();
+					return *this;
+				}
+
 			for (size_t i = 0; i < size; ++i)
 				data[i] *= val;
 
 			return *this;
 		}
 
-		vector & operator/=(T val)
+		constexpr vector & operator/=(T val)
 		{
+			LMEL_COUNT(vector, N, 2 * N * sizeof(T), 0);
+
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+				{
+					kernel::div(data, val, data);
+					clear_padding();
+					return *this;
+				}
+
 			for (size_t i = 0; i < size; ++i)
 				data[i] /= val;
 
@@ -212,8 +370,14 @@ namespace lmel
 
 		// Compare operations:
 
-		bool operator==(const vector & v) const
+		constexpr bool operator==(const vector & v) const
 		{
+			LMEL_COUNT(vector, 0, 2 * N * sizeof(T), 0);
+
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+					return kernel::equal(data, v.data);
+
 			for (size_t i = 0; i < size; ++i)
 				if (data[i] != v.data[i])
 					return false;
@@ -221,8 +385,14 @@ namespace lmel
 			return true;
 		}
 
-		bool operator!=(const vector & v) const
+		constexpr bool operator!=(const vector & v) const
 		{
+			LMEL_COUNT(vector, 0, 2 * N * sizeof(T), 0);
+
+			if constexpr (kernel::enabled)
+				if (!LMEL_CONSTANT_EVALUATED())
+					return !kernel::equal(data, v.data);
+
 			for (size_t i = 0; i < size; ++i)
 				if (data[i] != v.data[i])
 					return true;
@@ -232,31 +402,30 @@ namespace lmel
 
 		// get/set selected element:
 
-		T & operator()(size_t i)
+		constexpr T & operator()(size_t i)
 		{
 			assert(i < size);
 			return data[i];
 		}
 
-		const T & operator()(size_t i) const
+		constexpr const T & operator()(size_t i) const
 		{
 			assert(i < size);
 			return data[i];
 		}
-
-		template <typename V>
-		friend vector<V, 3> cross(const vector<V, 3> & v1, const vector<V, 3> & v2);
 	};
 
 	// Cross product
-	template <typename T>
-	vector<T, 3> cross(const vector<T, 3> & v1, const vector<T, 3> & v2)
+	template <typename T, typename S>
+	constexpr vector<T, 3, S> cross(const vector<T, 3, S> & v1, const vector<T, 3, S> & v2)
 	{
-		return vector<T, 3>
+		LMEL_COUNT(dot, 9, 9 * sizeof(T), 1);
+
+		return vector<T, 3, S>
 		{
-			v1.data[1] * v2.data[2] - v1.data[2] * v2.data[1],
-			v1.data[0] * v2.data[2] - v1.data[2] * v2.data[0],
-			v1.data[0] * v2.data[1] - v1.data[1] * v2.data[0]
+			v1(1) * v2(2) - v1(2) * v2(1),
+			v1(2) * v2(0) - v1(0) * v2(2),
+			v1(0) * v2(1) - v1(1) * v2(0)
 		};
 	}
 
@@ -298,4 +467,8 @@ namespace lmel
 	using float_vector3d = vector<float, 3>;
 	using float_vector4d = vector<float, 4>;
 	using float_vector5d = vector<float, 5>;
+
+	// Vectors are plain arrays of elements: memcpy, binary I/O and relocation are safe
+	static_assert(std::is_trivially_copyable<float_vector3d>::value && std::is_standard_layout<float_vector3d>::value &&
+		std::is_trivially_copyable<vector<double, 3, storage<32, true>>>::value, "vector must be trivially copyable");
 }
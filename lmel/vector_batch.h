@@ -0,0 +1,608 @@
+#pragma once
+
+#include <type_traits>
+#include <initializer_list>
+#include <algorithm>
+#include <vector>
+#include <limits>
+#include <cassert>
+#include <math.h>
+#include "aligned.h"
+#include "vector.h"
+#include "half.h"
+
+namespace lmel {
+    // Structure-of-arrays container: N separate aligned arrays, one per component.
+    // Every operation runs as a flat loop over contiguous lanes, so the compiler
+    // can use the full width of the SIMD registers.
+    template<
+            typename T,
+            size_t N,
+            typename = typename std::enable_if<is_element<T>::value && N != 0, T>::type
+    >
+    class vector_batch {
+    private:
+        // Type used for lengths: T for floating point, float for 16-bit scalars, double
+        // otherwise (as in vector::length)
+        typedef typename std::conditional<std::is_floating_point<accumulate_t<T>>::value,
+                accumulate_t<T>, double>::type real;
+
+        // 16-bit scalars stream through blocks of float
+        static constexpr bool streamed = is_storage_scalar<T>::value;
+        static constexpr size_t stream_block = 256;
+
+        aligned_vector<T> data[N];
+
+        // Calls f(v, w, b, n) for the blocks of n <= stream_block vectors starting at b, with
+        // v[c] and w[c] holding component c of self and of other (when not null) converted
+        // to float. With Store, v is converted back into self after every block
+        template<bool Store, typename Self, typename F>
+        static void stream(Self &self, const vector_batch *other, F &&f) {
+            float v[N][stream_block], w[N][stream_block];
+
+            for (size_t b = 0, count = self.size(); b < count; b += stream_block) {
+                const size_t n = std::min(stream_block, count - b);
+
+                for (size_t c = 0; c < dimension; ++c) {
+                    convert(self.data[c].data() + b, v[c], n);
+
+                    if (other)
+                        convert(other->data[c].data() + b, w[c], n);
+                }
+
+                f(v, w, b, n);
+
+                if constexpr (Store)
+                    for (size_t c = 0; c < dimension; ++c)
+                        convert(v[c], self.data[c].data() + b, n);
+            }
+        }
+
+    public:
+        static const size_t dimension = N;
+
+        // Type of batch lengths: double for integral scalars (as vector::length returns), T otherwise
+        typedef typename std::conditional<std::is_integral<T>::value, double, T>::type length_type;
+
+        // Constructor with count and init value
+        explicit vector_batch(size_t count = 0, T init = 0) {
+            for (size_t c = 0; c < dimension; ++c)
+                data[c].assign(count, init);
+        }
+
+        // Constructor from array of vectors
+        explicit vector_batch(const std::vector<vector<T, N>> &vs)
+                : vector_batch(vs.data(), vs.size()) {}
+
+        // Constructor from contiguous array of vectors
+        vector_batch(const vector<T, N> *vs, size_t count) {
+            for (size_t c = 0; c < dimension; ++c) {
+                data[c].resize(count);
+
+                T *out = data[c].data();
+
+                for (size_t i = 0; i < count; ++i)
+                    out[i] = vs[i](c);
+            }
+        }
+
+        // Initializer list constructor
+        vector_batch(std::initializer_list<vector<T, N>> il)
+                : vector_batch(il.begin(), il.size()) {}
+
+        size_t size() const {
+            return data[0].size();
+        }
+
+        bool empty() const {
+            return data[0].empty();
+        }
+
+        void resize(size_t count, T init = 0) {
+            for (size_t c = 0; c < dimension; ++c)
+                data[c].resize(count, init);
+        }
+
+        void reserve(size_t count) {
+            for (size_t c = 0; c < dimension; ++c)
+                data[c].reserve(count);
+        }
+
+        void clear() {
+            for (size_t c = 0; c < dimension; ++c)
+                data[c].clear();
+        }
+
+        void push_back(const vector<T, N> &vec) {
+            for (size_t c = 0; c < dimension; ++c)
+                data[c].push_back(vec(c));
+        }
+
+        vector<T, N> get(size_t i) const {
+            assert(i < size());
+
+            vector<T, N> result(0);
+
+            for (size_t c = 0; c < dimension; ++c)
+                result(c) = data[c][i];
+
+            return result;
+        }
+
+        void set(size_t i, const vector<T, N> &vec) {
+            assert(i < size());
+
+            for (size_t c = 0; c < dimension; ++c)
+                data[c][i] = vec(c);
+        }
+
+        // Write all vectors into contiguous array of size()
+        void store(vector<T, N> *out) const {
+            const size_t count = size();
+
+            for (size_t c = 0; c < dimension; ++c) {
+                const T *in = data[c].data();
+
+                for (size_t i = 0; i < count; ++i)
+                    out[i](c) = in[i];
+            }
+        }
+
+        std::vector<vector<T, N>> to_vectors() const {
+            std::vector<vector<T, N>> result(size());
+            store(result.data());
+            return result;
+        }
+
+        // Component arrays:
+
+        T *component(size_t c) {
+            assert(c < dimension);
+            return data[c].data();
+        }
+
+        const T *component(size_t c) const {
+            assert(c < dimension);
+            return data[c].data();
+        }
+
+        // Batch lengths
+        void length(length_type *__restrict out) const {
+            if constexpr (streamed) {
+                stream<false>(*this, nullptr, [out](auto &v, auto &, size_t b, size_t n) {
+                    float len[stream_block];
+
+                    for (size_t i = 0; i < n; ++i) {
+                        float sum = 0;
+
+                        for (size_t c = 0; c < dimension; ++c)
+                            sum += v[c][i] * v[c][i];
+
+                        len[i] = sqrtf(sum);
+                    }
+
+                    convert(len, out + b, n);
+                });
+
+                return;
+            }
+
+            const size_t count = size();
+            const T *in[N];
+
+            for (size_t c = 0; c < dimension; ++c)
+                in[c] = data[c].data();
+
+            for (size_t i = 0; i < count; ++i) {
+                T sum = 0;
+
+                for (size_t c = 0; c < dimension; ++c)
+                    sum += in[c][i] * in[c][i];
+
+                out[i] = static_cast<length_type>(sqrt(static_cast<real>(sum)));
+            }
+        }
+
+        aligned_vector<length_type> length() const {
+            aligned_vector<length_type> result(size());
+            length(result.data());
+            return result;
+        }
+
+        // Normalize every vector, zero vectors are left unchanged.
+        // Returns the number of normalized vectors
+        size_t normalize() {
+            const size_t count = size();
+            const real eps = std::numeric_limits<real>::epsilon();
+            T *out[N];
+            size_t normalized = 0;
+
+            if constexpr (streamed) {
+                stream<true>(*this, nullptr, [&normalized, eps](auto &v, auto &, size_t, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        float sum = 0;
+
+                        for (size_t c = 0; c < dimension; ++c)
+                            sum += v[c][i] * v[c][i];
+
+                        float len = sqrtf(sum);
+                        bool ok = len > eps;
+                        float div = ok ? len : 1;
+
+                        for (size_t c = 0; c < dimension; ++c)
+                            v[c][i] /= div;
+
+                        normalized += ok;
+                    }
+                });
+
+                return normalized;
+            }
+
+            for (size_t c = 0; c < dimension; ++c)
+                out[c] = data[c].data();
+
+            for (size_t i = 0; i < count; ++i) {
+                real sum = 0;
+
+                for (size_t c = 0; c < dimension; ++c)
+                    sum += static_cast<real>(out[c][i]) * out[c][i];
+
+                real len = sqrt(sum);
+                bool ok = len > eps;
+                real div = ok ? len : 1;
+
+                for (size_t c = 0; c < dimension; ++c)
+                    out[c][i] = static_cast<T>(out[c][i] / div);
+
+                normalized += ok;
+            }
+
+            return normalized;
+        }
+
+        // Normalize with a math policy (see fast_math.h): squared lengths of a block go
+        // through the batch Math::rsqrt, vectors shorter than the smallest normal T are
+        // left unchanged. 16-bit scalars are converted to float blocks on load and back
+        // on store. Returns the number of normalized vectors
+        template<typename Math>
+        size_t normalize(Math) {
+            static_assert(std::is_floating_point<T>::value || streamed,
+                          "normalize with a math policy needs a floating point type");
+
+            static constexpr size_t block = 64;
+
+            const size_t count = size();
+            const real tiny = std::numeric_limits<real>::min();
+            T *out[N];
+            size_t normalized = 0;
+
+            for (size_t c = 0; c < dimension; ++c)
+                out[c] = data[c].data();
+
+            // Blocks are copied to local arrays, so every loop below has a fixed trip count
+            // and vectorizes; lanes past the end of the batch stay zero and are not counted
+            for (size_t b = 0; b < count; b += block) {
+                const size_t n = std::min(block, count - b);
+                real v[N][block] {}, sum[block] {}, inv[block];
+
+                for (size_t c = 0; c < dimension; ++c)
+                    convert(out[c] + b, v[c], n);
+
+                for (size_t c = 0; c < dimension; ++c)
+                    for (size_t i = 0; i < block; ++i)
+                        sum[i] += v[c][i] * v[c][i];
+
+                for (size_t i = 0; i < block; ++i) {
+                    normalized += sum[i] > tiny;
+                    sum[i] = sum[i] > tiny ? sum[i] : 0;
+                }
+
+                Math::rsqrt(sum, inv, block);
+
+                // Too short vectors get a factor of 1
+                for (size_t i = 0; i < block; ++i)
+                    inv[i] = sum[i] > 0 ? inv[i] : 1;
+
+                for (size_t c = 0; c < dimension; ++c) {
+                    for (size_t i = 0; i < block; ++i)
+                        v[c][i] *= inv[i];
+
+                    convert(v[c], out[c] + b, n);
+                }
+            }
+
+            return normalized;
+        }
+
+        // Default math operations:
+
+        vector_batch operator+(const vector_batch &val) const {
+            vector_batch result = *this;
+            result += val;
+            return result;
+        }
+
+        vector_batch operator-(const vector_batch &val) const {
+            vector_batch result = *this;
+            result -= val;
+            return result;
+        }
+
+        // Batch dot product
+        void dot(const vector_batch &val, T *__restrict out) const {
+            assert(size() == val.size());
+
+            if constexpr (streamed) {
+                stream<false>(*this, &val, [out](auto &v, auto &w, size_t b, size_t n) {
+                    float prod[stream_block];
+
+                    for (size_t i = 0; i < n; ++i) {
+                        prod[i] = 0;
+
+                        for (size_t c = 0; c < dimension; ++c)
+                            prod[i] += v[c][i] * w[c][i];
+                    }
+
+                    convert(prod, out + b, n);
+                });
+
+                return;
+            }
+
+            const size_t count = size();
+            const T *a[N];
+            const T *b[N];
+
+            for (size_t c = 0; c < dimension; ++c) {
+                a[c] = data[c].data();
+                b[c] = val.data[c].data();
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                T prod = 0;
+
+                for (size_t c = 0; c < dimension; ++c)
+                    prod += a[c][i] * b[c][i];
+
+                out[i] = prod;
+            }
+        }
+
+        aligned_vector<T> operator*(const vector_batch &val) const {
+            aligned_vector<T> result(size());
+            dot(val, result.data());
+            return result;
+        }
+
+        vector_batch &operator+=(const vector_batch &val) {
+            assert(size() == val.size());
+
+            if constexpr (streamed) {
+                stream<true>(*this, &val, [](auto &v, auto &w, size_t, size_t n) {
+                    for (size_t c = 0; c < dimension; ++c)
+                        for (size_t i = 0; i < n; ++i)
+                            v[c][i] += w[c][i];
+                });
+
+                return *this;
+            }
+
+            const size_t count = size();
+
+            for (size_t c = 0; c < dimension; ++c) {
+                T *a = data[c].data();
+                const T *b = val.data[c].data();
+
+                for (size_t i = 0; i < count; ++i)
+                    a[i] += b[i];
+            }
+
+            return *this;
+        }
+
+        vector_batch &operator-=(const vector_batch &val) {
+            assert(size() == val.size());
+
+            if constexpr (streamed) {
+                stream<true>(*this, &val, [](auto &v, auto &w, size_t, size_t n) {
+                    for (size_t c = 0; c < dimension; ++c)
+                        for (size_t i = 0; i < n; ++i)
+                            v[c][i] -= w[c][i];
+                });
+
+                return *this;
+            }
+
+            const size_t count = size();
+
+            for (size_t c = 0; c < dimension; ++c) {
+                T *a = data[c].data();
+                const T *b = val.data[c].data();
+
+                for (size_t i = 0; i < count; ++i)
+                    a[i] -= b[i];
+            }
+
+            return *this;
+        }
+
+        vector_batch operator+(T val) const {
+            vector_batch result = *this;
+            result += val;
+            return result;
+        }
+
+        vector_batch operator-(T val) const {
+            vector_batch result = *this;
+            result -= val;
+            return result;
+        }
+
+        vector_batch operator*(T val) const {
+            vector_batch result = *this;
+            result *= val;
+            return result;
+        }
+
+        vector_batch operator/(T val) const {
+            vector_batch result = *this;
+            result /= val;
+            return result;
+        }
+
+        vector_batch &operator+=(T val) {
+            if constexpr (streamed) {
+                stream<true>(*this, nullptr, [s = float(val)](auto &v, auto &, size_t, size_t n) {
+                    for (size_t c = 0; c < dimension; ++c)
+                        for (size_t i = 0; i < n; ++i)
+                            v[c][i] += s;
+                });
+
+                return *this;
+            }
+
+            for (size_t c = 0; c < dimension; ++c) {
+                T *a = data[c].data();
+
+                for (size_t i = 0, count = size(); i < count; ++i)
+                    a[i] += val;
+            }
+
+            return *this;
+        }
+
+        vector_batch &operator-=(T val) {
+            if constexpr (streamed) {
+                stream<true>(*this, nullptr, [s = float(val)](auto &v, auto &, size_t, size_t n) {
+                    for (size_t c = 0; c < dimension; ++c)
+                        for (size_t i = 0; i < n; ++i)
+                            v[c][i] -= s;
+                });
+
+                return *this;
+            }
+
+            for (size_t c = 0; c < dimension; ++c) {
+                T *a = data[c].data();
+
+                for (size_t i = 0, count = size(); i < count; ++i)
+                    a[i] -= val;
+            }
+
+            return *this;
+        }
+
+        vector_batch &operator*=(T val) {
+            if constexpr (streamed) {
+                stream<true>(*this, nullptr, [s = float(val)](auto &v, auto &, size_t, size_t n) {
+                    for (size_t c = 0; c < dimension; ++c)
+                        for (size_t i = 0; i < n; ++i)
+                            v[c][i] *= s;
+                });
+
+                return *this;
+            }
+
+            for (size_t c = 0; c < dimension; ++c) {
+                T *a = data[c].data();
+
+                for (size_t i = 0, count = size(); i < count; ++i)
+                    a[i] *= val;
+            }
+
+            return *this;
+        }
+
+        vector_batch &operator/=(T val) {
+            if constexpr (streamed) {
+                stream<true>(*this, nullptr, [s = float(val)](auto &v, auto &, size_t, size_t n) {
+                    for (size_t c = 0; c < dimension; ++c)
+                        for (size_t i = 0; i < n; ++i)
+                            v[c][i] /= s;
+                });
+
+                return *this;
+            }
+
+            for (size_t c = 0; c < dimension; ++c) {
+                T *a = data[c].data();
+
+                for (size_t i = 0, count = size(); i < count; ++i)
+                    a[i] /= val;
+            }
+
+            return *this;
+        }
+
+        // Compare operations:
+
+        bool operator==(const vector_batch &b) const {
+            for (size_t c = 0; c < dimension; ++c)
+                if (data[c] != b.data[c])
+                    return false;
+
+            return true;
+        }
+
+        bool operator!=(const vector_batch &b) const {
+            return !(*this == b);
+        }
+
+        // get/set selected component of selected vector:
+
+        T &operator()(size_t i, size_t c) {
+            assert(i < size() && c < dimension);
+            return data[c][i];
+        }
+
+        const T &operator()(size_t i, size_t c) const {
+            assert(i < size() && c < dimension);
+            return data[c][i];
+        }
+    };
+
+    // Batch cross product
+    template<typename T>
+    vector_batch<T, 3> cross(const vector_batch<T, 3> &v1, const vector_batch<T, 3> &v2) {
+        assert(v1.size() == v2.size());
+
+        const size_t count = v1.size();
+        vector_batch<T, 3> result(count);
+
+        const T *__restrict ax = v1.component(0);
+        const T *__restrict ay = v1.component(1);
+        const T *__restrict az = v1.component(2);
+        const T *__restrict bx = v2.component(0);
+        const T *__restrict by = v2.component(1);
+        const T *__restrict bz = v2.component(2);
+        T *__restrict rx = result.component(0);
+        T *__restrict ry = result.component(1);
+        T *__restrict rz = result.component(2);
+
+        for (size_t i = 0; i < count; ++i) {
+            rx[i] = ay[i] * bz[i] - az[i] * by[i];
+            ry[i] = az[i] * bx[i] - ax[i] * bz[i];
+            rz[i] = ax[i] * by[i] - ay[i] * bx[i];
+        }
+
+        return result;
+    }
+
+    template<typename T>
+    using vector2d_batch = vector_batch<T, 2>;
+
+    template<typename T>
+    using vector3d_batch = vector_batch<T, 3>;
+
+    template<typename T>
+    using vector4d_batch = vector_batch<T, 4>;
+
+    using float_vector2d_batch = vector_batch<float, 2>;
+    using float_vector3d_batch = vector_batch<float, 3>;
+    using float_vector4d_batch = vector_batch<float, 4>;
+
+    using double_vector2d_batch = vector_batch<double, 2>;
+    using double_vector3d_batch = vector_batch<double, 3>;
+    using double_vector4d_batch = vector_batch<double, 4>;
+}
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <type_traits>
+#include <cstddef>
+#include <cassert>
+#include "vector.h"
+
+namespace lmel {
+    // Non-owning views into a matrix, returned by matrix::row(), col(), block<R, C>() and
+    // square_matrix::minor_view(). A view reads and writes the elements of its matrix
+    // directly and must not outlive it; a view of a const matrix is read-only.
+    //
+    // Assigning to a view writes into the matrix. Operators that take another view
+    // convert it to a value first, so overlapping views of one matrix are safe.
+
+    // Row (Row = true) or column of a matrix
+    template<typename Matrix, bool Row>
+    class line_view {
+    public:
+        typedef typename std::remove_const<Matrix>::type matrix_type;
+        typedef typename matrix_type::value_type value_type;
+
+        static const size_t size = Row ? matrix_type::cols : matrix_type::rows;
+
+        typedef vector<value_type, size> result_type;
+
+    private:
+        Matrix &m;
+        size_t index;
+
+    public:
+        constexpr line_view(Matrix &m, size_t index)
+                : m(m), index(index) {
+            assert(index < (Row ? matrix_type::rows : matrix_type::cols));
+        }
+
+        constexpr line_view(const line_view &) = default;
+
+        // Copies elements, the view keeps pointing at its own line
+        constexpr line_view &operator=(const line_view &val) {
+            return *this = result_type(val);
+        }
+
+        constexpr line_view &operator=(const result_type &val) {
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) = val(i);
+
+            return *this;
+        }
+
+        constexpr operator result_type() const {
+            result_type result(0);
+
+            for (size_t i = 0; i < size; ++i)
+                result(i) = (*this)(i);
+
+            return result;
+        }
+
+        // Exchange elements with another line of the same length, in place
+        template<typename O, bool R>
+        constexpr void swap(const line_view<O, R> &val) const {
+            static_assert(line_view<O, R>::size == size, "lines must have the same length");
+
+            for (size_t i = 0; i < size; ++i) {
+                value_type tmp = (*this)(i);
+                (*this)(i) = val(i);
+                val(i) = tmp;
+            }
+        }
+
+        // Default math operations, results are vectors:
+
+        constexpr result_type operator+(const result_type &val) const {
+            return result_type(*this) + val;
+        }
+
+        constexpr result_type operator-(const result_type &val) const {
+            return result_type(*this) - val;
+        }
+
+        // Dot product
+        constexpr accumulate_t<value_type> operator*(const result_type &val) const {
+            return result_type(*this) * val;
+        }
+
+        constexpr result_type operator+(value_type val) const {
+            return result_type(*this) + val;
+        }
+
+        constexpr result_type operator-(value_type val) const {
+            return result_type(*this) - val;
+        }
+
+        constexpr result_type operator*(value_type val) const {
+            return result_type(*this) * val;
+        }
+
+        constexpr result_type operator/(value_type val) const {
+            return result_type(*this) / val;
+        }
+
+        // In-place operations on the matrix elements:
+
+        constexpr line_view &operator+=(const result_type &val) {
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) += val(i);
+
+            return *this;
+        }
+
+        constexpr line_view &operator-=(const result_type &val) {
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) -= val(i);
+
+            return *this;
+        }
+
+        constexpr line_view &operator+=(value_type val) {
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) += val;
+
+            return *this;
+        }
+
+        constexpr line_view &operator-=(value_type val) {
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) -= val;
+
+            return *this;
+        }
+
+        constexpr line_view &operator*=(value_type val) {
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) *= val;
+
+            return *this;
+        }
+
+        constexpr line_view &operator/=(value_type val) {
+            for (size_t i = 0; i < size; ++i)
+                (*this)(i) /= val;
+
+            return *this;
+        }
+
+        // Compare operations:
+
+        constexpr bool operator==(const result_type &val) const {
+            for (size_t i = 0; i < size; ++i)
+                if ((*this)(i) != val(i))
+                    return false;
+
+            return true;
+        }
+
+        constexpr bool operator!=(const result_type &val) const {
+            return !(*this == val);
+        }
+
+        // get/set selected element:
+
+        constexpr auto &operator()(size_t i) const {
+            assert(i < size);
+            return Row ? m(index, i) : m(i, index);
+        }
+    };
+
+    template<typename Matrix>
+    using row_view = line_view<Matrix, true>;
+
+    template<typename Matrix>
+    using col_view = line_view<Matrix, false>;
+
+    // R x C part of a matrix: a block starting at (row, col) when Skip is false,
+    // all elements outside given row and column (a minor) when Skip is true
+    template<typename Matrix, size_t R, size_t C, bool Skip>
+    class sub_view {
+    public:
+        typedef typename std::remove_const<Matrix>::type matrix_type;
+        typedef typename matrix_type::value_type value_type;
+
+        static const size_t rows = R;
+        static const size_t cols = C;
+
+        // Matrix of the view's shape, square_matrix for square views of a square_matrix
+        typedef typename matrix_type::template block_type<R, C> result_type;
+
+    private:
+        Matrix &m;
+        size_t row;
+        size_t col;
+
+        constexpr size_t parent_row(size_t i) const {
+            return Skip ? i + (i >= row) : row + i;
+        }
+
+        constexpr size_t parent_col(size_t j) const {
+            return Skip ? j + (j >= col) : col + j;
+        }
+
+    public:
+        constexpr sub_view(Matrix &m, size_t row, size_t col)
+                : m(m), row(row), col(col) {
+            assert(Skip ? row < matrix_type::rows && col < matrix_type::cols
+                        : row + R <= matrix_type::rows && col + C <= matrix_type::cols);
+        }
+
+        constexpr sub_view(const sub_view &) = default;
+
+        constexpr sub_view &operator=(const sub_view &val) {
+            return *this = result_type(val);
+        }
+
+        constexpr sub_view &operator=(const result_type &val) {
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    (*this)(i, j) = val(i, j);
+
+            return *this;
+        }
+
+        constexpr operator result_type() const {
+            result_type result(0);
+
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    result(i, j) = (*this)(i, j);
+
+            return result;
+        }
+
+        // Default math operations, results are matrices:
+
+        constexpr result_type operator+(const result_type &val) const {
+            return result_type(*this) + val;
+        }
+
+        constexpr result_type operator-(const result_type &val) const {
+            return result_type(*this) - val;
+        }
+
+        constexpr result_type operator+(value_type val) const {
+            return result_type(*this) + val;
+        }
+
+        constexpr result_type operator-(value_type val) const {
+            return result_type(*this) - val;
+        }
+
+        constexpr result_type operator*(value_type val) const {
+            return result_type(*this) * val;
+        }
+
+        constexpr result_type operator/(value_type val) const {
+            return result_type(*this) / val;
+        }
+
+        // Vector product
+        constexpr vector<value_type, R> operator*(const vector<value_type, C> &vec) const {
+            vector<value_type, R> result(0);
+
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    result(i) += (*this)(i, j) * vec(j);
+
+            return result;
+        }
+
+        // In-place operations on the matrix elements:
+
+        constexpr sub_view &operator+=(const result_type &val) {
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    (*this)(i, j) += val(i, j);
+
+            return *this;
+        }
+
+        constexpr sub_view &operator-=(const result_type &val) {
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    (*this)(i, j) -= val(i, j);
+
+            return *this;
+        }
+
+        constexpr sub_view &operator+=(value_type val) {
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    (*this)(i, j) += val;
+
+            return *this;
+        }
+
+        constexpr sub_view &operator-=(value_type val) {
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    (*this)(i, j) -= val;
+
+            return *this;
+        }
+
+        constexpr sub_view &operator*=(value_type val) {
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    (*this)(i, j) *= val;
+
+            return *this;
+        }
+
+        constexpr sub_view &operator/=(value_type val) {
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    (*this)(i, j) /= val;
+
+            return *this;
+        }
+
+        // Compare operations:
+
+        constexpr bool operator==(const result_type &val) const {
+            for (size_t i = 0; i < rows; ++i)
+                for (size_t j = 0; j < cols; ++j)
+                    if ((*this)(i, j) != val(i, j))
+                        return false;
+
+            return true;
+        }
+
+        constexpr bool operator!=(const result_type &val) const {
+            return !(*this == val);
+        }
+
+        // get/set selected element:
+
+        constexpr auto &operator()(size_t i, size_t j) const {
+            assert(i < rows && j < cols);
+            return m(parent_row(i), parent_col(j));
+        }
+    };
+
+    template<size_t R, size_t C, typename Matrix>
+    using block_view = sub_view<Matrix, R, C, false>;
+
+    template<typename Matrix>
+    using minor_view = sub_view<Matrix, Matrix::rows - 1, Matrix::cols - 1, true>;
+}
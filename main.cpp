@@ -8,61 +8,72 @@
 using namespace lmel;
 using namespace std;
 
-template<typename T, size_t N>
-void show(const vector<T, N> &vec) {
-    for (size_t i = 0; i < vec.size; ++i)
-        cout << vec(i) << " ";
-}
-
-template<typename T, size_t N>
-void show(const square_matrix<T, N> &mat) {
-    for (size_t i = 0; i < mat.rows; ++i) {
-        for (size_t j = 0; j < mat.cols; ++j)
-            cout << mat(i, j) << " ";
-
-        cout << "\n";
-    }
-}
-
-template<typename T, size_t N, size_t M>
-void show(const matrix<T, N, M> &mat) {
-    for (size_t i = 0; i < mat.rows; ++i) {
-        for (size_t j = 0; j < mat.cols; ++j)
-            cout << mat(i, j) << " ";
-
-        cout << "\n";
-    }
-}
-
-template<typename T>
-void show(const quaternion<T> &qt) {
-    cout << qt.x << " " << qt.y << " " << qt.z << " " << qt.w << "\n";
-}
-
 #include "test/vector.cpp"
+#include "test/vector_batch.cpp"
 #include "test/matrix.cpp"
 #include "test/square_matrix.cpp"
 #include "test/determinant.cpp"
 #include "test/quaternion.cpp"
+#include "test/expression.cpp"
+#include "test/dynamic_vector.cpp"
+#include "test/dynamic_matrix.cpp"
+#include "test/gemm.cpp"
+#include "test/thread_pool.cpp"
+#include "test/transform.cpp"
+#include "test/fast_math.cpp"
+#include "test/storage.cpp"
+#include "test/view.cpp"
+#include "test/ref.cpp"
+#include "test/sparse_matrix.cpp"
+#include "test/counters.cpp"
+#include "test/half.cpp"
+#include "test/inverse.cpp"
+#include "test/affine.cpp"
+#include "test/dual_quaternion.cpp"
+#include "test/skinning.cpp"
+#include "test/serialize.cpp"
+#include "test/mapped_file.cpp"
+#include "test/text.cpp"
 
 int main() {
     cout << "Run tests:\n";
     test_vector();
+    test_vector_batch();
     test_matrix();
     test_square_matrix();
     test_determinant();
     test_quaternion();
+    test_expression();
+    test_dynamic_vector();
+    test_dynamic_matrix();
+    test_gemm();
+    test_thread_pool();
+    test_transform();
+    test_fast_math();
+    test_storage();
+    test_view();
+    test_ref();
+    test_sparse_matrix();
+    test_counters();
+    test_half();
+    test_inverse();
+    test_affine();
+    test_dual_quaternion();
+    test_skinning();
+    test_serialize();
+    test_mapped_file();
+    test_text();
 
     quaternion<double> q(double_vector3d{1.0, 0.0, 0.0}, 1.0);
-    show(q);
+    write_text(cout, q);
 
     cout << "\n";
 
-    show(q.get_rotation_matrix3d());
+    write_text(cout, q.get_rotation_matrix3d());
 
     cout << "\n";
 
-    show(make_id_quaternion<double>());
+    write_text(cout, make_id_quaternion<double>());
 
     return 0;
 }
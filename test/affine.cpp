@@ -0,0 +1,79 @@
+#include <vector>
+#include <math.h>
+#include "../lmel/affine.h"
+#include "test.h"
+
+void test_affine() {
+    using namespace lmel;
+
+    const quaternion<double> q(double_vector3d{1, 2, 2} / 3.0, 0.7);
+    const double_affine3 rigid(q, double_vector3d{5, -2, 0.5});
+
+    double_matrix3d linear{2, 1, 0, 0, 1, -1, 1, 0, 3};
+    const double_affine3 general(linear, double_vector3d{1, 2, 3});
+
+    // Conversion to and from 4x4 matrices is exact, products match the 4x4 products
+    {
+        const double_matrix4d m = general.to_matrix4d();
+        test(double_affine3(m) == general && m(3, 3) == 1 && m(3, 0) == 0 && m(1, 3) == 2);
+
+        const double_affine3 p = general * general;
+        test(p.to_matrix4d() == m * m);
+
+        float_affine3 f(float_matrix3d{2, 1, 0, 0, 1, -1, 1, 0, 3}, float_vector3d{1, 2, 3});
+        float_affine3 g(float_matrix3d{0, -1, 0, 1, 0, 0, 0, 0, 1}, float_vector3d{4, 0, -1});
+        test((f * g).to_matrix4d() == f.to_matrix4d() * g.to_matrix4d());
+
+        f *= g;
+        test(f.get_translation() == float_vector3d{9, 3, 4} && f(0, 0) == 1 && f(0, 1) == -2);
+
+        test(double_affine3() * general == general && general.get_linear() == linear);
+    }
+
+    // Points get the translation, directions do not
+    {
+        const double_vector3d v{1, -1, 2};
+        const double_vector4d p = general.to_matrix4d() * double_vector4d{1, -1, 2, 1};
+        const double_vector4d d = general.to_matrix4d() * double_vector4d{1, -1, 2, 0};
+
+        test(general.transform_point(v) == double_vector3d{p(0), p(1), p(2)});
+        test(general.transform_direction(v) == double_vector3d{d(0), d(1), d(2)});
+
+        std::vector<float_vector3d> in(100, float_vector3d{1, -1, 2}), out(in.size());
+        const float_affine3 f(float_matrix3d{2, 1, 0, 0, 1, -1, 1, 0, 3}, float_vector3d{1, 2, 3});
+
+        transform_points(f, in.data(), out.data(), in.size());
+        test(out[99] == f.transform_point(in[99]));
+
+        transform_directions(f, in.data(), out.data(), in.size());
+        test(out[0] == f.transform_direction(in[0]));
+    }
+
+    // Inverses: the rigid one transposes, the general one inverts the 3x3 block
+    {
+        auto error = [](const double_affine3 &a) {
+            double e = 0;
+
+            for (size_t i = 0; i < 3; ++i)
+                for (size_t j = 0; j < 4; ++j)
+                    e = fmax(e, fabs(a(i, j) - (i == j ? 1 : 0)));
+
+            return e;
+        };
+
+        test(error(rigid * rigid_inverse(rigid)) < 1e-14 && error(rigid_inverse(rigid) * rigid) < 1e-14);
+        test(error(general * inverse(general)) < 1e-14 && error(rigid * inverse(rigid)) < 1e-14);
+
+        double_affine3 out;
+        test(!try_inverse(double_affine3(double_matrix3d(1.0)), out) && out == double_affine3());
+    }
+
+    // Constant expressions
+    {
+        constexpr double_affine3 a(double_matrix3d{1, 0, 0, 0, 2, 0, 0, 0, 1}, double_vector3d{1, 0, 0});
+        constexpr double_affine3 b = a * a;
+        static_assert(b(0, 3) == 2 && b(1, 1) == 4, "constexpr affine product");
+
+        test(true);
+    }
+}
@@ -0,0 +1,92 @@
+#include <thread>
+#include "../lmel/counters.h"
+#include "../lmel/vector.h"
+#include "../lmel/square_matrix.h"
+#include "../lmel/expression.h"
+#include "../lmel/parallel.h"
+#include "test.h"
+
+void test_counters() {
+    using namespace lmel;
+
+    // Counted code still works in constant expressions, which are never counted
+    {
+        constexpr float_vector3d a{1, 2, 3};
+        constexpr float_vector3d b = a + a * 2.0f;
+        static_assert(b(2) == 9, "constexpr vector with counters");
+
+        constexpr int_matrix2d m{1, 2, 3, 4};
+        constexpr int_matrix2d p = m * m;
+        static_assert(p(1, 1) == 22, "constexpr product with counters");
+
+        test(true);
+    }
+
+    reset_counters();
+
+    float_vector3d a{1, 2, 3}, b{4, 5, 6};
+    float_vector3d c = a + b;
+    float d = a * b;
+    c = cross(a, b);
+
+    const counters after_vectors = counters_snapshot();
+
+    int_matrix3d m{1, 2, 3, 4, 5, 6, 7, 8, 10};
+    int_matrix3d p = m * m;
+    int_vector3d v = m * int_vector3d{1, 1, 1};
+
+    float_vector4d r(0);
+    const float_vector4d x(1), y(2);
+    assign(r, lazy(x) * 2.0f + y);
+
+    dynamic_matrix<double> big(64, 64, 1.0);
+    dynamic_matrix<double> product = big * big;
+
+    const counters all = counters_snapshot();
+    const counters tail = all - after_vectors;
+
+    test(c == float_vector3d{-3, 6, -3} && d == 32 && p(0, 0) == 30 && v(2) == 25);
+    test(r == float_vector4d(4) && product(0, 0) == 64);
+
+    if constexpr (counters_enabled) {
+        test(all[counter_op::vector].operations == 1);
+        test(all[counter_op::vector].flops == 3);
+        test(all[counter_op::vector].bytes == 3 * 3 * sizeof(float));
+        test(all[counter_op::vector].temporaries == 1);
+
+        test(all[counter_op::dot].operations == 2);
+        test(all[counter_op::dot].flops == 6 + 9);
+
+        test(tail[counter_op::vector].operations == 0);
+        test(tail[counter_op::matrix_product].flops == 2 * 27);
+        test(tail[counter_op::matrix_vector].flops == 2 * 9);
+        test(tail[counter_op::expression].flops == 2 * 4);
+        test(tail[counter_op::expression].bytes == 3 * 4 * sizeof(float));
+        test(tail[counter_op::gemm].flops == 2 * 64 * 64 * 64);
+
+        test(all.total().operations == all[counter_op::vector].operations + all[counter_op::dot].operations +
+                                       tail.total().operations);
+
+        // Counters are per thread; a parallel product counts once, on the calling thread
+        const uint64_t own = counters_snapshot()[counter_op::vector].operations;
+
+        std::thread([] {
+            float_vector3d t = float_vector3d(1) + float_vector3d(2);
+            test(t(0) == 3 && counters_snapshot()[counter_op::vector].operations == 1);
+        }).join();
+
+        test(counters_snapshot()[counter_op::vector].operations == own);
+
+        thread_pool pool(3);
+        dynamic_matrix<double> large(160, 160, 1.0);
+        const counters before = counters_snapshot();
+        multiply(large, large, pool);
+        test((counters_snapshot() - before)[counter_op::gemm].operations == 1);
+        test((counters_snapshot() - before)[counter_op::gemm].flops == 2 * 160 * 160 * 160);
+    } else {
+        test(all.total().operations == 0 && all.total().bytes == 0);
+    }
+
+    reset_counters();
+    test(counters_snapshot().total().flops == 0);
+}
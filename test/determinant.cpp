@@ -24,5 +24,37 @@ void test_determinant() {
                         7, 8, 12
                 };
         test(determinant(m3) == -9);
+
+        int_matrix4d m4 =
+                {
+                        0, 2, 1, 3,
+                        1, 0, 4, 2,
+                        3, 1, 0, 1,
+                        2, 2, 1, 0
+                };
+        test(determinant(m4) == -71);
+
+        double_matrix4d md4 = m4;
+        test(fabs(determinant(md4) + 71) < 1e-12);
+
+        int_matrix5d m5 = make_id_matrix<int, 5>() * 2;
+        m5(0, 4) = 7;
+        test(determinant(m5) == 32);
+
+        double_matrix5d singular(1.0);
+        test(determinant(singular) == 0);
+    }
+
+    // Constant expressions
+    {
+        constexpr double_matrix3d m =
+                {
+                        1, 2, 3,
+                        4, 5, 6,
+                        7, 8, 12
+                };
+        constexpr double det = determinant(m);
+        static_assert(det == -9, "");
+        test(det == -9);
     }
-}
\ No newline at end of file
+}
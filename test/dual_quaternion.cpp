@@ -0,0 +1,53 @@
+#include <math.h>
+#include "../lmel/dual_quaternion.h"
+#include "test.h"
+
+void test_dual_quaternion() {
+    using namespace lmel;
+
+    const quaternion<double> q(double_vector3d{1, 2, 2} / 3.0, 0.7);
+    const quaternion<double> s(double_vector3d{0, 0, 1}, -1.2);
+    const double_dual_quaternion a(q, double_vector3d{5, -2, 0.5});
+    const double_dual_quaternion b(s, double_vector3d{-1, 3, 2});
+
+    auto near = [](const double_vector3d &u, const double_vector3d &v) {
+        return fabs(u(0) - v(0)) < 1e-12 && fabs(u(1) - v(1)) < 1e-12 && fabs(u(2) - v(2)) < 1e-12;
+    };
+
+    // Rotation and translation round trip, points match the affine transform
+    {
+        const double_vector3d p{1, -1, 2};
+        const double_affine3 m(q, double_vector3d{5, -2, 0.5});
+
+        test(a.get_rotation() == q && near(a.get_translation(), double_vector3d{5, -2, 0.5}));
+        test(near(a.transform_point(p), m.transform_point(p)) && near(a.transform_direction(p), q.rotate(p)));
+        test(near(a.get_affine().transform_point(p), m.transform_point(p)) && a.get_matrix4d()(3, 3) == 1);
+        test(double_dual_quaternion().transform_point(p) == p);
+    }
+
+    // Products compose like the affine products, the conjugate inverts unit dual quaternions
+    {
+        const double_vector3d p{0.5, 4, -3};
+        const double_affine3 m = a.get_affine() * b.get_affine();
+
+        test(near((a * b).transform_point(p), m.transform_point(p)));
+        test(near((a * a.get_conjugate()).transform_point(p), p));
+
+        double_dual_quaternion c = a;
+        c *= b;
+        test(c == a * b && c != a);
+    }
+
+    // Blends normalize to a unit dual quaternion with the dual part orthogonal to the real part
+    {
+        double_dual_quaternion c = a * 0.3 + b * 0.7;
+        test(c.normalize());
+
+        const double len = c.real.x * c.real.x + c.real.y * c.real.y + c.real.z * c.real.z + c.real.w * c.real.w;
+        const double dot = c.real.x * c.dual.x + c.real.y * c.dual.y + c.real.z * c.dual.z + c.real.w * c.dual.w;
+        test(fabs(len - 1) < 1e-12 && fabs(dot) < 1e-12);
+
+        double_dual_quaternion z = double_dual_quaternion() * 0.0;
+        test(!z.normalize());
+    }
+}
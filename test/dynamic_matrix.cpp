@@ -0,0 +1,68 @@
+#include "../lmel/dynamic_matrix.h"
+#include "../lmel/expression.h"
+#include "test.h"
+
+void test_dynamic_matrix() {
+    using namespace lmel;
+
+    // Creation & assignment
+    {
+        dynamic_matrix<int> m(2, 3, {
+                1, 2, 3,
+                4, 5, 6
+        });
+        test(m.rows() == 2 && m.cols() == 3);
+        test(m(1, 2) == 6);
+
+        dynamic_matrix<int> m2 = m;
+        test(m2 == m);
+
+        dynamic_matrix<int> m3 = std::move(m2);
+        test(m3 == m);
+        test(m2.rows() == 0);
+
+        test(m.get_transpose() == dynamic_matrix<int>(3, 2, {1, 4, 2, 5, 3, 6}));
+
+        m3 += m3;
+        test(m3 == dynamic_matrix<int>(2, 3, {2, 4, 6, 8, 10, 12}));
+
+        double_dynamic_matrix big(500, 500, 1.0);
+        test(big(499, 499) == 1.0);
+    }
+
+    // Conversion from/to fixed-size matrix
+    {
+        int_matrix3d f =
+                {
+                        1, 2, 3,
+                        4, 5, 6,
+                        7, 8, 9
+                };
+        int_dynamic_matrix d(f);
+        test(d.rows() == 3 && d(2, 0) == 7);
+        test(d.to_square_matrix<3>() == f);
+        test(d.get_row(1).to_vector<3>() == f.get_row(1));
+        test(d.get_col(1).to_vector<3>() == f.get_col(1));
+    }
+
+    // Math operations
+    {
+        int_dynamic_matrix z1(2, 2, {1, 2, 3, 4});
+        int_dynamic_matrix z2(2, 2, {5, 5, 5, 1});
+        test(z1 * z2 == int_dynamic_matrix(2, 2, {15, 7, 35, 19}));
+        test(z1 + z2 == int_dynamic_matrix(2, 2, {6, 7, 8, 5}));
+        test(z1 - z2 == int_dynamic_matrix(2, 2, {-4, -3, -2, 3}));
+        test(z1 * 2 == int_dynamic_matrix(2, 2, {2, 4, 6, 8}));
+        test(z1 * int_dynamic_vector{1, 1} == int_dynamic_vector{3, 7});
+        test(z1 * make_dynamic_id_matrix<int>(2) == z1);
+
+        z1.swap_rows(0, 1);
+        test(z1 == int_dynamic_matrix(2, 2, {3, 4, 1, 2}));
+
+        z1.swap_cols(0, 1);
+        test(z1 == int_dynamic_matrix(2, 2, {4, 3, 2, 1}));
+
+        int_dynamic_matrix r = lazy(z1) * 2 - z2;
+        test(r == int_dynamic_matrix(2, 2, {3, 1, -1, 1}));
+    }
+}
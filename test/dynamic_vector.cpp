@@ -0,0 +1,68 @@
+#include "../lmel/dynamic_vector.h"
+#include "../lmel/expression.h"
+#include "test.h"
+
+void test_dynamic_vector() {
+    using namespace lmel;
+
+    // Creation & assignment
+    {
+        dynamic_vector<int> v1(3, 12);
+        test(v1.size() == 3);
+        test(v1 == dynamic_vector<int>{12, 12, 12});
+
+        dynamic_vector<int> v2 = v1;
+        test(v2 == v1);
+
+        dynamic_vector<int> v3 = std::move(v2);
+        test(v3 == v1);
+
+        double_dynamic_vector vd(v1);
+        test(vd == double_dynamic_vector{12.0, 12.0, 12.0});
+
+        dynamic_vector<double> big(1000000, 1.0);
+        test(big.size() == 1000000);
+        test(reinterpret_cast<size_t>(big.begin()) % default_alignment == 0);
+    }
+
+    // Conversion from/to fixed-size vector
+    {
+        int_vector3d f = {1, 2, 3};
+        int_dynamic_vector d(f);
+        test(d == int_dynamic_vector{1, 2, 3});
+        test(d.to_vector<3>() == f);
+    }
+
+    // Math operations
+    {
+        double_dynamic_vector a = {1, 2, 3};
+        double_dynamic_vector b = {4, 5, 6};
+        test(a + b == double_dynamic_vector{5, 7, 9});
+        test(b - a == double_dynamic_vector{3, 3, 3});
+        test(a * b == 32);
+        test(a * 2.0 == double_dynamic_vector{2, 4, 6});
+        test(b / 2.0 == double_dynamic_vector{2, 2.5, 3});
+
+        a += b;
+        test(a == double_dynamic_vector{5, 7, 9});
+
+        a -= 1.0;
+        test(a == double_dynamic_vector{4, 6, 8});
+
+        a += a;
+        test(a == double_dynamic_vector{8, 12, 16});
+
+        double_dynamic_vector n = {0, 3, 4};
+        test(n.length() == 5.0);
+        test(n.normalize());
+        test(n == double_dynamic_vector{0, 0.6, 0.8});
+    }
+
+    // Lazy expressions
+    {
+        double_dynamic_vector a(1000, 1.0);
+        double_dynamic_vector b(1000, 2.0);
+        double_dynamic_vector r = lazy(a) * 3.0 + b - a;
+        test(r == double_dynamic_vector(1000, 4.0));
+    }
+}
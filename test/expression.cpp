@@ -0,0 +1,50 @@
+#include "../lmel/expression.h"
+#include "../lmel/square_matrix.h"
+#include "test.h"
+
+void test_expression() {
+    using namespace lmel;
+
+    // Vector expressions
+    {
+        double_vector3d a = {1, 2, 3};
+        double_vector3d b = {4, 5, 6};
+        double_vector3d c = {1, 1, 1};
+
+        double_vector3d r = lazy(a) * 2.0 + b - c;
+        test(r == a * 2.0 + b - c);
+
+        double_vector3d r2 = b - lazy(a) / 2.0;
+        test(r2 == b - a / 2.0);
+
+        double_vector3d r3 = -lazy(a) + 1.0;
+        test(r3 == double_vector3d{0, -1, -2});
+
+        test((2.0 * lazy(a) - c).eval() == double_vector3d{1, 3, 5});
+
+        // Reuse destination as operand
+        assign(a, lazy(a) + b);
+        test(a == double_vector3d{5, 7, 9});
+
+        // Operands must share element type and shape, these do not compile:
+        //     lazy(a) + float_vector3d{}
+        //     lazy(a) + double_vector4d{}
+    }
+
+    // Matrix expressions
+    {
+        int_matrix<2, 3> a = {
+                1, 2, 3,
+                4, 5, 6
+        };
+        int_matrix<2, 3> b(1);
+
+        int_matrix<2, 3> r = lazy(a) * 3 - b;
+        test(r == a * 3 - b);
+
+        int_matrix3d m1(2);
+        int_matrix3d m2(5);
+        int_matrix3d m3 = lazy(m1) + m2 * 2;
+        test(m3 == int_matrix3d(12));
+    }
+}
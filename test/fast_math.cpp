@@ -0,0 +1,138 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <math.h>
+#include "../lmel/fast_math.h"
+#include "../lmel/vector.h"
+#include "../lmel/vector_batch.h"
+#include "../lmel/quaternion.h"
+#include "test.h"
+
+void test_fast_math() {
+    using namespace lmel;
+
+    // rsqrt: relative error below 5e-7 over the positive normal floats
+    {
+        double max_error = 0;
+
+        for (uint32_t bits = 0x00800000; bits < 0x7f800000; bits += 997) {
+            float x;
+            std::memcpy(&x, &bits, sizeof(x));
+
+            double e = fabs(fast_math::rsqrt(x) * sqrt(double(x)) - 1);
+            max_error = e > max_error ? e : max_error;
+        }
+
+        test(max_error < 5e-7);
+
+        std::vector<float> in, out(1000);
+
+        for (int i = 1; i <= 1000; ++i)
+            in.push_back(float(i) * 0.37f);
+
+        fast_math::rsqrt(in.data(), out.data(), in.size());
+
+        bool ok = true;
+
+        for (size_t i = 0; i < in.size(); ++i)
+            ok = ok && fabs(out[i] * sqrt(double(in[i])) - 1) < 5e-7;
+
+        test(ok);
+        test(fast_math::rsqrt(4.0) == 0.5);
+        test(precise_math::rsqrt(4.0f) == 0.5f);
+    }
+
+    // sincos: absolute error below 1e-7 (float) and 1e-8 (double) for |x| <= 8192
+    {
+        double float_error = 0, double_error = 0;
+
+        for (double x = -8192; x <= 8192; x += 0.0013) {
+            float sf, cf;
+            fast_math::sincos(float(x), sf, cf);
+
+            double xf = float(x);
+            float_error = fmax(float_error, fmax(fabs(sf - sin(xf)), fabs(cf - cos(xf))));
+
+            double sd, cd;
+            fast_math::sincos(x, sd, cd);
+            double_error = fmax(double_error, fmax(fabs(sd - sin(x)), fabs(cd - cos(x))));
+        }
+
+        test(float_error < 1e-7);
+        test(double_error < 1e-8);
+
+        // Batch version gives the scalar results
+        std::vector<float> in, s(257), c(257);
+
+        for (int i = 0; i < 257; ++i)
+            in.push_back(float(i - 128) * 0.1f);
+
+        fast_math::sincos(in.data(), s.data(), c.data(), in.size());
+
+        bool ok = true;
+
+        for (size_t i = 0; i < in.size(); ++i) {
+            float si, ci;
+            fast_math::sincos(in[i], si, ci);
+            ok = ok && fabs(s[i] - si) <= 1e-7f && fabs(c[i] - ci) <= 1e-7f;
+        }
+
+        test(ok);
+    }
+
+    // Normalize with a policy
+    {
+        float_vector3d v{3, 4, 12};
+        test(v.normalize(fast_math()));
+        test(fabs(v.length() - 1) < 1e-6);
+        test(fabs(v(2) - 12.0f / 13) < 1e-6);
+
+        double_vector4d d{1, 1, 1, 1};
+        test(d.normalize(precise_math()));
+        test(d == double_vector4d(0.5));
+
+        float_vector3d zero(0);
+        test(!zero.normalize(fast_math()));
+
+        float_vector3d_batch batch;
+
+        for (int i = 0; i < 100; ++i)
+            batch.push_back(float_vector3d{float(i), float(i % 3), 1});
+
+        batch.push_back(float_vector3d(0));
+
+        test(batch.normalize(fast_math()) == 100);
+
+        bool ok = true;
+
+        for (size_t i = 0; i < 100; ++i)
+            ok = ok && fabs(batch.get(i).length() - 1) < 1e-6;
+
+        test(ok);
+        test(batch.get(100) == float_vector3d(0));
+
+        quaternion<float> q(1, 2, 2, 4);
+        test(q.normalize(fast_math()));
+        test(fabs(q.length() - 1) < 1e-6);
+    }
+
+    // Quaternions from axis and angle
+    {
+        float_vector3d axis{0, 0.6f, 0.8f};
+
+        quaternion<float> precise(axis, 1.3f);
+        quaternion<float> fast(axis, 1.3f, fast_math());
+
+        test(fabs(fast.x - precise.x) < 1e-6 && fabs(fast.y - precise.y) < 1e-6 &&
+             fabs(fast.z - precise.z) < 1e-6 && fabs(fast.w - precise.w) < 1e-6);
+
+        quaternion<float> made = make_quaternion<float>(axis, 1.3f);
+        test(made == precise);
+
+        quaternion<float> made_fast = make_quaternion<float>(axis, 1.3f, fast_math());
+        test(made_fast == fast);
+
+        quaternion<double> from_parts = make_quaternion<double>(0.0, 0.0, 1.0, 0.5, precise_math());
+        test(from_parts == make_quaternion<double>(0.0, 0.0, 1.0, 0.5));
+    }
+}
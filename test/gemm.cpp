@@ -0,0 +1,90 @@
+#include <math.h>
+#include "../lmel/gemm.h"
+#include "../lmel/square_matrix.h"
+#include "../lmel/dynamic_matrix.h"
+#include "test.h"
+
+template<typename T>
+lmel::dynamic_matrix<T> naive_product(const lmel::dynamic_matrix<T> &a, const lmel::dynamic_matrix<T> &b) {
+    lmel::dynamic_matrix<T> result(a.rows(), b.cols());
+
+    for (size_t i = 0; i < a.rows(); ++i)
+        for (size_t j = 0; j < b.cols(); ++j)
+            for (size_t k = 0; k < a.cols(); ++k)
+                result(i, j) += a(i, k) * b(k, j);
+
+    return result;
+}
+
+template<typename T>
+lmel::dynamic_matrix<T> make_test_matrix(size_t rows, size_t cols, size_t seed) {
+    lmel::dynamic_matrix<T> result(rows, cols);
+
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            result(i, j) = T((i * 31 + j * 17 + seed) % 19) - 9;
+
+    return result;
+}
+
+template<typename T>
+bool near(const lmel::dynamic_matrix<T> &a, const lmel::dynamic_matrix<T> &b, double eps) {
+    if (a.rows() != b.rows() || a.cols() != b.cols())
+        return false;
+
+    for (size_t i = 0; i < a.rows(); ++i)
+        for (size_t j = 0; j < a.cols(); ++j)
+            if (fabs(double(a(i, j)) - double(b(i, j))) > eps)
+                return false;
+
+    return true;
+}
+
+void test_gemm() {
+    using namespace lmel;
+
+    // Blocked product with edge tiles
+    {
+        auto a = make_test_matrix<double>(37, 300, 1);
+        auto b = make_test_matrix<double>(300, 29, 2);
+        test(near(a * b, naive_product(a, b), 1e-9));
+
+        auto fa = make_test_matrix<float>(130, 70, 3);
+        auto fb = make_test_matrix<float>(70, 150, 4);
+        test(near(fa * fb, naive_product(fa, fb), 1e-3));
+
+        auto ia = make_test_matrix<int>(65, 65, 5);
+        auto ib = make_test_matrix<int>(65, 65, 6);
+        test(ia * ib == naive_product(ia, ib));
+    }
+
+    // Strided operands: transposed A via strides
+    {
+        auto a = make_test_matrix<double>(40, 50, 7);
+        auto b = make_test_matrix<double>(40, 60, 8);
+        dynamic_matrix<double> c(50, 60);
+
+        gemm<double>(50, 40, 60, &a(0, 0), 1, 50, &b(0, 0), 60, 1, &c(0, 0), 60, 1);
+        test(near(c, naive_product(a.get_transpose(), b), 1e-9));
+    }
+
+    // Fixed-size matrices above the threshold
+    {
+        square_matrix<int, 40> m(0);
+
+        for (size_t i = 0; i < 40; ++i)
+            for (size_t j = 0; j < 40; ++j)
+                m(i, j) = int((i * 7 + j) % 11) - 5;
+
+        dynamic_matrix<int> d(m);
+        test(dynamic_matrix<int>(m * m) == naive_product(d, d));
+
+        square_matrix<int, 40> m2 = m;
+        m2 *= m;
+        test(m2 == m * m);
+
+        const matrix<int, 40, 40> &mb = m;
+        matrix<int, 40, 33> r(1);
+        test(dynamic_matrix<int>(mb * r) == naive_product(d, dynamic_matrix<int>(r)));
+    }
+}
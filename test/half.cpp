@@ -0,0 +1,204 @@
+#include <cstdint>
+#include <vector>
+#include <math.h>
+#include "../lmel/half.h"
+#include "../lmel/vector.h"
+#include "../lmel/square_matrix.h"
+#include "../lmel/determinant.h"
+#include "../lmel/ref.h"
+#include "../lmel/quaternion.h"
+#include "../lmel/vector_batch.h"
+#include "../lmel/fast_math.h"
+#include "test.h"
+
+void test_half() {
+    using namespace lmel;
+
+    // Every half converts to float and back unchanged, NaNs stay NaN
+    {
+        bool ok = true;
+
+        for (uint32_t bits = 0; bits < 0x10000; ++bits) {
+            const half h = half::from_bits(static_cast<uint16_t>(bits));
+            const float f = h;
+
+            if (isnan(f))
+                ok = ok && isnan(float(half(f))) && (bits & 0x7c00) == 0x7c00;
+            else
+                ok = ok && half(f).to_bits() == bits;
+        }
+
+        test(ok);
+    }
+
+    // Round to nearest even, overflow to infinity, subnormals
+    test(half(1.0f).to_bits() == 0x3c00 && half(-2.0f).to_bits() == 0xc000);
+    test(half(1.0f + 1.0f / 2048).to_bits() == 0x3c00 && half(1.0f + 3.0f / 2048).to_bits() == 0x3c02);
+    test(half(65504.0f).to_bits() == 0x7bff && half(65519.0f).to_bits() == 0x7bff);
+    test(half(65520.0f).to_bits() == 0x7c00 && half(-1e10f).to_bits() == 0xfc00);
+    test(half(ldexpf(1, -24)).to_bits() == 0x0001 && half(ldexpf(1, -25)).to_bits() == 0x0000);
+    test(half(ldexpf(3, -25)).to_bits() == 0x0002 && float(half::from_bits(0x0001)) == ldexpf(1, -24));
+    test(isinf(float(half::from_bits(0x7c00))) && isnan(float(half(NAN))));
+
+    test(bfloat16(1.0f).to_bits() == 0x3f80 && float(bfloat16(-3.0f)) == -3.0f);
+    test(bfloat16(1.0f + 1.0f / 256).to_bits() == 0x3f80 && bfloat16(1.0f + 3.0f / 256).to_bits() == 0x3f82);
+    test(isnan(float(bfloat16(NAN))) && isinf(float(bfloat16(INFINITY))) && float(bfloat16(3e38f)) > 1e38f);
+
+    // Batch conversions match the scalar ones, including ties, NaN and the tail
+    {
+        std::vector<float> f;
+
+        for (int i = -500; i < 500; ++i)
+            f.push_back(float(i) * 0.3712f + ldexpf(float(i), -12));
+
+        f.push_back(1.0f + 1.0f / 2048);
+        f.push_back(1.0f + 1.0f / 256);
+        f.push_back(NAN);
+        f.push_back(detail::bits_float(0x7fffffff));
+        f.push_back(detail::bits_float(0xffffffff));
+        f.push_back(detail::bits_float(0x7fff8000));
+        f.push_back(-INFINITY);
+        f.push_back(ldexpf(3, -25));
+
+        std::vector<half> h(f.size());
+        std::vector<bfloat16> b(f.size());
+        std::vector<float> back(f.size());
+
+        convert(f.data(), h.data(), f.size());
+        convert(f.data(), b.data(), f.size());
+
+        bool ok = true;
+
+        for (size_t i = 0; i < f.size(); ++i)
+            ok = ok && h[i].to_bits() == half(f[i]).to_bits() && b[i].to_bits() == bfloat16(f[i]).to_bits();
+
+        test(ok);
+
+        convert(h.data(), back.data(), h.size());
+
+        for (size_t i = 0; i < f.size(); ++i)
+            ok = ok && (back[i] == float(h[i]) || (isnan(back[i]) && isnan(float(h[i]))));
+
+        convert(b.data(), back.data(), b.size());
+
+        for (size_t i = 0; i < f.size(); ++i)
+            ok = ok && (back[i] == float(b[i]) || (isnan(back[i]) && isnan(float(b[i]))));
+
+        test(ok);
+    }
+
+    // Dot products and lengths accumulate in float: a half sum would stop at 2048
+    {
+        lmel::vector<half, 4096> ones(1.0f);
+        const float d = ones * ones;
+        test(d == 4096);
+
+        vector3d<half> v{3, 4, 0};
+        test(v.length() == 5 && v.normalize() && v(0).to_bits() == half(0.6f).to_bits());
+
+        vector2d<bfloat16> w{1, 2};
+        test(w * w == 5.0f && float_vector2d(w) == float_vector2d{1, 2});
+    }
+
+    // Matrix products sum each element in float and round once, determinants are float
+    {
+        square_matrix<half, 3> m{1, 2, 3, 4, 5, 6, 7, 8, 10};
+        const square_matrix<float, 3> f(m);
+
+        const square_matrix<half, 3> p = m * m;
+        const square_matrix<float, 3> q = f * f;
+        test(square_matrix<float, 3>(p) == q);
+
+        const vector3d<half> mv = m * vector3d<half>{1, 1, 1};
+        test(float(mv(2)) == 25);
+
+        matrix<bfloat16, 2, 3> a{1, 2, 3, 4, 5, 6};
+        matrix<bfloat16, 3, 2> b{1, 0, 0, 1, 1, 1};
+        matrix<bfloat16, 2, 2> ab = a * b;
+        test(float(ab(0, 0)) == 4 && float(ab(1, 1)) == 11);
+
+        test(determinant(m) == -3.0f && cofactor(m, 0, 0) == 2.0f);
+
+        square_matrix<half, 5> big(0);
+
+        for (size_t i = 0; i < 5; ++i)
+            big(i, i) = 2;
+
+        big(0, 4) = 1;
+        test(fabs(determinant(big) - 32) < 1e-4f);
+
+        // Same through refs, below and above gemm_threshold
+        matrix<half, 4, 64> wide(1);
+        matrix<half, 64, 4> tall(1);
+        square_matrix<half, 32> sq(1), ones(1);
+
+        for (size_t i = 0; i < 4; ++i)
+            wide(i, 0) = 2048;
+
+        sq(0, 0) = 2048;
+
+        test(float((make_ref(wide) * make_ref(tall))(3, 3)) == float((wide * tall)(3, 3)));
+        test(float((make_ref(wide) * make_ref(tall))(0, 0)) == 2112);
+        test(float((make_ref(sq) * make_ref(ones))(0, 0)) == 2080 && float((sq * ones)(0, 0)) == 2080);
+    }
+
+    // Quaternions compute in float and round each component once
+    {
+        quaternion<half> q(vector3d<half>{0, 0, 1}, half(1.5707964f));
+        const quaternion<float> f(q);
+
+        test(fabs(q.length() - 1) < 1e-3 && q * q == quaternion<half>(f * f));
+        test(fabs(float(q.rotate(vector3d<half>{1, 0, 0})(1)) - 1) < 1e-3f);
+
+        quaternion<bfloat16> b(0, 3, 0, 4);
+        test(b.length() == 5 && b.normalize() && b == quaternion<bfloat16>(0, 0.6f, 0, 0.8f));
+        test(b.get_rotation_matrix3d() == square_matrix<bfloat16, 3>(quaternion<float>(b).get_rotation_matrix3d()));
+    }
+
+    // Batches stream through float: results match float batches up to the final rounding
+    {
+        std::vector<float_vector3d> vs;
+
+        for (int i = 0; i < 1000; ++i)
+            vs.push_back(float_vector3d{float(i % 17) - 8, float(i % 5) * 0.5f, float(i % 3) + 0.25f});
+
+        std::vector<vector3d<half>> hs(vs.begin(), vs.end());
+
+        vector_batch<float, 3> fb(vs);
+        vector_batch<half, 3> hb(hs);
+        vector_batch<bfloat16, 3> bb(std::vector<vector3d<bfloat16>>(vs.begin(), vs.end()));
+
+        // Within about one half ulp of the float results, which may differ in FMA contraction
+        auto near = [](float a, float b) {
+            return fabs(a - b) <= fabs(b) * 1e-3f;
+        };
+
+        bool ok = true;
+        const aligned_vector<half> hl = hb.length();
+        const aligned_vector<float> fl = fb.length();
+
+        for (size_t i = 0; i < vs.size(); ++i)
+            ok = ok && near(hl[i], fl[i]);
+
+        const aligned_vector<half> hd = hb * hb;
+        const aligned_vector<float> fd = fb * fb;
+
+        for (size_t i = 0; i < vs.size(); ++i)
+            ok = ok && near(hd[i], fd[i]);
+
+        test(ok);
+
+        vector_batch<half, 3> sum = hb + hb * half(0.5f);
+        test(float(sum(999, 0)) == 1.5f * float(hb(999, 0)) && float(sum(998, 2)) == 1.5f * float(hb(998, 2)));
+
+        test(hb.normalize() == fb.normalize() && bb.normalize(fast_math()) == 1000);
+
+        for (size_t i = 0; i < vs.size(); ++i)
+            for (size_t c = 0; c < 3; ++c) {
+                ok = ok && near(hb(i, c), fb(i, c));
+                ok = ok && fabs(float(bb(i, c)) - fb(i, c)) < 1e-2f;
+            }
+
+        test(ok);
+    }
+}
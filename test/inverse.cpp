@@ -0,0 +1,130 @@
+#include <math.h>
+#include "../lmel/square_matrix.h"
+#include "../lmel/inverse.h"
+#include "../lmel/quaternion.h"
+#include "test.h"
+
+// Largest difference between m * inv and the identity
+template<typename M>
+double identity_error(const M &m, const M &inv) {
+    const M p = m * inv;
+    double e = 0;
+
+    for (size_t i = 0; i < M::rows; ++i)
+        for (size_t j = 0; j < M::cols; ++j)
+            e = fmax(e, fabs(double(p(i, j)) - (i == j ? 1 : 0)));
+
+    return e;
+}
+
+void test_inverse() {
+    using namespace lmel;
+
+    // Closed forms up to 4x4, elimination above
+    {
+        double_matrix1d m1(4.0);
+        test(inverse(m1)(0, 0) == 0.25);
+
+        double_matrix2d m2{4, 7, 2, 6};
+        test(identity_error(m2, inverse(m2)) < 1e-15 && fabs(inverse(m2)(0, 0) - 0.6) < 1e-15);
+
+        double_matrix3d m3{2, -1, 0, -1, 2, -1, 0, -1, 2};
+        test(identity_error(m3, inverse(m3)) < 1e-15 && fabs(inverse(m3)(1, 1) - 1) < 1e-15);
+
+        double_matrix4d m4{0, 2, 1, 3, 1, 0, 4, 2, 3, 1, 0, 1, 2, 2, 1, 0};
+        test(identity_error(m4, inverse(m4)) < 1e-14);
+
+        double_matrix5d m5 = make_id_matrix<double, 5>() * 2;
+        m5(0, 4) = 7;
+        m5(3, 1) = -1;
+        m5(4, 0) = 0.5;
+        test(identity_error(m5, inverse(m5)) < 1e-14);
+
+        square_matrix<double, 4, packed_storage, col_major> c4(m4);
+        test(identity_error(c4, inverse(c4)) < 1e-14);
+    }
+
+    // The SSE 4x4 kernel agrees with the closed form, for both layouts and padded storage
+    {
+        float_matrix4d m{0, 2, 1, 3, 1, 0, 4, 2, 3, 1, 0, 1, 2, 2, 1, 0.5f};
+        const double_matrix4d d(m);
+
+        const float_matrix4d inv = inverse(m);
+        const double_matrix4d ref = inverse(d);
+
+        double e = 0;
+
+        for (size_t i = 0; i < 4; ++i)
+            for (size_t j = 0; j < 4; ++j)
+                e = fmax(e, fabs(inv(i, j) - ref(i, j)));
+
+        test(e < 1e-6 && identity_error(m, inv) < 1e-6);
+
+        square_matrix<float, 4, storage<16, true>, col_major> c(m);
+        test(identity_error(c, inverse(c)) < 1e-6 && fabs(inverse(c)(0, 3) - ref(0, 3)) < 1e-6);
+
+        square_matrix<float, 3, storage<16, true>> p{2, -1, 0, -1, 2, -1, 0, -1, 2};
+        test(identity_error(p, inverse(p)) < 1e-6);
+    }
+
+    // Singular matrices fail and leave the output unchanged
+    {
+        float_matrix4d out(7.0f);
+        test(!try_inverse(float_matrix4d(1.0f), out) && out == float_matrix4d(7.0f));
+
+        double_matrix3d d(5.0);
+        test(!try_inverse(double_matrix3d{1, 2, 3, 2, 4, 6, 0, 1, 1}, d) && d == double_matrix3d(5.0));
+
+        double_matrix5d e(0.0);
+        test(!try_inverse(double_matrix5d(1.0), e) && e == double_matrix5d(0.0));
+
+        float_matrix2d tiny{1e-30f, 0, 0, 1e-30f}, t(0.0f);
+        test(!try_inverse(tiny, t));
+
+        double_matrix2d in_place{1, 2, 3, 4};
+        test(try_inverse(in_place, in_place) && in_place == double_matrix2d{-2, 1, 1.5, -0.5});
+    }
+
+    // Constant expressions
+    {
+        constexpr double_matrix2d m{1, 2, 3, 4};
+        constexpr double_matrix2d inv = inverse(m);
+        static_assert(inv(0, 1) == 1 && inv(1, 0) == 1.5, "constexpr inverse");
+
+        test(true);
+    }
+
+    // Orthonormal and rigid fast paths match the general inverse
+    {
+        const quaternion<double> q(double_vector3d{1, 2, 2} / 3.0, 0.7);
+        const double_matrix3d r = q.get_rotation_matrix3d();
+        test(identity_error(r, orthonormal_inverse(r)) < 1e-15);
+
+        double_matrix4d rigid = make_id_matrix<double, 4>();
+
+        for (size_t i = 0; i < 3; ++i)
+            for (size_t j = 0; j < 3; ++j)
+                rigid(i, j) = r(i, j);
+
+        rigid(0, 3) = 5;
+        rigid(1, 3) = -2;
+        rigid(2, 3) = 0.5;
+
+        const double_matrix4d fast = rigid_inverse(rigid);
+        const double_matrix4d full = inverse(rigid);
+        double e = 0;
+
+        for (size_t i = 0; i < 4; ++i)
+            for (size_t j = 0; j < 4; ++j)
+                e = fmax(e, fabs(fast(i, j) - full(i, j)));
+
+        test(e < 1e-14 && identity_error(rigid, fast) < 1e-14 && fast(3, 3) == 1 && fast(3, 0) == 0);
+    }
+
+    // 16-bit scalars are inverted in float
+    {
+        square_matrix<half, 3> h{2, -1, 0, -1, 2, -1, 0, -1, 2};
+        const square_matrix<half, 3> inv = inverse(h);
+        test(float(inv(0, 0)) == 0.75f && float(inv(1, 1)) == 1.0f && float(inv(0, 2)) == 0.25f);
+    }
+}
@@ -0,0 +1,106 @@
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include "../lmel/mapped_file.h"
+#include "test.h"
+
+void test_mapped_file() {
+    using namespace lmel;
+
+    const std::string path = (std::filesystem::temp_directory_path() / "lmel_test_mapped.bin").string();
+
+    std::vector<float_vector3d> points(1000);
+
+    for (size_t i = 0; i < points.size(); ++i)
+        points[i] = float_vector3d{float(i), -float(i), 0.5f};
+
+    // Streamed appends read back in place, the data is aligned
+    {
+        mapped_writer<float_vector3d> w(path.c_str());
+        test(w.append(points.data(), 600) && w.append(std::vector<float_vector3d>(points.begin() + 600, points.end())));
+        test(w.append(points[0]) && w.size() == 1001 && w.close());
+
+        mapped_file f(path.c_str());
+        test(f.is_open() && f.size() == 1001 && f.holds<float_vector3d>());
+
+        const mapped_span<float_vector3d> s = f.elements<float_vector3d>();
+        test(s.size() == 1001 && s[999] == points[999] && s[1000] == points[0]);
+        test(reinterpret_cast<uintptr_t>(s.data()) % 64 == 0 && f.header().data_offset == 64);
+
+        // Same scalars in another shape or type do not match
+        test(!f.holds<float_vector4d>() && !f.holds<double_vector3d>() && !f.holds<int_vector3d>());
+        test(!f.holds<lmel::vector<float, 3, storage<16, true>>>() && !(f.holds_components<float, 3>()));
+
+        mapped_file g = std::move(f);
+        test(!f.is_open() && g.elements<float_vector3d>()[5] == points[5]);
+    }
+
+    // Matrices keep their layout
+    {
+        square_matrix<double, 4, packed_storage, col_major> m(0.0);
+        m(0, 3) = 7;
+
+        mapped_writer<square_matrix<double, 4, packed_storage, col_major>> w(path.c_str());
+        w.append(m);
+        w.close();
+
+        mapped_file f(path.c_str());
+        test(f.holds<square_matrix<double, 4, packed_storage, col_major>>() && !f.holds<double_matrix4d>());
+        test(f.elements<square_matrix<double, 4, packed_storage, col_major>>()[0](0, 3) == 7);
+        test(f.header().rows == 4 && f.header().cols == 4 && f.header().col_major == 1);
+    }
+
+    // Batches are stored as aligned component arrays
+    {
+        const float_vector3d_batch batch(points.data(), 999);
+        test(write_mapped(path.c_str(), batch));
+
+        mapped_file f(path.c_str());
+        test((f.holds_components<float, 3>()) && !f.holds<float_vector3d>() && !(f.holds_components<float, 4>()));
+
+        const mapped_batch<float, 3> b = f.components<float, 3>();
+        test(b.size() == 999 && b.get(998) == points[998] && b.component(1)[7] == points[7](1));
+        test(reinterpret_cast<uintptr_t>(b.component(2)) % 64 == 0 && b.to_batch().get(3) == points[3]);
+    }
+
+    // Component strides that overflow the file size are rejected
+    {
+        test(write_mapped(path.c_str(), float_vector3d_batch(points.data(), 999)));
+
+        const uint64_t stride = uint64_t(1) << 63;
+
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(offsetof(mapped_header, component_stride));
+            file.write(reinterpret_cast<const char *>(&stride), sizeof(stride));
+        }
+
+        mapped_file f;
+        test(!f.open(path.c_str()) && !f.is_open());
+    }
+
+    // Truncated files, other formats and unfinished writers
+    {
+        {
+            mapped_writer<float_vector3d> w(path.c_str());
+            w.append(points);
+        }
+
+        std::filesystem::resize_file(path, 64 + 12 * 999);
+
+        mapped_file f;
+        test(!f.open(path.c_str()) && !f.is_open());
+
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << "not an lmel file";
+        test(!f.open(path.c_str()) && !f.open((path + ".missing").c_str()));
+
+        mapped_writer<float_vector3d> w(path.c_str());
+        w.append(points);
+
+        test(f.open(path.c_str()) && f.size() == 0);
+    }
+
+    std::filesystem::remove(path);
+}
@@ -1,7 +1,72 @@
-
 #include "../lmel/quaternion.h"
 #include "test.h"
 
 void test_quaternion() {
     using namespace lmel;
-}
\ No newline at end of file
+
+    // Algebra
+    {
+        quaternion<float> a(1, 2, 3, 4), b(5, 6, 7, 8);
+        test(a * b == quaternion<float>(24, 48, 48, -6));
+        test(b * a == quaternion<float>(32, 32, 56, -6));
+
+        quaternion<double> c(1, 2, 3, 4), d(5, 6, 7, 8);
+        test(c * d == quaternion<double>(24, 48, 48, -6));
+
+        c *= d;
+        test(c == quaternion<double>(24, 48, 48, -6));
+
+        test(a.get_conjugate() == quaternion<float>(-1, -2, -3, 4));
+        test(a * make_id_quaternion<float>() == a);
+
+        quaternion<double> q(1, -1, 1, 1);
+        test(q * q.get_inverse() == make_id_quaternion<double>());
+
+        quaternion<double> n(0, 3, 0, 4);
+        test(n.length() == 5);
+        test(n.normalize());
+        test(n == quaternion<double>(0, 0.6, 0, 0.8));
+
+        quaternion<double> zero;
+        test(!zero.normalize());
+    }
+
+    // Rotation
+    {
+        // Half turn around z
+        quaternion<float> h(0, 0, 1, 0);
+        test(h.rotate(float_vector3d{1, 2, 3}) == float_vector3d{-1, -2, 3});
+
+        quaternion<double> h2(0, 0, 1, 0);
+        test(h2.rotate(double_vector3d{1, 2, 3}) == double_vector3d{-1, -2, 3});
+
+        // Quarter turn around axis, compared with the rotation matrix
+        double_vector3d axis{1, 2, 2};
+        axis.normalize();
+
+        quaternion<double> q(axis, 0.5);
+        double_vector3d v{3, -1, 2};
+        test((q.rotate(v) - q.get_rotation_matrix3d() * v).length() < 1e-12);
+
+        quaternion<float> qf(q);
+        float_vector3d vf{3, -1, 2};
+        test((qf.rotate(vf) - qf.get_rotation_matrix3d() * vf).length() < 1e-5);
+
+        // Composition: (a * b) rotates by b first, then by a
+        quaternion<double> r(double_vector3d{0, 0, 1}, 1.2);
+        double_vector3d composed = (r * q).rotate(v);
+        test((composed - r.rotate(q.rotate(v))).length() < 1e-12);
+    }
+
+    // Constant expressions
+    {
+        constexpr quaternion<double> q = {0, 0, 0, 1};
+        constexpr double_matrix3d m = q.get_rotation_matrix3d();
+        static_assert(m == make_id_matrix<double, 3>(), "");
+        test(m == make_id_matrix<double, 3>());
+
+        constexpr quaternion<int> p = quaternion<int>(1, 2, 3, 4) * quaternion<int>(5, 6, 7, 8);
+        static_assert(p == quaternion<int>(24, 48, 48, -6), "");
+        static_assert(make_id_quaternion<int>().rotate(int_vector3d{1, 2, 3}) == int_vector3d{1, 2, 3}, "");
+    }
+}
@@ -0,0 +1,199 @@
+#include "../lmel/ref.h"
+#include "../lmel/dynamic_ref.h"
+#include "../lmel/expression.h"
+#include "test.h"
+
+void test_ref() {
+    using namespace lmel;
+
+    // Vector refs
+    {
+        float buffer[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+        vector_ref<float, 4> a(buffer);
+        vector_ref<float, 4> odd(buffer, 2);
+
+        test(a == float_vector4d{1, 2, 3, 4});
+        test(odd == float_vector4d{1, 3, 5, 7});
+        test(a * float_vector4d{1, 1, 1, 1} == 10);
+        test(a + odd == float_vector4d{2, 5, 8, 11});
+
+        a += float_vector4d{1, 1, 1, 1};
+        test(buffer[0] == 2 && buffer[3] == 5 && buffer[4] == 5);
+
+        odd *= 2;
+        test(buffer[0] == 4 && buffer[2] == 8 && buffer[6] == 14 && buffer[1] == 3);
+
+        a = float_vector4d(0);
+        test(buffer[3] == 0 && buffer[4] == 10);
+
+        // Copying a ref copies the pointer, assigning copies the elements
+        vector_ref<float, 4> b = odd;
+        test(b.data() == buffer);
+
+        vector_ref<float, 4>(buffer + 4) = a;
+        test(buffer[4] == 0 && buffer[7] == 0);
+
+        float_vector3d v{3, 0, 4};
+        vector_ref<float, 3> r = make_ref(v);
+        test(r.length() == 5);
+        r.normalize();
+        test(v == float_vector3d{0.6f, 0, 0.8f});
+
+        const float_vector3d c{1, 2, 3};
+        vector_ref<const float, 3> cr = make_ref(c);
+        vector_ref<const float, 4> ca = a;
+        test(cr(2) == 3 && ca.data() == buffer);
+    }
+
+    // Matrix refs over a buffer
+    {
+        // 3x3 matrix in a buffer with rows 4 floats apart
+        float buffer[12] = {1, 2, 3, -1,
+                            4, 5, 6, -1,
+                            7, 8, 10, -1};
+
+        matrix_ref<float, 3, 3> m(buffer, 4);
+        const float_matrix3d expected{1, 2, 3, 4, 5, 6, 7, 8, 10};
+
+        test(m == expected);
+        test(m(2, 2) == 10);
+        test(m.row(1) == float_vector3d{4, 5, 6});
+        test(m.col(0) == float_vector3d{1, 4, 7});
+        test(m.block<2, 2>(1, 1) == float_matrix2d{5, 6, 8, 10});
+        test(m.transposed() == expected.get_transpose());
+        test(determinant(m) == determinant(expected));
+        test(m * float_vector3d{1, 1, 1} == expected * float_vector3d{1, 1, 1});
+        test(m * m == expected * expected);
+        test(m * expected == expected * expected);
+        test(m + expected == expected * 2.0f);
+
+        m.row(0) *= 2;
+        m.block<2, 2>(1, 0) += float_matrix2d(1);
+        test(m == float_matrix3d{2, 4, 6, 5, 6, 6, 8, 9, 10});
+        test(buffer[3] == -1 && buffer[7] == -1 && buffer[11] == -1);
+
+        float_matrix3d copy = m;
+        test(copy == float_matrix3d{2, 4, 6, 5, 6, 6, 8, 9, 10});
+
+        m = expected;
+        test(m == expected);
+
+        // Column-major memory
+        float cm[9] = {1, 4, 7, 2, 5, 8, 3, 6, 10};
+        matrix_ref<const float, 3, 3, col_major> c(cm);
+        test(c == expected);
+        test(c.col(2) == float_vector3d{3, 6, 10});
+
+        m -= c;
+        test(m == float_matrix3d(0));
+
+        // Lazy expressions written into the buffer
+        const float_matrix3d a(1), b(2);
+        assign(m, lazy(a) + b * 2.0f);
+        test(m == float_matrix3d(5));
+    }
+
+    // Refs to lmel matrices
+    {
+        double_matrix3d d{1, 2, 3, 4, 5, 6, 7, 8, 9};
+        matrix_ref<double, 3, 3> r = make_ref(d);
+
+        r(1, 1) = 0;
+        test(d(1, 1) == 0);
+
+        square_matrix<double, 3, storage<32, true>> padded(d);
+        auto pr = make_ref(padded);
+        test(pr.stride() == 4 && pr == d);
+
+        pr.transposed().row(0) = double_vector3d{-1, -2, -3};
+        test(padded.get_col(0) == double_vector3d{-1, -2, -3});
+
+        square_matrix<double, 3, packed_storage, col_major> cd(d);
+        test(make_ref(cd) == d);
+    }
+
+    // Products written into external memory
+    {
+        const size_t n = 40;
+        static float a[n * n], b[n * n], c[n * (n + 3)];
+
+        for (size_t i = 0; i < n * n; ++i) {
+            a[i] = float(i % 7) - 3;
+            b[i] = float(i % 5) - 2;
+        }
+
+        matrix_ref<const float, n, n> ra(a);
+        matrix_ref<const float, n, n, col_major> rb(b);
+        matrix_ref<float, n, n> rc(c, n + 3);
+
+        multiply(ra, rb, rc);
+
+        square_matrix<float, n> ma(ra);
+        square_matrix<float, n, packed_storage, col_major> mb(rb);
+        test(rc == ma * mb);
+        test(ra * rb == ma * mb);
+    }
+
+    // Dynamic refs
+    {
+        float buffer[24];
+
+        for (size_t i = 0; i < 24; ++i)
+            buffer[i] = float(i);
+
+        // 3x4 block of a 4x6 row-major buffer
+        dynamic_matrix_ref<float> m(buffer + 1, 3, 4, 6);
+        test(m(0, 0) == 1 && m(2, 3) == 16);
+        test(m.row(1) == dynamic_vector<float>{7, 8, 9, 10});
+        test(m.col(3) == dynamic_vector<float>{4, 10, 16});
+        test(m.transposed()(3, 2) == 16);
+        test(m.block(1, 1, 2, 2).to_dynamic_matrix() == float_dynamic_matrix(2, 2, {8, 9, 14, 15}));
+
+        m.col(0) *= 0;
+        test(buffer[0] == 0 && buffer[1] == 0 && buffer[7] == 0 && buffer[13] == 0 && buffer[19] == 19);
+
+        m.row(0) += dynamic_vector<float>(4, 1);
+        test(buffer[1] == 1 && buffer[4] == 5 && buffer[5] == 5);
+
+        dynamic_vector<float> v{1, 0, 0, 0};
+        test(m * v == dynamic_vector<float>{1, 0, 0});
+
+        dynamic_vector_ref<float> odd(buffer + 1, 4, 2);
+        test(odd.to_dynamic_vector() == dynamic_vector<float>{1, 4, 5, 0});
+
+        // Product on the pool into strided memory, compared with the owning product
+        const size_t n = 80;
+        float_dynamic_matrix a(n, n), b(n, n);
+
+        for (size_t i = 0; i < n; ++i)
+            for (size_t j = 0; j < n; ++j) {
+                a(i, j) = float((i + 2 * j) % 9) - 4;
+                b(i, j) = float((3 * i + j) % 7) - 3;
+            }
+
+        float_dynamic_matrix expected = a * b;
+        float_dynamic_matrix out(n, 2 * n, 5);
+        dynamic_matrix_ref<float> dst(&out(0, 0), n, n, 2 * n);
+
+        thread_pool pool(3);
+        multiply<float>(a, b, dst, pool);
+        test(dst == expected);
+        test(out(0, n) == 5);
+
+        // Transposed operands are strides only
+        float_dynamic_matrix bt = b.get_transpose();
+        dynamic_matrix_ref<const float> rbt(bt);
+        float_dynamic_matrix c(n, n);
+        multiply<float>(a, rbt.transposed(), c);
+        test(c == expected);
+
+        // Fixed-size matrices seen through a dynamic ref
+        square_matrix<float, 3, packed_storage, col_major> f{1, 2, 3, 4, 5, 6, 7, 8, 9};
+        dynamic_matrix_ref<float> rf(f);
+        test(rf(0, 1) == 2 && rf.row_step() == 1);
+
+        assign(rf, lazy(f) * 2.0f);
+        test(f(2, 2) == 18);
+    }
+}
@@ -0,0 +1,108 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <cstddef>
+#include <type_traits>
+#include "../lmel/serialize.h"
+#include "../lmel/affine.h"
+#include "../lmel/dual_quaternion.h"
+#include "test.h"
+
+void test_serialize() {
+    using namespace lmel;
+
+    static_assert(std::is_trivially_copyable<double_vector3d>::value &&
+                  std::is_trivially_copyable<square_matrix<float, 4, storage<16>, col_major>>::value &&
+                  std::is_trivially_copyable<quaternion<double>>::value &&
+                  std::is_trivially_copyable<double_affine3>::value, "trivially copyable types");
+
+    std::vector<float_matrix4d> matrices(1000);
+
+    for (size_t i = 0; i < matrices.size(); ++i)
+        for (size_t j = 0; j < 16; ++j)
+            matrices[i](j / 4, j % 4) = float(i) + float(j) / 16;
+
+    // Round trip, the data follows the header unchanged
+    {
+        std::stringstream s;
+        test(serialize(s, matrices) && s.str().size() == sizeof(serial_header) + matrices.size() * 64);
+        test(memcmp(s.str().data() + sizeof(serial_header), matrices.data(), matrices.size() * 64) == 0);
+
+        std::vector<float_matrix4d> read;
+        test(deserialize(s, read) && read == matrices);
+
+        std::stringstream d;
+        const double_dual_quaternion dq[2] = {double_dual_quaternion(), double_dual_quaternion() * 2.0};
+        double_dual_quaternion r[2];
+        test(serialize(d, dq, 2) && deserialize(d, r, 2) && r[0] == dq[0] && r[1] == dq[1]);
+
+        std::stringstream h;
+        std::vector<half> halves{1.5f, -2.0f, 65504.0f}, hr;
+        test(serialize(h, halves) && deserialize(h, hr) && hr.size() == 3 && float(hr[2]) == 65504.0f);
+    }
+
+    // Data from a writer with the other byte order is swapped on load
+    {
+        std::stringstream s;
+        serialize(s, matrices.data(), 3);
+
+        std::string bytes = s.str();
+        auto swap = [&](size_t offset, size_t width) {
+            std::reverse(bytes.begin() + offset, bytes.begin() + offset + width);
+        };
+
+        swap(4, 4);
+        swap(8, 2);
+        swap(12, 4);
+        swap(16, 8);
+
+        for (size_t i = sizeof(serial_header); i < bytes.size(); i += 4)
+            swap(i, 4);
+
+        std::stringstream o(bytes);
+        serial_header h;
+        test(read_serial_header(o, h) && h.count == 3 && h.element_size == 64 && h.byte_order != serial_byte_order);
+
+        std::stringstream p(bytes);
+        float_matrix4d r[3];
+        test(deserialize(p, r, 3) && r[0] == matrices[0] && r[2] == matrices[2]);
+    }
+
+    // Other element types, counts, newer versions and truncated data are rejected
+    {
+        std::stringstream s;
+        serialize(s, matrices.data(), 4);
+        const std::string bytes = s.str();
+
+        std::vector<double_matrix2d> other;
+        std::stringstream a(bytes);
+        test(!deserialize(a, other));
+
+        float_matrix4d r[4];
+        std::stringstream b(bytes);
+        test(!deserialize(b, r, 3));
+
+        std::string newer = bytes;
+        newer[8] = char(serial_version + 1);
+        std::stringstream c(newer);
+        test(!deserialize(c, r, 4));
+
+        std::stringstream d(bytes.substr(0, bytes.size() - 1));
+        test(!deserialize(d, r, 4));
+
+        std::stringstream e(std::string("LMEX") + bytes.substr(4));
+        test(!deserialize(e, r, 4));
+
+        // Corrupt counts fail without allocating them
+        std::vector<float_matrix4d> all;
+
+        for (uint64_t count : {uint64_t(1) << 40, ~uint64_t(0)}) {
+            std::string huge = bytes;
+            memcpy(&huge[offsetof(serial_header, count)], &count, sizeof(count));
+
+            std::stringstream f(huge);
+            test(!deserialize(f, all));
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#include <vector>
+#include <math.h>
+#include "../lmel/skinning.h"
+#include "test.h"
+
+void test_skinning() {
+    using namespace lmel;
+
+    // Palette of rigid transforms as matrices and dual quaternions
+    const size_t bones = 5;
+    std::vector<float_matrix4d> matrices;
+    std::vector<float_dual_quaternion> duals;
+
+    for (size_t b = 0; b < bones; ++b) {
+        quaternion<float> q(float_vector3d{0.6f, 0, 0.8f}, 0.4f * float(b));
+        const float_vector3d t{float(b), -1, 0.5f * float(b)};
+
+        // Negated quaternions are the same rotation, blending has to handle them
+        if (b == 3)
+            q = quaternion<float>(-q.x, -q.y, -q.z, -q.w);
+
+        matrices.push_back(float_affine3(q, t).to_matrix4d());
+        duals.push_back(float_dual_quaternion(q, t));
+    }
+
+    // Four influences per vertex, enough vertices for the SIMD blocks, a tail and the pool
+    const size_t count = (1 << 17) + 5;
+    std::vector<float_vector3d> in(count), out(count), ref(count);
+    std::vector<uint16_t> index(count * 4);
+    std::vector<float> weight(count * 4);
+
+    for (size_t i = 0; i < count; ++i) {
+        in[i] = float_vector3d{float(i % 7) - 3, float(i % 5), float(i % 11) / 4};
+
+        for (size_t k = 0; k < 4; ++k) {
+            index[i * 4 + k] = uint16_t((i + k * 2) % bones);
+            weight[i * 4 + k] = k == 0 ? 0.4f : 0.2f;
+        }
+    }
+
+    auto error = [&] {
+        float e = 0;
+
+        for (size_t i = 0; i < count; ++i)
+            for (size_t c = 0; c < 3; ++c)
+                e = fmaxf(e, fabsf(out[i](c) - ref[i](c)));
+
+        return e;
+    };
+
+    // Linear blend: weighted sum of the transformed points
+    {
+        for (size_t i = 0; i < count; ++i) {
+            ref[i] = float_vector3d(0.0f);
+
+            for (size_t k = 0; k < 4; ++k) {
+                const float_vector3d p = float_affine3(matrices[index[i * 4 + k]]).transform_point(in[i]);
+                ref[i] += p * weight[i * 4 + k];
+            }
+        }
+
+        skin_linear<4>(matrices.data(), in.data(), index.data(), weight.data(), out.data(), count);
+        test(error() < 1e-4f);
+    }
+
+    // Dual quaternion blend against the scalar definition
+    {
+        for (size_t i = 0; i < count; ++i) {
+            const float_dual_quaternion &pivot = duals[index[i * 4]];
+            float_dual_quaternion sum = float_dual_quaternion() * 0.0f;
+
+            for (size_t k = 0; k < 4; ++k) {
+                const float_dual_quaternion &d = duals[index[i * 4 + k]];
+                const float dot = d.real.x * pivot.real.x + d.real.y * pivot.real.y + d.real.z * pivot.real.z +
+                                  d.real.w * pivot.real.w;
+
+                sum = sum + d * (dot < 0 ? -weight[i * 4 + k] : weight[i * 4 + k]);
+            }
+
+            sum.normalize();
+            ref[i] = sum.transform_point(in[i]);
+        }
+
+        skin_dual_quaternion<4>(duals.data(), in.data(), index.data(), weight.data(), out.data(), count);
+        test(error() < 1e-4f);
+    }
+
+    // A single influence is the bone transform, in place
+    {
+        std::vector<float_vector3d> v(in.begin(), in.begin() + 21);
+        std::vector<uint8_t> one(v.size(), 2);
+        std::vector<float> full(v.size(), 1);
+
+        skin_dual_quaternion<1>(duals.data(), v.data(), one.data(), full.data(), v.data(), v.size());
+
+        float e = 0;
+
+        for (size_t i = 0; i < v.size(); ++i)
+            for (size_t c = 0; c < 3; ++c)
+                e = fmaxf(e, fabsf(v[i](c) - duals[2].transform_point(in[i])(c)));
+
+        test(e < 1e-5f);
+    }
+}
@@ -0,0 +1,150 @@
+#include "../lmel/sparse_matrix.h"
+#include "test.h"
+
+void test_sparse_matrix() {
+    using namespace lmel;
+
+    // Building from triplets
+    {
+        sparse_builder<double> b(3, 4);
+        b.add(2, 1, 5);
+        b.add(0, 3, 1);
+        b.add(0, 0, 2);
+        b.add(2, 1, -1);
+        b.add(1, 2, 0.5);
+
+        double_sparse_matrix m(b);
+        test(m.rows() == 3 && m.cols() == 4);
+        test(m.nonzeros() == 4);
+        test(m(0, 0) == 2 && m(0, 3) == 1 && m(1, 2) == 0.5 && m(2, 1) == 4);
+        test(m(0, 1) == 0 && m(2, 3) == 0);
+        test(m.row_offsets()[1] == 2 && m.col_indices()[1] == 3);
+
+        dynamic_matrix<double> d(3, 4, {2, 0, 0, 1,
+                                        0, 0, 0.5, 0,
+                                        0, 4, 0, 0});
+        test(m.to_dynamic_matrix() == d);
+        test(double_sparse_matrix(d) == m);
+
+        test(m.get_transpose().to_dynamic_matrix() == d.get_transpose());
+        test(m.get_transpose().get_transpose() == m);
+
+        m *= 2;
+        test(m(2, 1) == 8);
+        test((m * 0.5)(2, 1) == 4);
+
+        double_sparse_matrix e(5, 5);
+        test(e.nonzeros() == 0 && e(4, 4) == 0);
+    }
+
+    // Products with dense vectors and matrices
+    {
+        float_dynamic_matrix d(4, 3, {1, 0, 2,
+                                      0, 0, 0,
+                                      0, 3, 0,
+                                      4, 0, 5});
+        float_sparse_matrix m(d);
+
+        dynamic_vector<float> x{1, 2, 3};
+        test(m * x == d * x);
+
+        dynamic_vector<float> y{1, 1, 2, 1};
+        dynamic_vector<float> ty(3);
+        transpose_multiply<float>(m, y, ty);
+        test(ty == d.get_transpose() * y);
+
+        // Strided source and destination
+        float buffer[8] = {1, -1, 2, -1, 3, -1, -1, -1};
+        float out[8] = {0};
+        multiply<float>(m, dynamic_vector_ref<const float>(buffer, 3, 2), dynamic_vector_ref<float>(out, 4, 2));
+        test(out[0] == 7 && out[2] == 0 && out[4] == 6 && out[6] == 19 && out[1] == 0);
+
+        float_dynamic_matrix b(3, 2, {1, 2, 3, 4, 5, 6});
+        test(m * b == d * b);
+    }
+
+    // Products large enough to run on the pool
+    {
+        const size_t rows = 5000, cols = 3000;
+        sparse_builder<double> b(rows, cols);
+
+        for (size_t i = 0; i < rows; ++i)
+            for (size_t k = 0; k < (i % 50); ++k)
+                b.add(i, (i * 7 + k * 131) % cols, double(int((i + k) % 9) - 4));
+
+        double_sparse_matrix m(b);
+        test(m.nonzeros() > sparse_parallel_threshold);
+
+        dynamic_vector<double> x(cols), y(rows);
+
+        for (size_t j = 0; j < cols; ++j)
+            x(j) = double(int(j % 5) - 2);
+
+        for (size_t i = 0; i < rows; ++i)
+            y(i) = double(int(i % 3) - 1);
+
+        thread_pool pool(3);
+        dynamic_vector<double> r(rows), s(rows), t(cols), u(cols);
+
+        multiply<double>(m, x, r, pool);
+        multiply<double>(m, x, s, pool);
+        test(r == s);
+
+        // Reference without the pool and without the gather path
+        bool same = true;
+
+        for (size_t i = 0; i < rows; ++i) {
+            double sum = 0;
+
+            for (size_t k = m.row_offsets()[i]; k < m.row_offsets()[i + 1]; ++k)
+                sum += m.values()[k] * x(m.col_indices()[k]);
+
+            same = same && sum == r(i);
+        }
+
+        test(same);
+
+        transpose_multiply<double>(m, y, t, pool);
+        multiply<double>(m.get_transpose(), y, u, pool);
+        test(t == u);
+
+        dynamic_matrix<double> dense(cols, 3);
+
+        for (size_t j = 0; j < cols; ++j)
+            for (size_t k = 0; k < 3; ++k)
+                dense(j, k) = x(j) * double(k + 1);
+
+        dynamic_matrix<double> p = multiply(m, dense, pool);
+        test(p.rows() == rows && p.cols() == 3);
+        test(p(17, 0) == r(17) && p(4321, 2) == 3 * r(4321) && p(rows - 1, 1) == 2 * r(rows - 1));
+    }
+
+    // Leading empty rows on the pool are still written
+    {
+        const size_t n = 200000;
+        sparse_builder<double> b(n, n);
+
+        for (size_t i = 10; i < n; ++i)
+            b.add(i, i, 2);
+
+        double_sparse_matrix m(b);
+        test(m.nonzeros() > sparse_parallel_threshold);
+
+        dynamic_vector<double> x(n), y(n);
+
+        for (size_t i = 0; i < n; ++i) {
+            x(i) = 1;
+            y(i) = 42;
+        }
+
+        thread_pool pool(4);
+        multiply<double>(m, x, y, pool);
+
+        bool same = true;
+
+        for (size_t i = 0; i < n; ++i)
+            same = same && y(i) == (i < 10 ? 0 : 2);
+
+        test(same);
+    }
+}
@@ -293,4 +293,18 @@ void test_square_matrix() {
         int_matrix1d m5 = m4.minor(0, 0);
         test(m5 == int_matrix1d(9));
     }
+
+    // Constant expressions
+    {
+        constexpr auto m = make_id_matrix<float, 4>() * 2.0f;
+        static_assert(m(0, 0) == 2.0f && m(0, 1) == 0.0f, "");
+
+        constexpr int_matrix2d m2 = int_matrix2d{1, 2, 3, 4} * int_matrix2d{5, 5, 5, 1};
+        static_assert(m2 == int_matrix2d{15, 7, 35, 19}, "");
+        static_assert(m2.get_row(1) == int_vector2d{35, 19}, "");
+
+        constexpr int_vector3d v = int_matrix3d(1) * int_vector3d{1, 2, 3};
+        static_assert(v == int_vector3d(6), "");
+        test(v == int_vector3d(6));
+    }
 }
@@ -0,0 +1,167 @@
+#include <vector>
+#include "../lmel/storage.h"
+#include "../lmel/vector.h"
+#include "../lmel/matrix.h"
+#include "../lmel/square_matrix.h"
+#include "../lmel/determinant.h"
+#include "../lmel/transform.h"
+#include "test.h"
+
+void test_storage() {
+    using namespace lmel;
+
+    typedef storage<16, true> simd16;
+    typedef storage<32, true> simd32;
+
+    // Layout
+    {
+        static_assert(sizeof(float_vector3d) == 12, "");
+        static_assert(sizeof(lmel::vector<float, 3, simd16>) == 16, "");
+        static_assert(alignof(lmel::vector<float, 3, simd16>) == 16, "");
+        static_assert(lmel::vector<float, 3, simd16>::storage_size == 4, "");
+        static_assert(alignof(lmel::vector<float, 4, storage<32>>) == 32, "");
+        static_assert(sizeof(lmel::vector<double, 5, simd32>) == 64, "");
+        static_assert(alignof(lmel::vector<double, 2, storage<4>>) == alignof(double), "");
+
+        static_assert(square_matrix<float, 3, simd16>::stride == 4, "");
+        static_assert(sizeof(square_matrix<float, 3, simd16>) == 48, "");
+        static_assert(alignof(square_matrix<float, 4, storage<64>>) == 64, "");
+
+        std::vector<lmel::vector<float, 3, simd16>> vs(5);
+        bool aligned = true;
+
+        for (auto &v : vs)
+            aligned = aligned && reinterpret_cast<size_t>(&v(0)) % 16 == 0;
+
+        test(aligned);
+    }
+
+    // Padded vectors give the same results as packed ones
+    {
+        float_vector3d a{1, 2, 3}, b{-4, 0.5f, 2};
+        lmel::vector<float, 3, simd16> pa(a), pb(b);
+
+        test(float_vector3d(pa + pb) == a + b);
+        test(float_vector3d(pa - pb) == a - b);
+        test(pa * pb == a * b);
+        test(float_vector3d(pa * 3.0f) == a * 3.0f);
+        test(float_vector3d(cross(pa, pb)) == cross(a, b));
+
+        // Scalar operations must not leave values in the padding lane
+        pa += 10.0f;
+        a += 10.0f;
+        test(pa * pa == a * a);
+
+        // 0 / 0 in the padding lane must not survive an assignment, which copies size lanes
+        pa /= 0.0f;
+        pa = lmel::vector<float, 3, simd16>(a);
+        test(pa.length() == a.length());
+
+        test(pa.normalize() && a.normalize());
+        test(float_vector3d(pa) == a);
+
+        lmel::vector<int, 3, simd16> pi{1, 2, 3};
+        pi -= 1;
+        test(pi * pi == 5);
+
+        constexpr lmel::vector<double, 3, simd32> c = lmel::vector<double, 3, simd32>{1, 2, 3} + lmel::vector<double, 3, simd32>(1);
+        static_assert(c(2) == 4, "");
+    }
+
+    // Padded matrices
+    {
+        double_matrix3d m{2, -1, 0, 1, 3, 4, 0, 5, -2};
+        square_matrix<double, 3, simd32> pm(m);
+
+        test(double_matrix3d(pm * pm) == m * m);
+        test(determinant(pm) == determinant(m));
+        test(double_vector3d(pm * lmel::vector<double, 3, simd32>{1, 2, 3}) == m * double_vector3d{1, 2, 3});
+        test(double_matrix2d(pm.minor(0, 0)) == m.minor(0, 0));
+
+        pm.transpose();
+        m.transpose();
+        test(double_matrix3d(pm) == m);
+
+        // Product above the gemm threshold walks the padded rows
+        square_matrix<float, 35> big(0);
+
+        for (size_t i = 0; i < 35; ++i)
+            for (size_t j = 0; j < 35; ++j)
+                big(i, j) = float((i * 7 + j * 3) % 11) - 5;
+
+        square_matrix<float, 35, storage<64, true>> pbig(big);
+        static_assert(decltype(pbig)::stride == 36, "");
+
+        test(square_matrix<float, 35>(pbig * pbig) == big * big);
+
+        matrix<float, 3, 5, simd16> r(1);
+        matrix<float, 5, 2, simd16> s(2);
+        test((r * s)(2, 1) == 10);
+        test(r.get_transpose()(4, 2) == 1);
+    }
+
+    // Column-major layout
+    {
+        typedef matrix<int, 2, 3, packed_storage, col_major> cm23;
+        typedef square_matrix<double, 3, packed_storage, col_major> cm3;
+
+        cm23 a{1, 2, 3,
+               4, 5, 6};
+
+        // Columns are contiguous
+        test(&a(1, 0) == &a(0, 0) + 1);
+        test(&a(0, 1) == &a(0, 0) + 2);
+        test(a.get_row(1) == int_vector3d{4, 5, 6});
+        test(a.get_col(2) == int_vector2d{3, 6});
+
+        int_matrix<2, 3> r(a);
+        test(r(1, 2) == 6);
+        test(cm23(r) == a);
+
+        a.swap_cols(0, 2);
+        a.swap_rows(0, 1);
+        test(a.get_row(0) == int_vector3d{6, 5, 4});
+
+        matrix<int, 3, 2, packed_storage, col_major> b{1, 0, 0, 1, 2, 2};
+        test(int_matrix<2, 2>(a * b) == int_matrix<2, 3>(a) * int_matrix<3, 2>(b));
+        test(int_matrix<3, 2>(a.get_transpose()) == int_matrix<2, 3>(a).get_transpose());
+        test(a * int_vector3d{1, 1, 1} == int_vector2d{15, 6});
+
+        double_matrix3d m{2, -1, 0, 1, 3, 4, 0, 5, -2};
+        cm3 cm(m);
+
+        test(double_matrix3d(cm * cm) == m * m);
+        test(double_matrix3d(cm + cm) == m + m);
+        test(cm * double_vector3d{1, 2, 3} == m * double_vector3d{1, 2, 3});
+        test(determinant(cm) == determinant(m));
+        test(double_matrix2d(cm.minor(1, 2)) == m.minor(1, 2));
+
+        cm.transpose();
+        test(double_matrix3d(cm) == m.get_transpose());
+
+        // Above the gemm threshold
+        square_matrix<float, 40> big(0);
+
+        for (size_t i = 0; i < 40; ++i)
+            for (size_t j = 0; j < 40; ++j)
+                big(i, j) = float((i * 5 + j * 3) % 7) - 3;
+
+        square_matrix<float, 40, storage<32, true>, col_major> cbig(big);
+        test(square_matrix<float, 40>(cbig * cbig) == big * big);
+
+        // Transforms read the columns directly
+        float_matrix4d t{1, 0, 0, 5,
+                         0, 2, 0, 6,
+                         0, 0, 1, 7,
+                         0, 0, 0, 1};
+        square_matrix<float, 4, packed_storage, col_major> ct(t);
+
+        float_vector3d p{1, 2, 3}, pr, cpr;
+        transform_points(t, &p, &pr, 1);
+        transform_points(ct, &p, &cpr, 1);
+        test(pr == cpr && pr == float_vector3d{6, 10, 10});
+
+        constexpr cm3 c = cm3{1, 2, 3, 4, 5, 6, 7, 8, 9} * cm3(1);
+        static_assert(c(2, 0) == 24, "");
+    }
+}
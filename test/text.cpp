@@ -0,0 +1,78 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include "../lmel/text.h"
+#include "test.h"
+
+void test_text() {
+    using namespace lmel;
+
+    // Separators, comments, signs and elements that span lines
+    {
+        std::vector<float_vector3d> v;
+        test(parse_text("# x y z\n1 2 3\n4,5;6 # trailing\r\n+7 -8\n9e-1\n", v));
+        test(v.size() == 3 && v[0] == float_vector3d{1, 2, 3} && v[2] == float_vector3d{7, -8, 0.9f});
+
+        std::vector<double_matrix2d> m;
+        test(parse_text(std::string("1 2\n3 4\n\n5 6\n7 8"), m) && m.size() == 2 && m[1](1, 0) == 7 && m[0](0, 1) == 2);
+
+        std::vector<quaternion<float>> q;
+        test(parse_text(std::string("0 0 0 1"), q) && q.size() == 1 && q[0] == make_id_quaternion<float>());
+
+        std::vector<int> i;
+        test(parse_text(std::string(""), i) && i.empty() && parse_text(std::string("-3 4"), i) && i[0] == -3);
+    }
+
+    // Malformed numbers and incomplete elements
+    {
+        std::vector<float_vector2d> v;
+        test(!parse_text(std::string("1 2 x 4"), v) && !parse_text(std::string("1 2 3"), v) && v.size() == 1);
+        test(!parse_text(std::string("1 2 +-3 4"), v) && !parse_text(std::string("1.5.2 0"), v));
+    }
+
+    // Large text in parallel chunks and in stream blocks matches the values written
+    {
+        std::vector<double_vector3d> points(100000);
+
+        for (size_t i = 0; i < points.size(); ++i)
+            points[i] = double_vector3d{double(i) / 7, -double(i) * 1e10, 1.0 / double(i + 1)};
+
+        std::ostringstream out;
+        test(write_text(out, points));
+
+        const std::string text = out.str();
+        std::vector<double_vector3d> read;
+        test(text.size() > 2 * text_chunk && parse_text(text, read) && read == points);
+
+        std::istringstream in(text);
+        read.clear();
+        test(read_text(in, read) && read == points);
+
+        double_vector3d_batch batch;
+        std::istringstream batch_in(text);
+        test(read_text(batch_in, batch) && batch.size() == points.size() && batch.get(777) == points[777]);
+
+        // Small blocks, so that lines straddle block boundaries or are longer than a block
+        for (size_t block : {size_t(4093), size_t(16)}) {
+            std::istringstream block_in(text);
+            read.clear();
+            test(detail::read_text(block_in, read, shared_thread_pool(), block) && read == points);
+        }
+
+        std::ostringstream batch_out;
+        test(write_text(batch_out, batch) && batch_out.str() == text);
+    }
+
+    // Matrices are written one row per line, 16-bit scalars through float
+    {
+        std::ostringstream out;
+        write_text(out, float_matrix2d{1, 2.5f, -3, 4});
+        write_text(out, quaternion<double>(0, 0, 0, 1));
+        test(out.str() == "1 2.5\n-3 4\n0 0 0 1\n");
+
+        std::vector<vector3d<half>> h;
+        std::ostringstream hout;
+        test(parse_text(std::string("0.5 1 65504"), h) && float(h[0](2)) == 65504 && write_text(hout, h));
+        test(hout.str() == "0.5 1 65504\n");
+    }
+}
@@ -0,0 +1,82 @@
+#include <atomic>
+#include <stdexcept>
+#include "../lmel/thread_pool.h"
+#include "../lmel/parallel.h"
+#include "test.h"
+
+void test_thread_pool() {
+    using namespace lmel;
+
+    // Parallel loops
+    {
+        thread_pool pool(4);
+        test(pool.size() == 4);
+
+        std::vector<int> out(1000, 0);
+        pool.parallel_for(out.size(), [&](size_t i) { out[i] = int(i) * 2; });
+
+        bool ok = true;
+
+        for (size_t i = 0; i < out.size(); ++i)
+            ok = ok && out[i] == int(i) * 2;
+
+        test(ok);
+
+        // Nested loops run on the same pool
+        std::atomic<int> sum(0);
+        pool.parallel_for(16, [&](size_t) {
+            pool.parallel_for(16, [&](size_t) { ++sum; });
+        });
+        test(sum == 256);
+
+        pool.resize(2);
+        test(pool.size() == 2);
+
+        thread_pool serial(1);
+        test(serial.size() == 0);
+
+        int count = 0;
+        serial.parallel_for(10, [&](size_t) { ++count; });
+        test(count == 10);
+
+        // Exceptions reach the calling thread after every call has finished
+        std::atomic<int> calls(0);
+        bool caught = false;
+
+        try {
+            pool.parallel_for(100, [&](size_t i) {
+                ++calls;
+
+                if (i % 10 == 3)
+                    throw std::runtime_error("task");
+            });
+        } catch (const std::runtime_error &) {
+            caught = true;
+        }
+
+        test(caught && calls == 100);
+    }
+
+    // Parallel product
+    {
+        thread_pool pool(4);
+
+        dynamic_matrix<double> a(300, 200), b(200, 250);
+
+        for (size_t i = 0; i < a.rows(); ++i)
+            for (size_t j = 0; j < a.cols(); ++j)
+                a(i, j) = double((i * 3 + j) % 7) - 3;
+
+        for (size_t i = 0; i < b.rows(); ++i)
+            for (size_t j = 0; j < b.cols(); ++j)
+                b(i, j) = double((i + j * 5) % 11) - 5;
+
+        test(multiply(a, b, pool) == a * b);
+
+        dynamic_matrix<int> s(4, 4, 2);
+        test(multiply(s, s, pool) == s * s);
+
+        int_matrix3d m(1);
+        test(multiply(m, m, pool) == m * m);
+    }
+}
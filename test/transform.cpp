@@ -0,0 +1,80 @@
+#include <vector>
+#include "../lmel/transform.h"
+#include "test.h"
+
+void test_transform() {
+    using namespace lmel;
+
+    const float_matrix4d m = make_square_matrix_from_rows<float, 4>({
+            float_vector4d{1, 2, 0, 5},
+            float_vector4d{0, 1, -1, 2},
+            float_vector4d{3, 0, 1, -4},
+            float_vector4d{0, 0, 1, 2}
+    });
+
+    // Points and directions match matrix * vector
+    {
+        std::vector<float_vector3d> in;
+
+        for (int i = 0; i < 37; ++i)
+            in.push_back(float_vector3d{float(i), float(i % 5 - 2), float(3 - i % 7)});
+
+        std::vector<float_vector3d> points(in.size()), dirs(in.size()), proj(in.size());
+
+        transform_points(m, in.data(), points.data(), in.size());
+        transform_directions(m, in.data(), dirs.data(), in.size());
+        transform_points(m, in.data(), proj.data(), in.size(), true);
+
+        bool ok = true;
+
+        for (size_t i = 0; i < in.size(); ++i) {
+            float_vector4d p = m * float_vector4d{in[i](0), in[i](1), in[i](2), 1};
+            float_vector4d d = m * float_vector4d{in[i](0), in[i](1), in[i](2), 0};
+
+            ok = ok && points[i] == float_vector3d{p(0), p(1), p(2)};
+            ok = ok && dirs[i] == float_vector3d{d(0), d(1), d(2)};
+            ok = ok && proj[i] == float_vector3d{p(0) / p(3), p(1) / p(3), p(2) / p(3)};
+        }
+
+        test(ok);
+
+        // SoA input gives the same results
+        float_vector3d_batch batch(in.data(), in.size()), out;
+
+        transform_points(m, batch, out);
+        test(out.to_vectors() == points);
+
+        transform_points(m, batch, out, true);
+        test(out.to_vectors() == proj);
+
+        transform_directions(m, batch, out);
+        test(out.to_vectors() == dirs);
+
+        // In place
+        transform_points(m, in.data(), in.data(), in.size());
+        test(in == points);
+    }
+
+    // Large inputs are split across the pool
+    {
+        thread_pool pool(4);
+        const size_t count = transform_parallel_threshold + 123;
+
+        std::vector<double_vector3d> in(count), serial(count), parallel(count);
+
+        for (size_t i = 0; i < count; ++i)
+            in[i] = double_vector3d{double(i % 101), double(i % 13), -double(i % 7)};
+
+        double_matrix4d dm(m);
+
+        thread_pool none(0);
+        transform_points(dm, in.data(), serial.data(), count, false, none);
+        transform_points(dm, in.data(), parallel.data(), count, false, pool);
+        test(serial == parallel);
+
+        double_vector3d_batch batch(in.data(), count), out;
+        transform_directions(dm, batch, out, pool);
+        transform_directions(dm, in.data(), serial.data(), count, none);
+        test(out.to_vectors() == serial);
+    }
+}
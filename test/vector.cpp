@@ -63,7 +63,7 @@ void test_vector() {
     {
         int_vector3d v1 = {1, 2, 3};
         int_vector3d v2 = {4, 5, 6};
-        test(cross(v1, v2) == int_vector3d{-3, -6, -3});
+        test(cross(v1, v2) == int_vector3d{-3, 6, -3});
     }
 
     // Normalize
@@ -75,4 +75,53 @@ void test_vector() {
         int_vector3d z = {0, 0, 0};
         test(!z.normalize());
     }
+
+    // 4-wide float/double (SIMD kernels)
+    {
+        float_vector4d f1 = {1.5f, -2.0f, 3.25f, 4.0f};
+        float_vector4d f2 = {0.5f, 2.0f, -1.25f, 8.0f};
+        test(f1 + f2 == float_vector4d{2.0f, 0.0f, 2.0f, 12.0f});
+        test(f1 - f2 == float_vector4d{1.0f, -4.0f, 4.5f, -4.0f});
+        test(f1 * 2.0f == float_vector4d{3.0f, -4.0f, 6.5f, 8.0f});
+        test(f1 / 2.0f == float_vector4d{0.75f, -1.0f, 1.625f, 2.0f});
+        test(f1 * f2 == 0.75f - 4.0f - 4.0625f + 32.0f);
+        test(f1 != f2);
+
+        double_vector4d d1 = {1.5, -2.0, 3.25, 4.0};
+        double_vector4d d2 = {0.5, 2.0, -1.25, 8.0};
+        test(d1 + d2 == double_vector4d{2.0, 0.0, 2.0, 12.0});
+        test(d1 - d2 == double_vector4d{1.0, -4.0, 4.5, -4.0});
+        test(d1 + 1.0 == double_vector4d{2.5, -1.0, 4.25, 5.0});
+        test(d1 * d2 == 0.75 - 4.0 - 4.0625 + 32.0);
+        test(d1 == double_vector4d(f1));
+
+        double_vector4d d3 = {0.0, 3.0, 0.0, 4.0};
+        test(d3.length() == 5.0);
+        test(d3.normalize());
+        test(d3 == double_vector4d{0.0, 0.6, 0.0, 0.8});
+
+        float_vector4d f3 = {0.0f, 3.0f, 0.0f, 4.0f};
+        test(f3.normalize());
+        test(f3 == float_vector4d{0.0f, 0.6f, 0.0f, 0.8f});
+    }
+
+    // Subtraction
+    {
+        int_vector3d v1 = {5, 7, 9};
+        int_vector3d v2 = {1, 2, 3};
+        test(v1 - v2 == int_vector3d{4, 5, 6});
+    }
+
+    // Constant expressions
+    {
+        constexpr int_vector3d v1 = {1, 2, 3};
+        constexpr int_vector3d v2 = v1 * 2 + int_vector3d(1);
+        static_assert(v2 == int_vector3d{3, 5, 7}, "");
+        static_assert(v1 * v2 == 34, "");
+        static_assert(cross(v1, v2) == int_vector3d{-1, 2, -1}, "");
+
+        constexpr float_vector4d f = float_vector4d{1, 2, 3, 4} - float_vector4d(1.0f);
+        static_assert(f == float_vector4d{0, 1, 2, 3}, "");
+        test(f == float_vector4d{0, 1, 2, 3});
+    }
 }
@@ -0,0 +1,86 @@
+#include "../lmel/vector_batch.h"
+#include "test.h"
+
+void test_vector_batch() {
+    using namespace lmel;
+
+    // Creation & conversion
+    {
+        std::vector<int_vector3d> vs = {
+                int_vector3d{1, 2, 3},
+                int_vector3d{4, 5, 6},
+                int_vector3d{7, 8, 9}
+        };
+
+        vector_batch<int, 3> b(vs);
+        test(b.size() == 3);
+        test(b.get(1) == int_vector3d{4, 5, 6});
+        test(b.component(2)[2] == 9);
+        test(b(0, 1) == 2);
+        test(b.to_vectors() == vs);
+
+        vector_batch<int, 3> b2(2, 7);
+        test(b2.get(0) == int_vector3d(7));
+
+        b2.push_back(int_vector3d{1, 1, 1});
+        test(b2.size() == 3);
+        test(b2.get(2) == int_vector3d(1));
+    }
+
+    // Math operations
+    {
+        float_vector3d_batch a = {
+                float_vector3d{1, 2, 3},
+                float_vector3d{0, -1, 4}
+        };
+        float_vector3d_batch b = {
+                float_vector3d{4, 5, 6},
+                float_vector3d{2, 2, 2}
+        };
+
+        test((a + b).get(1) == float_vector3d{2, 1, 6});
+        test((a - b).get(0) == float_vector3d{-3, -3, -3});
+        test((a * 2.0f).get(1) == float_vector3d{0, -2, 8});
+        test((b / 2.0f).get(0) == float_vector3d{2, 2.5, 3});
+
+        aligned_vector<float> dot = a * b;
+        test(dot[0] == a.get(0) * b.get(0));
+        test(dot[1] == a.get(1) * b.get(1));
+
+        float_vector3d_batch c = cross(a, b);
+        test(c.get(0) == cross(a.get(0), b.get(0)));
+        test(c.get(1) == cross(a.get(1), b.get(1)));
+
+        a += 1.0f;
+        test(a.get(0) == float_vector3d{2, 3, 4});
+
+        // Batch as its own operand
+        a += a;
+        test(a.get(0) == float_vector3d{4, 6, 8} && a.get(1) == float_vector3d{2, 0, 10});
+
+        a -= a;
+        test(a.get(1) == float_vector3d(0));
+    }
+
+    // Length & normalize
+    {
+        double_vector3d_batch b = {
+                double_vector3d{3, 0, 4},
+                double_vector3d{0, 0, 0},
+                double_vector3d{0, -2, 0}
+        };
+
+        aligned_vector<double> len = b.length();
+        test(len[0] == 5.0 && len[1] == 0.0 && len[2] == 2.0);
+
+        test(b.normalize() == 2);
+        test(b.get(0) == double_vector3d{0.6, 0, 0.8});
+        test(b.get(1) == double_vector3d{0, 0, 0});
+        test(b.get(2) == double_vector3d{0, -1, 0});
+
+        // Integral batches have double lengths, as vector::length
+        vector_batch<int, 3> c = {int_vector3d{3, 4, 0}, int_vector3d{1, 1, 0}};
+        aligned_vector<double> ilen = c.length();
+        test(ilen[0] == 5.0 && ilen[1] == c.get(1).length());
+    }
+}
@@ -0,0 +1,166 @@
+#include "../lmel/matrix.h"
+#include "../lmel/square_matrix.h"
+#include "../lmel/determinant.h"
+#include "../lmel/view.h"
+#include "test.h"
+
+void test_view() {
+    using namespace lmel;
+
+    // Row and column views
+    {
+        int_matrix<2, 3> m{1, 2, 3,
+                           4, 5, 6};
+
+        test(m.row(1) == int_vector3d{4, 5, 6});
+        test(m.col(2) == int_vector2d{3, 6});
+        test(int_vector3d{1, 2, 3} == m.row(0));
+
+        m.row(0) = int_vector3d{7, 8, 9};
+        test(m == int_matrix<2, 3>{7, 8, 9, 4, 5, 6});
+
+        m.col(1) *= 2;
+        test(m == int_matrix<2, 3>{7, 16, 9, 4, 10, 6});
+
+        m.row(1) += m.row(0);
+        test(m.row(1) == int_vector3d{11, 26, 15});
+
+        test(m.row(0) + int_vector3d{1, 1, 1} == int_vector3d{8, 17, 10});
+        test(m.col(0) * int_vector2d{1, 1} == 18);
+        test(int_vector3d(m.row(0)) == m.get_row(0));
+
+        // Writes go to the matrix, the view is not rebound
+        m.row(0) = m.row(1);
+        test(m == int_matrix<2, 3>{11, 26, 15, 11, 26, 15});
+
+        const int_matrix<2, 3> &c = m;
+        test(c.col(1) == int_vector2d{26, 26});
+    }
+
+    // In-place swaps
+    {
+        int_matrix3d m{1, 2, 3,
+                       4, 5, 6,
+                       7, 8, 9};
+
+        m.swap_rows(0, 2);
+        test(m == int_matrix3d{7, 8, 9, 4, 5, 6, 1, 2, 3});
+
+        m.swap_cols(0, 1);
+        test(m == int_matrix3d{8, 7, 9, 5, 4, 6, 2, 1, 3});
+
+        m.swap_rows(1, 1);
+        test(m == int_matrix3d{8, 7, 9, 5, 4, 6, 2, 1, 3});
+
+        // Row with column of another matrix
+        int_matrix3d o(0);
+        m.row(0).swap(o.col(1));
+        test(m.row(0) == int_vector3d(0));
+        test(o.col(1) == int_vector3d{8, 7, 9});
+
+        m.transpose();
+        test(m == int_matrix3d{0, 5, 2, 0, 4, 1, 0, 6, 3});
+
+        // Overlapping row and column
+        m.row(2) = m.col(1);
+        test(m.row(2) == int_vector3d{5, 4, 6});
+    }
+
+    // Block views
+    {
+        int_matrix4d m{1, 2, 3, 4,
+                       5, 6, 7, 8,
+                       9, 10, 11, 12,
+                       13, 14, 15, 16};
+
+        test(m.block<2, 2>(1, 1) == int_matrix2d{6, 7, 10, 11});
+        test(m.block<1, 3>(3, 1) == int_matrix<1, 3>{14, 15, 16});
+
+        int_matrix2d b = m.block<2, 2>(2, 2);
+        test(b == int_matrix2d{11, 12, 15, 16});
+
+        m.block<2, 2>(0, 0) = int_matrix2d(0);
+        test(m.row(0) == int_vector4d{0, 0, 3, 4});
+        test(m.row(1) == int_vector4d{0, 0, 7, 8});
+
+        m.block<2, 2>(0, 2) -= m.block<2, 2>(2, 2);
+        test(m.block<2, 2>(0, 2) == int_matrix2d{-8, -8, -8, -8});
+
+        // Overlapping source and destination
+        m.block<3, 3>(1, 1) = m.block<3, 3>(0, 0);
+        test(m == int_matrix4d{0, 0, -8, -8,
+                               0, 0, 0, -8,
+                               9, 0, 0, -8,
+                               13, 9, 10, 11});
+
+        test(m.block<2, 2>(2, 0) + int_matrix2d(1) == int_matrix2d{10, 1, 14, 10});
+        test(m.block<2, 2>(2, 0) * int_vector2d{1, 1} == int_vector2d{9, 22});
+
+        int_matrix<2, 3> r{1, 2, 3, 4, 5, 6};
+        test(r.block<2, 2>(0, 1) == int_matrix2d{2, 3, 5, 6});
+    }
+
+    // Minor views
+    {
+        double_matrix4d m{2, -1, 0, 3,
+                          1, 3, 4, -2,
+                          0, 5, -2, 1,
+                          4, 0, 1, 1};
+
+        test(m.minor_view(1, 2) == m.minor(1, 2));
+        test(double_matrix3d(m.minor_view(0, 0)) == double_matrix3d{3, 4, -2, 5, -2, 1, 0, 1, 1});
+        test(determinant(m.minor_view(2, 1)) == determinant(m.minor(2, 1)));
+
+        // Cofactor expansion along the first row
+        double det = 0;
+
+        for (size_t j = 0; j < 4; ++j)
+            det += m(0, j) * cofactor(m, 0, j);
+
+        test(fabs(det - determinant(m)) < 1e-9);
+
+        m.minor_view(3, 3) *= 2;
+        test(m.row(0) == double_vector4d{4, -2, 0, 3});
+        test(m.row(3) == double_vector4d{4, 0, 1, 1});
+
+        int_matrix5d i{2, 0, 1, 3, 1,
+                       1, 4, 0, 2, 2,
+                       0, 1, 5, 1, 0,
+                       3, 2, 1, 6, 1,
+                       1, 0, 2, 1, 7};
+
+        test(determinant(i.minor_view(4, 4)) == determinant(i.minor(4, 4)));
+        test(cofactor(i, 1, 2) == -determinant(i.minor(1, 2)));
+    }
+
+    // Column-major parent
+    {
+        square_matrix<int, 3, packed_storage, col_major> m{1, 2, 3,
+                                                           4, 5, 6,
+                                                           7, 8, 9};
+
+        test(m.row(1) == int_vector3d{4, 5, 6});
+        test(m.col(1) == int_vector3d{2, 5, 8});
+
+        m.swap_cols(0, 2);
+        test(m.row(0) == int_vector3d{3, 2, 1});
+        test(m.block<2, 2>(1, 1) == int_matrix2d{5, 4, 8, 7});
+    }
+
+    // Views in constant expressions
+    {
+        constexpr int_matrix3d m{1, 2, 3, 4, 5, 6, 7, 8, 10};
+        constexpr int d = cofactor(m, 0, 0);
+        static_assert(d == 2, "constexpr cofactor");
+
+        constexpr int_matrix3d t = [] {
+            int_matrix3d r{1, 2, 3, 4, 5, 6, 7, 8, 9};
+            r.swap_rows(0, 1);
+            r.transpose();
+            return r;
+        }();
+        static_assert(t(0, 1) == 1 && t(1, 0) == 5, "constexpr swap and transpose");
+
+        test(true);
+    }
+}